@@ -20,6 +20,10 @@ CONFIG(debug, release|debug):OBJECTS_DIR = debug/
 CONFIG(debug, release|debug):MOC_DIR = debug/
 CONFIG(debug, release|debug):UI_DIR = debug/
 
+# The BVH packet width follows the enabled instruction set (SSE2 by default on
+# x64), uncomment to trace 8 triangles at a time on CPUs with AVX2.
+#QMAKE_CXXFLAGS += -mavx2 -mfma
+
 INCLUDEPATH += '$$PWD/dependencies/eigen3'
 INCLUDEPATH += '$$PWD/dependencies/glm'
 
@@ -43,7 +47,24 @@ SOURCES += \
     mesh_io.cc \
     main_window.cc \
     glwidget.cc \
-    camera.cc
+    camera.cc \
+    bvh.cc \
+    distance_field.cc \
+    ambient_occlusion.cc \
+    environment_map.cc \
+    path_tracer.cc \
+    irradiance_volume.cc \
+    rasterizer.cc \
+    occlusion_culler.cc \
+    shader_program.cc \
+    gl_state_cache.cc \
+    gl_query.cc \
+    render_graph.cc \
+    render_thread.cc \
+    uniform_blocks.cc \
+    point_octree.cc \
+    ssao.cc \
+    headless.cc
 
 HEADERS  += \
     tiny_obj_loader.h \
@@ -51,7 +72,28 @@ HEADERS  += \
     mesh_io.h \
     main_window.h \
     glwidget.h \
-    camera.h
+    camera.h \
+    simd.h \
+    parallel_for.h \
+    bvh.h \
+    distance_field.h \
+    ambient_occlusion.h \
+    spherical_harmonics.h \
+    environment_map.h \
+    path_tracer.h \
+    irradiance_volume.h \
+    rasterizer.h \
+    occlusion_culler.h \
+    shader_program.h \
+    gl_state_cache.h \
+    gl_query.h \
+    render_graph.h \
+    render_thread.h \
+    spsc_queue.h \
+    uniform_blocks.h \
+    point_octree.h \
+    ssao.h \
+    headless.h
 
 FORMS    += \
     main_window.ui
@@ -84,4 +126,18 @@ DISTFILES += \
     shaders/step_three.frag \
     shaders/step_three.vert \
     shaders/step_two.frag \
-    shaders/step_two.vert
+    shaders/step_two.vert \
+    shaders/ssao_downsample.frag \
+    shaders/ssao_upsample.frag \
+    shaders/ssao_temporal.frag \
+    shaders/ssao.comp \
+    shaders/ssao_blur.comp \
+    shaders/composite.glsl \
+    shaders/deferred.glsl \
+    shaders/deferred.vert \
+    shaders/frame.glsl \
+    shaders/material.glsl \
+    shaders/normal.glsl \
+    shaders/scene.glsl \
+    shaders/ssao.glsl \
+    shaders/ssao_blur.glsl
@@ -0,0 +1,225 @@
+#include <ambient_occlusion.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "./parallel_for.h"
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+namespace data_representation {
+
+namespace {
+
+const char kAmbientOcclusionMagic[4] = {'A', 'O', '0', '1'};
+const char kRadianceTransferMagic[4] = {'P', 'R', 'T', '1'};
+
+/**
+ * @brief Header Layout of the beginning of a cache file, followed by the
+ * floats of every vertex.
+ */
+struct Header {
+  char magic[4];
+  int32_t vertices;
+  int32_t faces;
+  int32_t rays;
+  float distance;
+};
+
+Header MakeHeader(const char magic[4], const TriangleMesh &mesh, int rays,
+                  float distance) {
+  Header header;
+  std::memcpy(header.magic, magic, sizeof(header.magic));
+  header.vertices = static_cast<int32_t>(mesh.vertices_.size() / 3);
+  header.faces = static_cast<int32_t>(mesh.faces_.size() / 3);
+  header.rays = rays;
+  header.distance = distance;
+  return header;
+}
+
+bool ReadCache(const std::string &filename, const Header &expected,
+               int values_per_vertex, std::vector<float> *values) {
+  std::ifstream in(filename, std::ios::binary);
+  if (!in.is_open()) return false;
+
+  Header header;
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(header))) return false;
+  if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+      header.vertices != expected.vertices ||
+      header.faces != expected.faces || header.rays != expected.rays ||
+      header.distance != expected.distance)
+    return false;
+
+  values->resize(static_cast<size_t>(header.vertices * values_per_vertex));
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char *>(values->data()),
+              static_cast<std::streamsize>(values->size() * sizeof(float))));
+}
+
+bool WriteCache(const std::string &filename, const Header &header,
+                const std::vector<float> &values) {
+  std::ofstream out(filename, std::ios::binary);
+  if (!out.is_open()) return false;
+
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(values.data()),
+            static_cast<std::streamsize>(values.size() * sizeof(float)));
+  return static_cast<bool>(out);
+}
+
+float RadicalInverse(uint32_t bits) {
+  bits = (bits << 16u) | (bits >> 16u);
+  bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+  bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+  bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+  bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+  return static_cast<float>(bits) * 2.3283064365386963e-10f;
+}
+
+// Integer hash, used to rotate the Hammersley set differently per vertex so
+// that neighbouring vertices do not share the same banding.
+uint32_t Hash(uint32_t x) {
+  x ^= x >> 16u;
+  x *= 0x7feb352du;
+  x ^= x >> 15u;
+  x *= 0x846ca68bu;
+  x ^= x >> 16u;
+  return x;
+}
+
+/**
+ * @brief CastHemisphereRays Casts rays cosine distributed around the normal
+ * of vertex i and reports every direction with whether it escaped.
+ * @return False if the vertex has no normal and no ray was cast.
+ */
+template <typename Visit>
+bool CastHemisphereRays(const TriangleMesh &mesh, const Bvh &bvh, int i,
+                        int rays, float max_distance, float epsilon,
+                        Visit visit) {
+  const Eigen::Vector3f kPosition(mesh.vertices_[i * 3],
+                                  mesh.vertices_[i * 3 + 1],
+                                  mesh.vertices_[i * 3 + 2]);
+  Eigen::Vector3f normal(mesh.normals_[i * 3], mesh.normals_[i * 3 + 1],
+                         mesh.normals_[i * 3 + 2]);
+  if (normal.squaredNorm() <= 0.0f) return false;
+  normal.normalize();
+
+  const Eigen::Vector3f kTangent = normal.unitOrthogonal();
+  const Eigen::Vector3f kBitangent = normal.cross(kTangent);
+  const Eigen::Vector3f kOrigin = kPosition + normal * epsilon;
+
+  const uint32_t kSeed = Hash(static_cast<uint32_t>(i));
+  const float kShiftU = (kSeed & 0xFFFFu) / 65536.0f;
+  const float kShiftV = (kSeed >> 16u) / 65536.0f;
+  const float kTwoPi = static_cast<float>(2.0 * M_PI);
+
+  for (int r = 0; r < rays; ++r) {
+    float u = (r + 0.5f) / rays + kShiftU;
+    float v = RadicalInverse(static_cast<uint32_t>(r)) + kShiftV;
+    u -= std::floor(u);
+    v -= std::floor(v);
+
+    const float kRadius = std::sqrt(u);
+    const float kPhi = kTwoPi * v;
+    const Eigen::Vector3f kDirection =
+        kTangent * (kRadius * std::cos(kPhi)) +
+        kBitangent * (kRadius * std::sin(kPhi)) +
+        normal * std::sqrt(std::max(0.0f, 1.0f - u));
+
+    visit(kDirection,
+          !bvh.Occluded({kOrigin, kDirection, 0.0f, max_distance}));
+  }
+  return true;
+}
+
+}  // namespace
+
+void BakeAmbientOcclusion(const TriangleMesh &mesh, const Bvh &bvh, int rays,
+                          float max_distance, std::vector<float> *occlusion) {
+  const int kVertices = static_cast<int>(mesh.vertices_.size() / 3);
+  occlusion->assign(static_cast<size_t>(kVertices), 1.0f);
+  if (bvh.Empty() || mesh.normals_.size() != mesh.vertices_.size() ||
+      rays <= 0)
+    return;
+
+  const float kEpsilon = max_distance * 1e-3f;
+  concurrency::ParallelFor(kVertices, 256, [&](int i) {
+    // Cosine weighted directions, so the visible fraction is the cosine
+    // weighted ambient occlusion integral.
+    int visible = 0;
+    if (!CastHemisphereRays(mesh, bvh, i, rays, max_distance, kEpsilon,
+                            [&visible](const Eigen::Vector3f &, bool escaped) {
+                              if (escaped) ++visible;
+                            }))
+      return;
+    (*occlusion)[static_cast<size_t>(i)] =
+        static_cast<float>(visible) / static_cast<float>(rays);
+  });
+}
+
+bool ReadAmbientOcclusion(const std::string &filename, const TriangleMesh &mesh,
+                          std::vector<float> *occlusion) {
+  return ReadCache(filename,
+                   MakeHeader(kAmbientOcclusionMagic, mesh,
+                              kAmbientOcclusionRays, kAmbientOcclusionDistance),
+                   1, occlusion);
+}
+
+bool WriteAmbientOcclusion(const std::string &filename,
+                           const TriangleMesh &mesh,
+                           const std::vector<float> &occlusion) {
+  return WriteCache(filename,
+                    MakeHeader(kAmbientOcclusionMagic, mesh,
+                               kAmbientOcclusionRays,
+                               kAmbientOcclusionDistance),
+                    occlusion);
+}
+
+void BakeRadianceTransfer(const TriangleMesh &mesh, const Bvh &bvh, int rays,
+                          std::vector<float> *transfer) {
+  const int kVertices = static_cast<int>(mesh.vertices_.size() / 3);
+  transfer->assign(static_cast<size_t>(kVertices * kShCoefficients), 0.0f);
+  if (mesh.normals_.size() != mesh.vertices_.size() || rays <= 0) return;
+
+  const float kEpsilon = (mesh.max_ - mesh.min_).maxCoeff() * 2e-4f;
+  // With cosine weighted directions (pdf = cos / pi) the clamped cosine of
+  // the integrand cancels out.
+  const float kWeight = static_cast<float>(M_PI) / rays;
+  concurrency::ParallelFor(kVertices, 256, [&](int i) {
+    float *coefficients = &(*transfer)[static_cast<size_t>(i * kShCoefficients)];
+    CastHemisphereRays(
+        mesh, bvh, i, rays, std::numeric_limits<float>::max(), kEpsilon,
+        [&](const Eigen::Vector3f &direction, bool escaped) {
+          if (!escaped) return;
+          float sh[kShCoefficients];
+          EvaluateSh(direction, sh);
+          for (int c = 0; c < kShCoefficients; ++c)
+            coefficients[c] += sh[c] * kWeight;
+        });
+  });
+}
+
+bool ReadRadianceTransfer(const std::string &filename, const TriangleMesh &mesh,
+                          std::vector<float> *transfer) {
+  return ReadCache(
+      filename,
+      MakeHeader(kRadianceTransferMagic, mesh, kRadianceTransferRays, 0.0f),
+      kShCoefficients, transfer);
+}
+
+bool WriteRadianceTransfer(const std::string &filename,
+                           const TriangleMesh &mesh,
+                           const std::vector<float> &transfer) {
+  return WriteCache(
+      filename,
+      MakeHeader(kRadianceTransferMagic, mesh, kRadianceTransferRays, 0.0f),
+      transfer);
+}
+
+}  // namespace data_representation
@@ -0,0 +1,107 @@
+#ifndef AMBIENT_OCCLUSION_H_
+#define AMBIENT_OCCLUSION_H_
+
+#include <string>
+#include <vector>
+
+#include "./bvh.h"
+#include "./spherical_harmonics.h"
+#include "./triangle_mesh.h"
+
+namespace data_representation {
+
+/**
+ * @brief kAmbientOcclusionRays Cosine distributed rays cast per vertex.
+ */
+const int kAmbientOcclusionRays = 64;
+
+/**
+ * @brief kAmbientOcclusionDistance Occlusion ray length, relative to the
+ * longest edge of the mesh bounding box.
+ */
+const float kAmbientOcclusionDistance = 0.2f;
+
+/**
+ * @brief kRadianceTransferRays Cosine distributed rays cast per vertex to
+ * project the shadowed transfer.
+ */
+const int kRadianceTransferRays = 128;
+
+/**
+ * @brief BakeAmbientOcclusion Computes the per-vertex ambient occlusion of a
+ * mesh by casting cosine weighted rays over the hemisphere of every vertex
+ * normal, distributing vertices over all cores.
+ * @param mesh The mesh, with per-vertex normals.
+ * @param bvh Hierarchy built over mesh with the identity transform.
+ * @param rays Number of rays per vertex.
+ * @param max_distance Occlusion ray length in object space.
+ * @param occlusion Output visibility per vertex, 1 meaning unoccluded as in
+ * the SSAO textures.
+ */
+void BakeAmbientOcclusion(const TriangleMesh &mesh, const Bvh &bvh, int rays,
+                          float max_distance, std::vector<float> *occlusion);
+
+/**
+ * @brief ReadAmbientOcclusion Reads a cache written by WriteAmbientOcclusion.
+ * @param filename The path to the cache.
+ * @param mesh The mesh the cache must match.
+ * @param occlusion The per-vertex values.
+ * @return Whether the file exists and was baked for the same mesh topology
+ * and settings.
+ */
+bool ReadAmbientOcclusion(const std::string &filename, const TriangleMesh &mesh,
+                          std::vector<float> *occlusion);
+
+/**
+ * @brief WriteAmbientOcclusion Stores per-vertex ambient occlusion next to the
+ * mesh so that it is only baked once.
+ * @param filename The path where the cache will be stored.
+ * @param mesh The mesh the values were baked for.
+ * @param occlusion The per-vertex values.
+ * @return Whether it was able to store the file.
+ */
+bool WriteAmbientOcclusion(const std::string &filename,
+                           const TriangleMesh &mesh,
+                           const std::vector<float> &occlusion);
+
+/**
+ * @brief BakeRadianceTransfer Precomputes the diffuse radiance transfer of
+ * every vertex: the projection of visibility times the clamped cosine onto
+ * the first kShCoefficients spherical harmonics, so that the irradiance under
+ * an environment with coefficients L is the dot product of L and the
+ * transfer. Directions are in object space and vertices are distributed over
+ * all cores.
+ * @param mesh The mesh, with per-vertex normals.
+ * @param bvh Hierarchy built over mesh with the identity transform.
+ * @param rays Number of rays per vertex.
+ * @param transfer Output coefficients, kShCoefficients per vertex.
+ */
+void BakeRadianceTransfer(const TriangleMesh &mesh, const Bvh &bvh, int rays,
+                          std::vector<float> *transfer);
+
+/**
+ * @brief ReadRadianceTransfer Reads a cache written by WriteRadianceTransfer.
+ * @param filename The path to the cache.
+ * @param mesh The mesh the cache must match.
+ * @param transfer The per-vertex coefficients.
+ * @return Whether the file exists and was baked for the same mesh topology
+ * and settings.
+ */
+bool ReadRadianceTransfer(const std::string &filename, const TriangleMesh &mesh,
+                          std::vector<float> *transfer);
+
+/**
+ * @brief WriteRadianceTransfer Stores the per-vertex transfer next to the mesh
+ * so that it is only baked once.
+ * @param filename The path where the cache will be stored.
+ * @param mesh The mesh the coefficients were baked for.
+ * @param transfer The per-vertex coefficients.
+ * @return Whether it was able to store the file.
+ */
+bool WriteRadianceTransfer(const std::string &filename,
+                           const TriangleMesh &mesh,
+                           const std::vector<float> &transfer);
+
+}  // namespace data_representation
+
+#endif  //  AMBIENT_OCCLUSION_H_
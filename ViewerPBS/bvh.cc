@@ -0,0 +1,524 @@
+#include <bvh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+const int kBins = 16;
+const int kMaxLeafPackets = 4;
+const int kMaxSahDepth = 40;
+const int kStackSize = 96;
+const float kLengthEpsilon = 1e-30f;
+const float kDeterminantEpsilon = 1e-20f;
+
+struct Bounds {
+  Eigen::Vector3f min;
+  Eigen::Vector3f max;
+
+  Bounds()
+      : min(Eigen::Vector3f::Constant(std::numeric_limits<float>::max())),
+        max(Eigen::Vector3f::Constant(std::numeric_limits<float>::lowest())) {}
+
+  void Grow(const Eigen::Vector3f &p) {
+    min = min.cwiseMin(p);
+    max = max.cwiseMax(p);
+  }
+
+  void Grow(const Bounds &b) {
+    min = min.cwiseMin(b.min);
+    max = max.cwiseMax(b.max);
+  }
+
+  float HalfArea() const {
+    if (min[0] > max[0]) return 0.0f;
+    const Eigen::Vector3f kExtent = max - min;
+    return kExtent[0] * kExtent[1] + kExtent[1] * kExtent[2] +
+           kExtent[2] * kExtent[0];
+  }
+};
+
+}  // namespace
+
+struct Bvh::BuildTriangle {
+  Bounds bounds;
+  Eigen::Vector3f centroid;
+  int id;
+};
+
+Bvh::Bvh()
+    : min_(Eigen::Vector3f::Zero()), max_(Eigen::Vector3f::Zero()) {}
+
+void Bvh::Build(const TriangleMesh &mesh, const Eigen::Matrix4f &transform) {
+  nodes_.clear();
+  packets_.clear();
+
+  const int kVertices = static_cast<int>(mesh.vertices_.size() / 3);
+  std::vector<float> positions(mesh.vertices_.size());
+  concurrency::ParallelFor(kVertices, 4096, [&](int i) {
+    const Eigen::Vector4f kP =
+        transform * Eigen::Vector4f(mesh.vertices_[i * 3],
+                                    mesh.vertices_[i * 3 + 1],
+                                    mesh.vertices_[i * 3 + 2], 1.0f);
+    positions[i * 3] = kP[0];
+    positions[i * 3 + 1] = kP[1];
+    positions[i * 3 + 2] = kP[2];
+  });
+
+  const int kFaces = static_cast<int>(mesh.faces_.size() / 3);
+  std::vector<BuildTriangle> triangles(static_cast<size_t>(kFaces));
+  concurrency::ParallelFor(kFaces, 4096, [&](int i) {
+    BuildTriangle &triangle = triangles[i];
+    for (int j = 0; j < 3; ++j) {
+      const int kVertex = mesh.faces_[i * 3 + j];
+      triangle.bounds.Grow(Eigen::Vector3f(positions[kVertex * 3],
+                                           positions[kVertex * 3 + 1],
+                                           positions[kVertex * 3 + 2]));
+    }
+    triangle.centroid = (triangle.bounds.min + triangle.bounds.max) * 0.5f;
+    triangle.id = i;
+  });
+
+  Bounds scene;
+  for (const BuildTriangle &triangle : triangles) scene.Grow(triangle.bounds);
+  min_ = kFaces > 0 ? scene.min : Eigen::Vector3f::Zero();
+  max_ = kFaces > 0 ? scene.max : Eigen::Vector3f::Zero();
+
+  if (kFaces == 0) return;
+
+  nodes_.reserve(static_cast<size_t>(2 * kFaces / simd::kWidth + 1));
+  packets_.reserve(static_cast<size_t>(kFaces / simd::kWidth + 1));
+  BuildRecursive(&triangles, 0, kFaces, 0, positions, mesh.faces_);
+}
+
+int Bvh::BuildRecursive(std::vector<BuildTriangle> *triangles, int begin,
+                        int end, int depth,
+                        const std::vector<float> &positions,
+                        const std::vector<int> &faces) {
+  const int kIndex = static_cast<int>(nodes_.size());
+  nodes_.push_back(Node());
+
+  Bounds bounds, centroids;
+  for (int i = begin; i < end; ++i) {
+    bounds.Grow((*triangles)[i].bounds);
+    centroids.Grow((*triangles)[i].centroid);
+  }
+  for (int j = 0; j < 3; ++j) {
+    nodes_[kIndex].bounds_min[j] = bounds.min[j];
+    nodes_[kIndex].bounds_max[j] = bounds.max[j];
+  }
+
+  const int kCount = end - begin;
+  const int kPackets = (kCount + simd::kWidth - 1) / simd::kWidth;
+
+  // Binned SAH over the three axes.
+  int best_axis = -1, best_bin = 0;
+  float best_cost = std::numeric_limits<float>::max();
+  if (kCount > simd::kWidth && depth < kMaxSahDepth) {
+    for (int axis = 0; axis < 3; ++axis) {
+      const float kExtent = centroids.max[axis] - centroids.min[axis];
+      if (kExtent <= 0.0f) continue;
+      const float kScale = kBins / kExtent;
+
+      Bounds bin_bounds[kBins];
+      int bin_counts[kBins] = {0};
+      for (int i = begin; i < end; ++i) {
+        const BuildTriangle &triangle = (*triangles)[i];
+        int bin = static_cast<int>(
+            (triangle.centroid[axis] - centroids.min[axis]) * kScale);
+        bin = std::min(bin, kBins - 1);
+        bin_counts[bin]++;
+        bin_bounds[bin].Grow(triangle.bounds);
+      }
+
+      float right_area[kBins];
+      int right_count[kBins];
+      Bounds accumulated;
+      int count = 0;
+      for (int b = kBins - 1; b > 0; --b) {
+        accumulated.Grow(bin_bounds[b]);
+        count += bin_counts[b];
+        right_area[b] = accumulated.HalfArea();
+        right_count[b] = count;
+      }
+
+      accumulated = Bounds();
+      count = 0;
+      for (int b = 0; b < kBins - 1; ++b) {
+        accumulated.Grow(bin_bounds[b]);
+        count += bin_counts[b];
+        // Costs are counted in packets since that is what a leaf tests.
+        const float kCost =
+            accumulated.HalfArea() *
+                ((count + simd::kWidth - 1) / simd::kWidth) +
+            right_area[b + 1] *
+                ((right_count[b + 1] + simd::kWidth - 1) / simd::kWidth);
+        if (count > 0 && right_count[b + 1] > 0 && kCost < best_cost) {
+          best_cost = kCost;
+          best_axis = axis;
+          best_bin = b;
+        }
+      }
+    }
+  }
+
+  const float kLeafCost = bounds.HalfArea() * kPackets;
+  const bool kMakeLeaf =
+      kCount <= simd::kWidth ||
+      (kPackets <= kMaxLeafPackets && best_axis >= 0 && best_cost >= kLeafCost);
+
+  if (kMakeLeaf) {
+    nodes_[kIndex].first = static_cast<int>(packets_.size());
+    nodes_[kIndex].count = kPackets;
+    for (int p = 0; p < kPackets; ++p) {
+      TrianglePacket packet;
+      for (int lane = 0; lane < simd::kWidth; ++lane) {
+        const int kTriangle = begin + p * simd::kWidth + lane;
+        if (kTriangle >= end) {
+          for (int j = 0; j < 3; ++j) {
+            packet.v0[j][lane] = packet.v0[j][0];
+            packet.e1[j][lane] = 0.0f;
+            packet.e2[j][lane] = 0.0f;
+          }
+          packet.id[lane] = -1;
+          continue;
+        }
+        const int kId = (*triangles)[kTriangle].id;
+        const int kV0 = faces[kId * 3], kV1 = faces[kId * 3 + 1],
+                  kV2 = faces[kId * 3 + 2];
+        for (int j = 0; j < 3; ++j) {
+          packet.v0[j][lane] = positions[kV0 * 3 + j];
+          packet.e1[j][lane] = positions[kV1 * 3 + j] - positions[kV0 * 3 + j];
+          packet.e2[j][lane] = positions[kV2 * 3 + j] - positions[kV0 * 3 + j];
+        }
+        packet.id[lane] = kId;
+      }
+      packets_.push_back(packet);
+    }
+    return kIndex;
+  }
+
+  int mid;
+  if (best_axis >= 0) {
+    const float kScale =
+        kBins / (centroids.max[best_axis] - centroids.min[best_axis]);
+    const float kMinimum = centroids.min[best_axis];
+    mid = static_cast<int>(
+        std::partition(triangles->begin() + begin, triangles->begin() + end,
+                       [&](const BuildTriangle &triangle) {
+                         int bin = static_cast<int>(
+                             (triangle.centroid[best_axis] - kMinimum) *
+                             kScale);
+                         return std::min(bin, kBins - 1) <= best_bin;
+                       }) -
+        triangles->begin());
+  } else {
+    // Coincident centroids or too deep: fall back to a median split along
+    // the widest axis, which keeps the depth logarithmic.
+    const Eigen::Vector3f kExtent = centroids.max - centroids.min;
+    int axis = 0;
+    if (kExtent[1] > kExtent[axis]) axis = 1;
+    if (kExtent[2] > kExtent[axis]) axis = 2;
+    mid = begin + kCount / 2;
+    std::nth_element(triangles->begin() + begin, triangles->begin() + mid,
+                     triangles->begin() + end,
+                     [axis](const BuildTriangle &a, const BuildTriangle &b) {
+                       return a.centroid[axis] < b.centroid[axis];
+                     });
+  }
+
+  BuildRecursive(triangles, begin, mid, depth + 1, positions, faces);
+  const int kRight =
+      BuildRecursive(triangles, mid, end, depth + 1, positions, faces);
+
+  nodes_[kIndex].first = kRight;
+  nodes_[kIndex].count = 0;
+  return kIndex;
+}
+
+namespace {
+
+inline bool IntersectBox(const float *bounds_min, const float *bounds_max,
+                         const Eigen::Vector3f &origin,
+                         const Eigen::Vector3f &inverse_direction,
+                         float t_min, float t_max, float *t_entry) {
+  float t0 = t_min, t1 = t_max;
+  for (int j = 0; j < 3; ++j) {
+    float near = (bounds_min[j] - origin[j]) * inverse_direction[j];
+    float far = (bounds_max[j] - origin[j]) * inverse_direction[j];
+    if (near > far) std::swap(near, far);
+    // Written so that NaNs (0 * inf) leave the interval untouched.
+    t0 = near > t0 ? near : t0;
+    t1 = far < t1 ? far : t1;
+  }
+  *t_entry = t0;
+  return t0 <= t1;
+}
+
+}  // namespace
+
+template <bool kAnyHit>
+bool Bvh::Traverse(const Ray &ray, RayHit *hit) const {
+  if (nodes_.empty()) return false;
+
+  const Eigen::Vector3f kInverseDirection = ray.direction.cwiseInverse();
+
+  float t_entry;
+  if (!IntersectBox(nodes_[0].bounds_min, nodes_[0].bounds_max, ray.origin,
+                    kInverseDirection, ray.t_min, ray.t_max, &t_entry))
+    return false;
+
+  const simd::Float kOx(ray.origin[0]), kOy(ray.origin[1]),
+      kOz(ray.origin[2]);
+  const simd::Float kDx(ray.direction[0]), kDy(ray.direction[1]),
+      kDz(ray.direction[2]);
+  const simd::Float kTMin(ray.t_min), kZero(0.0f), kOne(1.0f),
+      kEpsilon(kDeterminantEpsilon), kMinusEpsilon(-kDeterminantEpsilon);
+
+  float t_best = ray.t_max;
+  bool found = false;
+
+  int stack[kStackSize];
+  float stack_entry[kStackSize];
+  int stack_size = 0;
+  int node_index = 0;
+
+  while (true) {
+    const Node &node = nodes_[node_index];
+    if (node.count > 0) {
+      for (int p = node.first; p < node.first + node.count; ++p) {
+        const TrianglePacket &packet = packets_[p];
+        const simd::Float kE1x = simd::Load(packet.e1[0]),
+                          kE1y = simd::Load(packet.e1[1]),
+                          kE1z = simd::Load(packet.e1[2]);
+        const simd::Float kE2x = simd::Load(packet.e2[0]),
+                          kE2y = simd::Load(packet.e2[1]),
+                          kE2z = simd::Load(packet.e2[2]);
+
+        const simd::Float kPx = kDy * kE2z - kDz * kE2y;
+        const simd::Float kPy = kDz * kE2x - kDx * kE2z;
+        const simd::Float kPz = kDx * kE2y - kDy * kE2x;
+        const simd::Float kDeterminant = kE1x * kPx + kE1y * kPy + kE1z * kPz;
+        const simd::Float kInverse = kOne / kDeterminant;
+
+        const simd::Float kTx = kOx - simd::Load(packet.v0[0]);
+        const simd::Float kTy = kOy - simd::Load(packet.v0[1]);
+        const simd::Float kTz = kOz - simd::Load(packet.v0[2]);
+        const simd::Float kU = (kTx * kPx + kTy * kPy + kTz * kPz) * kInverse;
+
+        const simd::Float kQx = kTy * kE1z - kTz * kE1y;
+        const simd::Float kQy = kTz * kE1x - kTx * kE1z;
+        const simd::Float kQz = kTx * kE1y - kTy * kE1x;
+        const simd::Float kV = (kDx * kQx + kDy * kQy + kDz * kQz) * kInverse;
+        const simd::Float kT =
+            (kE2x * kQx + kE2y * kQy + kE2z * kQz) * kInverse;
+
+        const simd::Mask kValid =
+            (kDeterminant > kEpsilon | kDeterminant < kMinusEpsilon) &
+            (kU >= kZero) & (kV >= kZero) & (kU + kV <= kOne) &
+            (kT > kTMin) & (kT < simd::Float(t_best));
+        const int kBits = simd::MoveMask(kValid);
+        if (kBits == 0) continue;
+
+        if (kAnyHit) return true;
+
+        float t[simd::kWidth], u[simd::kWidth], v[simd::kWidth];
+        simd::Store(t, kT);
+        simd::Store(u, kU);
+        simd::Store(v, kV);
+        for (int lane = 0; lane < simd::kWidth; ++lane) {
+          if (((kBits >> lane) & 1) && t[lane] < t_best) {
+            t_best = t[lane];
+            hit->t = t[lane];
+            hit->u = u[lane];
+            hit->v = v[lane];
+            hit->triangle = packet.id[lane];
+            found = true;
+          }
+        }
+      }
+    } else {
+      int near_child = node_index + 1, far_child = node.first;
+      float near_entry, far_entry;
+      bool near_hit = IntersectBox(
+          nodes_[near_child].bounds_min, nodes_[near_child].bounds_max,
+          ray.origin, kInverseDirection, ray.t_min, t_best, &near_entry);
+      bool far_hit = IntersectBox(
+          nodes_[far_child].bounds_min, nodes_[far_child].bounds_max,
+          ray.origin, kInverseDirection, ray.t_min, t_best, &far_entry);
+      if (near_hit && far_hit) {
+        if (far_entry < near_entry) {
+          std::swap(near_child, far_child);
+          std::swap(near_entry, far_entry);
+        }
+        stack[stack_size] = far_child;
+        stack_entry[stack_size] = far_entry;
+        ++stack_size;
+        node_index = near_child;
+        continue;
+      }
+      if (near_hit) {
+        node_index = near_child;
+        continue;
+      }
+      if (far_hit) {
+        node_index = far_child;
+        continue;
+      }
+    }
+
+    // Pop, skipping subtrees that start beyond the closest hit so far.
+    do {
+      if (stack_size == 0) return found;
+      --stack_size;
+    } while (stack_entry[stack_size] > t_best);
+    node_index = stack[stack_size];
+  }
+}
+
+bool Bvh::Intersect(const Ray &ray, RayHit *hit) const {
+  return Traverse<false>(ray, hit);
+}
+
+bool Bvh::Occluded(const Ray &ray) const {
+  return Traverse<true>(ray, nullptr);
+}
+
+namespace {
+
+inline float BoxDistanceSquared(const float *bounds_min,
+                                const float *bounds_max,
+                                const Eigen::Vector3f &point) {
+  float distance = 0.0f;
+  for (int j = 0; j < 3; ++j) {
+    const float kOutside = std::max(
+        std::max(bounds_min[j] - point[j], point[j] - bounds_max[j]), 0.0f);
+    distance += kOutside * kOutside;
+  }
+  return distance;
+}
+
+inline simd::Float Dot(const simd::Float *a, const simd::Float *b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline void Cross(const simd::Float *a, const simd::Float *b,
+                  simd::Float *c) {
+  c[0] = a[1] * b[2] - a[2] * b[1];
+  c[1] = a[2] * b[0] - a[0] * b[2];
+  c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+/**
+ * @brief SegmentDistanceSquared Squared distance from a point to the segment
+ * starting at the origin of p (p is the point minus the segment start).
+ */
+inline simd::Float SegmentDistanceSquared(const simd::Float *edge,
+                                          const simd::Float *p) {
+  const simd::Float kLength =
+      simd::Max(Dot(edge, edge), simd::Float(kLengthEpsilon));
+  const simd::Float kH = simd::Clamp(Dot(edge, p) / kLength,
+                                     simd::Float(0.0f), simd::Float(1.0f));
+  simd::Float d[3];
+  for (int j = 0; j < 3; ++j) d[j] = edge[j] * kH - p[j];
+  return Dot(d, d);
+}
+
+}  // namespace
+
+float Bvh::Distance(const Eigen::Vector3f &point, float max_distance) const {
+  if (nodes_.empty()) return max_distance;
+
+  float best = max_distance * max_distance;
+  if (BoxDistanceSquared(nodes_[0].bounds_min, nodes_[0].bounds_max, point) >=
+      best)
+    return max_distance;
+
+  const simd::Float kZero(0.0f), kEpsilon(kLengthEpsilon);
+
+  int stack[kStackSize];
+  float stack_distance[kStackSize];
+  int stack_size = 0;
+  int node_index = 0;
+
+  while (true) {
+    const Node &node = nodes_[node_index];
+    if (node.count > 0) {
+      for (int p = node.first; p < node.first + node.count; ++p) {
+        const TrianglePacket &packet = packets_[p];
+        // Edges a->b, b->c and c->a and the point relative to their starts.
+        simd::Float ba[3], cb[3], ac[3], pa[3], pb[3], pc[3];
+        for (int j = 0; j < 3; ++j) {
+          const simd::Float kE1 = simd::Load(packet.e1[j]);
+          const simd::Float kE2 = simd::Load(packet.e2[j]);
+          ba[j] = kE1;
+          cb[j] = kE2 - kE1;
+          ac[j] = kZero - kE2;
+          pa[j] = simd::Float(point[j]) - simd::Load(packet.v0[j]);
+          pb[j] = pa[j] - kE1;
+          pc[j] = pa[j] - kE2;
+        }
+
+        simd::Float normal[3], side[3];
+        Cross(ba, ac, normal);
+        const simd::Float kNormalLength = Dot(normal, normal);
+
+        // The point projects inside the triangle when it is on the inner
+        // side of the three edges; degenerate triangles only have edges.
+        Cross(ba, normal, side);
+        simd::Mask inside = Dot(side, pa) >= kZero;
+        Cross(cb, normal, side);
+        inside = inside & (Dot(side, pb) >= kZero);
+        Cross(ac, normal, side);
+        inside = inside & (Dot(side, pc) >= kZero) & (kNormalLength > kEpsilon);
+
+        const simd::Float kPlane = Dot(normal, pa);
+        const simd::Float kFace =
+            kPlane * kPlane / simd::Max(kNormalLength, kEpsilon);
+        const simd::Float kEdges =
+            simd::Min(simd::Min(SegmentDistanceSquared(ba, pa),
+                                SegmentDistanceSquared(cb, pb)),
+                      SegmentDistanceSquared(ac, pc));
+        const simd::Float kDistance = simd::Select(inside, kFace, kEdges);
+        float distance[simd::kWidth];
+        simd::Store(distance, kDistance);
+        for (int lane = 0; lane < simd::kWidth; ++lane)
+          best = std::min(best, distance[lane]);
+      }
+    } else {
+      int near_child = node_index + 1, far_child = node.first;
+      float near_distance =
+          BoxDistanceSquared(nodes_[near_child].bounds_min,
+                             nodes_[near_child].bounds_max, point);
+      float far_distance =
+          BoxDistanceSquared(nodes_[far_child].bounds_min,
+                             nodes_[far_child].bounds_max, point);
+      if (far_distance < near_distance) {
+        std::swap(near_child, far_child);
+        std::swap(near_distance, far_distance);
+      }
+      if (far_distance < best) {
+        stack[stack_size] = far_child;
+        stack_distance[stack_size] = far_distance;
+        ++stack_size;
+      }
+      if (near_distance < best) {
+        node_index = near_child;
+        continue;
+      }
+    }
+
+    // Pop, skipping subtrees farther than the closest triangle so far.
+    do {
+      if (stack_size == 0) return std::sqrt(best);
+    } while (stack_distance[--stack_size] >= best);
+    node_index = stack[stack_size];
+  }
+}
+
+}  // namespace data_representation
@@ -0,0 +1,152 @@
+#ifndef BVH_H_
+#define BVH_H_
+
+#include <Eigen/Geometry>
+
+#include <vector>
+
+#include "./simd.h"
+#include "./triangle_mesh.h"
+
+namespace data_representation {
+
+/**
+ * @brief Ray A ray origin + t * direction restricted to [t_min, t_max].
+ */
+struct Ray {
+  Eigen::Vector3f origin;
+  Eigen::Vector3f direction;
+  float t_min;
+  float t_max;
+};
+
+/**
+ * @brief RayHit Closest intersection found by Bvh::Intersect.
+ */
+struct RayHit {
+  /**
+   * @brief t Ray parameter of the hit.
+   */
+  float t;
+
+  /**
+   * @brief triangle Index of the hit face in TriangleMesh::faces_ / 3.
+   */
+  int triangle;
+
+  /**
+   * @brief u, v Barycentric coordinates of the hit with respect to the second
+   * and third vertex of the face.
+   */
+  float u, v;
+};
+
+/**
+ * @brief Bvh Bounding volume hierarchy over the triangles of a TriangleMesh,
+ * built with a binned surface area heuristic. Leaves store their triangles in
+ * packets of simd::kWidth so that one ray is tested against a whole leaf with
+ * a single vectorized Moller-Trumbore test. The structure is immutable after
+ * Build and can be queried from any number of threads.
+ */
+class Bvh {
+ public:
+  /**
+   * @brief Bvh Constructor of the class. The hierarchy is empty until Build.
+   */
+  Bvh();
+
+  /**
+   * @brief Build Builds the hierarchy over the faces of mesh.
+   * @param mesh The triangle mesh.
+   * @param transform Transform applied to the vertices before building, e.g.
+   * the modeling transform returned by Camera::SetModel.
+   */
+  void Build(const TriangleMesh &mesh,
+             const Eigen::Matrix4f &transform = Eigen::Matrix4f::Identity());
+
+  /**
+   * @brief Intersect Finds the closest intersection along the ray.
+   * @param ray The query ray.
+   * @param hit The closest hit, only written when there is one.
+   * @return Whether the ray hits any triangle in [t_min, t_max].
+   */
+  bool Intersect(const Ray &ray, RayHit *hit) const;
+
+  /**
+   * @brief Occluded Any-hit query, cheaper than Intersect for shadow and
+   * visibility rays.
+   * @param ray The query ray.
+   * @return Whether the ray hits any triangle in [t_min, t_max].
+   */
+  bool Occluded(const Ray &ray) const;
+
+  /**
+   * @brief Distance Unsigned distance from a point to the closest triangle,
+   * pruning the nodes that are farther than the closest triangle found so
+   * far.
+   * @param point The query point.
+   * @param max_distance Distances are clamped to this value, which also
+   * bounds the search.
+   * @return The distance, at most max_distance.
+   */
+  float Distance(const Eigen::Vector3f &point, float max_distance) const;
+
+  /**
+   * @brief Empty Whether the hierarchy contains no triangles.
+   */
+  bool Empty() const { return nodes_.empty(); }
+
+  /**
+   * @brief min Minimum point of the transformed geometry bounding box.
+   */
+  const Eigen::Vector3f &min() const { return min_; }
+
+  /**
+   * @brief max Maximum point of the transformed geometry bounding box.
+   */
+  const Eigen::Vector3f &max() const { return max_; }
+
+ private:
+  /**
+   * @brief Node Interior nodes have count == 0, their left child is the next
+   * node and their right child is at index first. Leaves reference count
+   * consecutive packets starting at first.
+   */
+  struct Node {
+    float bounds_min[3];
+    int first;
+    float bounds_max[3];
+    int count;
+  };
+
+  /**
+   * @brief TrianglePacket Up to simd::kWidth triangles in structure of arrays
+   * layout, as a vertex and two edges. Unused lanes have id -1, zero edges
+   * and the vertex of the first lane, so they can never report a hit nor be
+   * closer to a point than a real triangle.
+   */
+  struct TrianglePacket {
+    float v0[3][simd::kWidth];
+    float e1[3][simd::kWidth];
+    float e2[3][simd::kWidth];
+    int id[simd::kWidth];
+  };
+
+  struct BuildTriangle;
+
+  int BuildRecursive(std::vector<BuildTriangle> *triangles, int begin,
+                     int end, int depth, const std::vector<float> &positions,
+                     const std::vector<int> &faces);
+
+  template <bool kAnyHit>
+  bool Traverse(const Ray &ray, RayHit *hit) const;
+
+  std::vector<Node> nodes_;
+  std::vector<TrianglePacket> packets_;
+  Eigen::Vector3f min_;
+  Eigen::Vector3f max_;
+};
+
+}  // namespace data_representation
+
+#endif  //  BVH_H_
@@ -57,6 +57,13 @@ void Camera::SetViewport() const {
   glViewport(viewport_x_, viewport_y_, viewport_width_, viewport_height_);
 }
 
+void Camera::SetViewportSize(int w, int h) {
+  viewport_x_ = 0;
+  viewport_y_ = 0;
+  viewport_width_ = w;
+  viewport_height_ = h;
+}
+
 Eigen::Matrix4f Camera::SetIdentity() const {
   Eigen::Matrix4f identity;
   identity << 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1;
@@ -18,6 +18,10 @@ const double MaxRotationX = M_PI / 2;
 
 const double AngleIncrement = 0.01;
 
+const double kFieldOfView = 60;
+const double kZNear = 0.3;
+const double kZFar = 2;
+
 class Camera {
  private:
   /**
@@ -164,6 +168,14 @@ class Camera {
    */
   void SetViewport() const;
 
+  /**
+   * @brief SetViewportSize Stores the viewport width and height without
+   * calling glViewport, for computing matrices without a GL context.
+   * @param w Viewport width.
+   * @param h Viewport height.
+   */
+  void SetViewportSize(int w, int h);
+
   /**
    * @brief SetIdentity Returns an identity matrix.
    * @return An identity matrix.
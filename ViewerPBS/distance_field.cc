@@ -0,0 +1,119 @@
+#include <distance_field.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+DistanceField::DistanceField()
+    : size_(Eigen::Vector3i::Zero()),
+      min_(Eigen::Vector3f::Zero()),
+      max_(Eigen::Vector3f::Zero()),
+      voxel_size_(0.0f) {}
+
+Eigen::Vector3f DistanceField::VoxelPosition(int x, int y, int z) const {
+  return min_ + Eigen::Vector3f(x, y, z) * voxel_size_;
+}
+
+void DistanceField::Build(const TriangleMesh &mesh, const Bvh &bvh,
+                          const DistanceFieldSettings &settings) {
+  const Eigen::Vector3f kExtent = mesh.max_ - mesh.min_;
+  const float kLongest = kExtent.maxCoeff();
+  const float kMargin = kLongest * settings.margin;
+  voxel_size_ =
+      (kLongest + 2.0f * kMargin) / std::max(1, settings.resolution - 1);
+  min_ = mesh.min_ - Eigen::Vector3f::Constant(kMargin);
+  for (int axis = 0; axis < 3; ++axis)
+    size_[axis] = std::max(
+        2, static_cast<int>(std::ceil((kExtent[axis] + 2.0f * kMargin) /
+                                      voxel_size_)) +
+               1);
+  max_ = min_ + (size_ - Eigen::Vector3i::Ones()).cast<float>() * voxel_size_;
+
+  const int kVoxels = size_.prod();
+  const float kEpsilon = kLongest * 1e-5f;
+
+  // Sign: every row of voxels along an axis shares a single ray walked from
+  // hit to hit. A voxel votes inside when the next triangle along the row
+  // faces away from the ray.
+  std::vector<unsigned char> votes(static_cast<size_t>(kVoxels), 0);
+  for (int axis = 0; axis < 3; ++axis) {
+    const int kU = (axis + 1) % 3, kV = (axis + 2) % 3;
+    const int kLength = size_[axis];
+    const int kStride[3] = {1, size_[0], size_[0] * size_[1]};
+    concurrency::ParallelFor(size_[kU] * size_[kV], 16, [&](int row) {
+      int start[3];
+      start[axis] = 0;
+      start[kU] = row % size_[kU];
+      start[kV] = row / size_[kU];
+      const int kFirst = start[0] * kStride[0] + start[1] * kStride[1] +
+                         start[2] * kStride[2];
+
+      Ray ray;
+      ray.origin = VoxelPosition(start[0], start[1], start[2]);
+      ray.direction = Eigen::Vector3f::Zero();
+      ray.direction[axis] = 1.0f;
+      ray.t_max = std::numeric_limits<float>::max();
+
+      float t_min = -kEpsilon;
+      int voxel = 0;
+      RayHit hit;
+      while (voxel < kLength) {
+        ray.t_min = t_min;
+        if (!bvh.Intersect(ray, &hit)) break;
+
+        const int *kFace = &mesh.faces_[static_cast<size_t>(hit.triangle * 3)];
+        const Eigen::Vector3f kV0(&mesh.vertices_[kFace[0] * 3]);
+        const Eigen::Vector3f kV1(&mesh.vertices_[kFace[1] * 3]);
+        const Eigen::Vector3f kV2(&mesh.vertices_[kFace[2] * 3]);
+        const bool kLeaving = (kV1 - kV0).cross(kV2 - kV0)[axis] > 0.0f;
+        for (; voxel < kLength && voxel * voxel_size_ < hit.t; ++voxel)
+          if (kLeaving) ++votes[kFirst + voxel * kStride[axis]];
+        t_min = hit.t + kEpsilon;
+      }
+    });
+  }
+
+  // Distance: closest point query, bounded by the narrow band.
+  const float kBand = settings.band * voxel_size_;
+  distances_.resize(static_cast<size_t>(kVoxels));
+  concurrency::ParallelFor(kVoxels, 64, [&](int i) {
+    const int kX = i % size_[0];
+    const int kY = (i / size_[0]) % size_[1];
+    const int kZ = i / (size_[0] * size_[1]);
+    const float kDistance = bvh.Distance(VoxelPosition(kX, kY, kZ), kBand);
+    distances_[i] = votes[i] >= 2 ? -kDistance : kDistance;
+  });
+}
+
+float DistanceField::Sample(const Eigen::Vector3f &position) const {
+  if (Empty()) return 0.0f;
+
+  int base[3];
+  float fraction[3];
+  for (int axis = 0; axis < 3; ++axis) {
+    const float kCoordinate =
+        std::min(std::max((position[axis] - min_[axis]) / voxel_size_, 0.0f),
+                 static_cast<float>(size_[axis] - 1));
+    base[axis] = std::min(static_cast<int>(kCoordinate), size_[axis] - 2);
+    fraction[axis] = kCoordinate - base[axis];
+  }
+
+  float distance = 0.0f;
+  for (int corner = 0; corner < 8; ++corner) {
+    float weight = 1.0f;
+    int index = 0;
+    for (int axis = 2; axis >= 0; --axis) {
+      const int kOffset = (corner >> axis) & 1;
+      weight *= kOffset ? fraction[axis] : 1.0f - fraction[axis];
+      index = index * size_[axis] + base[axis] + kOffset;
+    }
+    distance += distances_[static_cast<size_t>(index)] * weight;
+  }
+  return distance;
+}
+
+}  // namespace data_representation
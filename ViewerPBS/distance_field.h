@@ -0,0 +1,98 @@
+#ifndef DISTANCE_FIELD_H_
+#define DISTANCE_FIELD_H_
+
+#include <Eigen/Geometry>
+
+#include <vector>
+
+#include "./bvh.h"
+#include "./triangle_mesh.h"
+
+namespace data_representation {
+
+/**
+ * @brief DistanceFieldSettings Parameters of the distance field generation.
+ */
+struct DistanceFieldSettings {
+  /**
+   * @brief resolution Voxels along the longest side of the grid. The other
+   * sides keep the same spacing, with at least two voxels.
+   */
+  int resolution = 64;
+
+  /**
+   * @brief band Half width of the narrow band, in voxels. Distances beyond
+   * it are clamped, keeping their sign.
+   */
+  float band = 4.0f;
+
+  /**
+   * @brief margin Padding around the mesh bounding box, relative to its
+   * longest edge, so that the field is positive at the grid border.
+   */
+  float margin = 0.1f;
+};
+
+/**
+ * @brief DistanceField Narrow band signed distance field of a mesh sampled on
+ * a regular grid over its bounds, in object space, negative inside. Samples
+ * lie at the voxel centers, as read from a GL_LINEAR 3D texture.
+ */
+class DistanceField {
+ public:
+  /**
+   * @brief DistanceField Constructor of the class. The field is empty until
+   * built.
+   */
+  DistanceField();
+
+  /**
+   * @brief Build Computes the field, distributing voxels over all cores. The
+   * distance is the closest point query of the hierarchy and the sign is the
+   * majority vote of three axis aligned rays, inside meaning that the first
+   * triangle hit is seen from its back.
+   * @param mesh The mesh.
+   * @param bvh Hierarchy built over mesh with the identity transform.
+   * @param settings The generation parameters.
+   */
+  void Build(const TriangleMesh &mesh, const Bvh &bvh,
+             const DistanceFieldSettings &settings);
+
+  /**
+   * @brief Sample Trilinearly interpolated distance, clamped to the grid.
+   * @param position Point in object space.
+   */
+  float Sample(const Eigen::Vector3f &position) const;
+
+  /**
+   * @brief texels The distances of the voxels, x varying fastest, ready to
+   * be uploaded as a single channel 3D texture.
+   */
+  const std::vector<float> &texels() const { return distances_; }
+
+  /**
+   * @brief Empty Whether the field has not been built.
+   */
+  bool Empty() const { return distances_.empty(); }
+
+  const Eigen::Vector3i &size() const { return size_; }
+  const Eigen::Vector3f &min() const { return min_; }
+  const Eigen::Vector3f &max() const { return max_; }
+
+  /**
+   * @brief voxel_size Spacing between two samples.
+   */
+  float voxel_size() const { return voxel_size_; }
+
+ private:
+  Eigen::Vector3f VoxelPosition(int x, int y, int z) const;
+
+  Eigen::Vector3i size_;
+  Eigen::Vector3f min_, max_;
+  float voxel_size_;
+  std::vector<float> distances_;
+};
+
+}  // namespace data_representation
+
+#endif  //  DISTANCE_FIELD_H_
@@ -0,0 +1,238 @@
+#include <environment_map.h>
+
+#include <QImage>
+
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+namespace data_visualization {
+
+namespace {
+
+// Same order as the GL_TEXTURE_CUBE_MAP_POSITIVE_X + i targets used by
+// GLWidget::BakeSkyboxMap.
+const char *const kFaceFiles[6] = {"/right.png", "/left.png",
+                                   "/top.png",   "/bottom.png",
+                                   "/back.png",  "/front.png"};
+
+/**
+ * @brief FaceDirection Inverse of the cube map face selection: the
+ * (unnormalized) direction that maps to face coordinates sc, tc in [-1, 1].
+ */
+Eigen::Vector3f FaceDirection(int face, float sc, float tc) {
+  switch (face) {
+    case 0:
+      return Eigen::Vector3f(1.0f, -tc, -sc);
+    case 1:
+      return Eigen::Vector3f(-1.0f, -tc, sc);
+    case 2:
+      return Eigen::Vector3f(sc, 1.0f, tc);
+    case 3:
+      return Eigen::Vector3f(sc, -1.0f, -tc);
+    case 4:
+      return Eigen::Vector3f(sc, -tc, 1.0f);
+    default:
+      return Eigen::Vector3f(-sc, -tc, -1.0f);
+  }
+}
+
+float Luminance(const Eigen::Vector3f &c) {
+  return 0.2126f * c[0] + 0.7152f * c[1] + 0.0722f * c[2];
+}
+
+}  // namespace
+
+EnvironmentMap::EnvironmentMap() : size_(0), total_weight_(0.0f) {}
+
+bool EnvironmentMap::Load(const std::string &directory) {
+  for (int face = 0; face < 6; ++face) {
+    QImage image;
+    if (!image.load((directory + kFaceFiles[face]).c_str())) return false;
+    image = image.convertToFormat(QImage::Format_RGB888);
+    if (image.width() != image.height()) return false;
+
+    // Row 0 of the image is uploaded first by UploadImage, i.e. it is t = 0.
+    const int kSize = image.width();
+    std::vector<float> texels(static_cast<size_t>(kSize * kSize * 3));
+    for (int y = 0; y < kSize; ++y) {
+      const unsigned char *row = image.constScanLine(y);
+      for (int x = 0; x < kSize * 3; ++x)
+        texels[static_cast<size_t>(y * kSize * 3 + x)] = row[x] / 255.0f;
+    }
+    SetFace(face, kSize, texels);
+  }
+
+  BuildDistribution();
+  return true;
+}
+
+void EnvironmentMap::SetFace(int face, int size, const std::vector<float> &texels) {
+  size_ = size;
+  faces_[face] = texels;
+}
+
+void EnvironmentMap::BuildDistribution() {
+  const int kTexels = 6 * size_ * size_;
+  texel_weights_.resize(static_cast<size_t>(kTexels));
+  cdf_.resize(static_cast<size_t>(kTexels));
+
+  const float kTexelSize = 2.0f / size_;
+  float sum = 0.0f;
+  for (int face = 0; face < 6; ++face) {
+    for (int y = 0; y < size_; ++y) {
+      for (int x = 0; x < size_; ++x) {
+        const float kSc = (x + 0.5f) * kTexelSize - 1.0f;
+        const float kTc = (y + 0.5f) * kTexelSize - 1.0f;
+        const float kSolidAngle =
+            kTexelSize * kTexelSize /
+            std::pow(1.0f + kSc * kSc + kTc * kTc, 1.5f);
+        // A small floor keeps dark texels reachable so that the estimator
+        // stays unbiased when the BSDF, not the map, dominates.
+        const float kWeight =
+            (Luminance(Texel(face, x, y)) + 1e-3f) * kSolidAngle;
+        const int kIndex = (face * size_ + y) * size_ + x;
+        texel_weights_[kIndex] = kWeight;
+        sum += kWeight;
+        cdf_[kIndex] = sum;
+      }
+    }
+  }
+  total_weight_ = sum;
+}
+
+void EnvironmentMap::ProjectSh(
+    std::vector<Eigen::Vector3f> *coefficients) const {
+  coefficients->assign(data_representation::kShCoefficients,
+                       Eigen::Vector3f::Zero());
+  const float kTexelSize = 2.0f / size_;
+  float total_solid_angle = 0.0f;
+  for (int face = 0; face < 6 && size_ > 0; ++face) {
+    for (int y = 0; y < size_; ++y) {
+      for (int x = 0; x < size_; ++x) {
+        const float kSc = (x + 0.5f) * kTexelSize - 1.0f;
+        const float kTc = (y + 0.5f) * kTexelSize - 1.0f;
+        const float kSolidAngle =
+            kTexelSize * kTexelSize /
+            std::pow(1.0f + kSc * kSc + kTc * kTc, 1.5f);
+        float sh[data_representation::kShCoefficients];
+        data_representation::EvaluateSh(
+            FaceDirection(face, kSc, kTc).normalized(), sh);
+        const Eigen::Vector3f kRadiance = Texel(face, x, y) * kSolidAngle;
+        for (int c = 0; c < data_representation::kShCoefficients; ++c)
+          (*coefficients)[static_cast<size_t>(c)] += kRadiance * sh[c];
+        total_solid_angle += kSolidAngle;
+      }
+    }
+  }
+
+  // The texel solid angles are approximate; normalize them to the sphere.
+  if (total_solid_angle > 0.0f)
+    for (Eigen::Vector3f &coefficient : *coefficients)
+      coefficient *= static_cast<float>(4.0 * M_PI) / total_solid_angle;
+}
+
+Eigen::Vector3f EnvironmentMap::Texel(int face, int x, int y) const {
+  const float *texel = &faces_[face][static_cast<size_t>((y * size_ + x) * 3)];
+  return Eigen::Vector3f(texel[0], texel[1], texel[2]);
+}
+
+void EnvironmentMap::FaceCoordinates(const Eigen::Vector3f &direction,
+                                     int *face, float *s, float *t) const {
+  const Eigen::Vector3f kAbs = direction.cwiseAbs();
+  float sc, tc, ma;
+  if (kAbs[0] >= kAbs[1] && kAbs[0] >= kAbs[2]) {
+    ma = kAbs[0];
+    *face = direction[0] >= 0.0f ? 0 : 1;
+    sc = direction[0] >= 0.0f ? -direction[2] : direction[2];
+    tc = -direction[1];
+  } else if (kAbs[1] >= kAbs[2]) {
+    ma = kAbs[1];
+    *face = direction[1] >= 0.0f ? 2 : 3;
+    sc = direction[0];
+    tc = direction[1] >= 0.0f ? direction[2] : -direction[2];
+  } else {
+    ma = kAbs[2];
+    *face = direction[2] >= 0.0f ? 4 : 5;
+    sc = direction[2] >= 0.0f ? direction[0] : -direction[0];
+    tc = -direction[1];
+  }
+  *s = 0.5f * (sc / ma + 1.0f);
+  *t = 0.5f * (tc / ma + 1.0f);
+}
+
+Eigen::Vector3f EnvironmentMap::Lookup(const Eigen::Vector3f &direction) const {
+  if (size_ == 0) return Eigen::Vector3f::Zero();
+
+  int face;
+  float s, t;
+  FaceCoordinates(direction, &face, &s, &t);
+
+  const float kX = std::min(std::max(s * size_ - 0.5f, 0.0f), size_ - 1.0f);
+  const float kY = std::min(std::max(t * size_ - 0.5f, 0.0f), size_ - 1.0f);
+  const int kX0 = static_cast<int>(kX), kY0 = static_cast<int>(kY);
+  const int kX1 = std::min(kX0 + 1, size_ - 1),
+            kY1 = std::min(kY0 + 1, size_ - 1);
+  const float kFx = kX - kX0, kFy = kY - kY0;
+
+  return (Texel(face, kX0, kY0) * (1.0f - kFx) + Texel(face, kX1, kY0) * kFx) *
+             (1.0f - kFy) +
+         (Texel(face, kX0, kY1) * (1.0f - kFx) + Texel(face, kX1, kY1) * kFx) *
+             kFy;
+}
+
+Eigen::Vector3f EnvironmentMap::Sample(float u1, float u2,
+                                       Eigen::Vector3f *direction,
+                                       float *pdf) const {
+  if (size_ == 0 || total_weight_ <= 0.0f) {
+    *pdf = 0.0f;
+    return Eigen::Vector3f::Zero();
+  }
+
+  const float kTarget = u1 * total_weight_;
+  const int kIndex = std::min(
+      static_cast<int>(std::upper_bound(cdf_.begin(), cdf_.end(), kTarget) -
+                       cdf_.begin()),
+      static_cast<int>(cdf_.size()) - 1);
+
+  // Reuse the remainder of u1 as the position inside the texel.
+  const float kLower = kIndex > 0 ? cdf_[kIndex - 1] : 0.0f;
+  const float kJitter = std::min(
+      (kTarget - kLower) / std::max(texel_weights_[kIndex], 1e-20f), 0.9999f);
+
+  const int kFace = kIndex / (size_ * size_);
+  const int kY = (kIndex / size_) % size_;
+  const int kX = kIndex % size_;
+  const float kTexelSize = 2.0f / size_;
+  const float kSc = (kX + kJitter) * kTexelSize - 1.0f;
+  const float kTc = (kY + u2) * kTexelSize - 1.0f;
+
+  *direction = FaceDirection(kFace, kSc, kTc).normalized();
+  *pdf = Pdf(*direction);
+  return Lookup(*direction);
+}
+
+float EnvironmentMap::Pdf(const Eigen::Vector3f &direction) const {
+  if (size_ == 0 || total_weight_ <= 0.0f) return 0.0f;
+
+  int face;
+  float s, t;
+  FaceCoordinates(direction, &face, &s, &t);
+  const int kX = std::min(static_cast<int>(s * size_), size_ - 1);
+  const int kY = std::min(static_cast<int>(t * size_), size_ - 1);
+
+  const float kTexelSize = 2.0f / size_;
+  const float kSc = (kX + 0.5f) * kTexelSize - 1.0f;
+  const float kTc = (kY + 0.5f) * kTexelSize - 1.0f;
+  const float kSolidAngle = kTexelSize * kTexelSize /
+                            std::pow(1.0f + kSc * kSc + kTc * kTc, 1.5f);
+
+  const float kProbability =
+      texel_weights_[(face * size_ + kY) * size_ + kX] / total_weight_;
+  return kProbability / kSolidAngle;
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,118 @@
+#ifndef ENVIRONMENT_MAP_H_
+#define ENVIRONMENT_MAP_H_
+
+#include <Eigen/Geometry>
+
+#include <string>
+#include <vector>
+
+#include "./spherical_harmonics.h"
+
+namespace data_visualization {
+
+/**
+ * @brief EnvironmentMap CPU copy of a cube map with the same face layout and
+ * lookup rules as the GL_TEXTURE_CUBE_MAP textures created by GLWidget, plus
+ * a piecewise-constant distribution over its texels for importance sampling.
+ */
+class EnvironmentMap {
+ public:
+  /**
+   * @brief EnvironmentMap Constructor of the class. The map is black until
+   * Load or SetFace is called.
+   */
+  EnvironmentMap();
+
+  /**
+   * @brief Load Reads the six faces (right, left, top, bottom, back, front)
+   * from a directory, as GLWidget::BakeSkyboxMap does, and builds the sampling
+   * distribution.
+   * @param directory Path to the directory containing the 6 PNG faces.
+   * @return Whether all the faces could be read.
+   */
+  bool Load(const std::string &directory);
+
+  /**
+   * @brief SetFace Replaces one face with linear RGB texels. Call
+   * BuildDistribution once all faces are set.
+   * @param face Face index in GL_TEXTURE_CUBE_MAP_POSITIVE_X + face order.
+   * @param size Width and height of the face.
+   * @param texels size * size RGB triplets, row 0 being t = 0.
+   */
+  void SetFace(int face, int size, const std::vector<float> &texels);
+
+  /**
+   * @brief BuildDistribution Builds the luminance times solid angle CDF used
+   * by Sample and Pdf.
+   */
+  void BuildDistribution();
+
+  /**
+   * @brief Lookup Bilinearly filtered radiance in a direction, as
+   * texture(samplerCube, direction) with GL_LINEAR and GL_CLAMP_TO_EDGE.
+   */
+  Eigen::Vector3f Lookup(const Eigen::Vector3f &direction) const;
+
+  /**
+   * @brief Sample Draws a direction proportionally to the texel luminance.
+   * @param u1 Uniform random number in [0, 1).
+   * @param u2 Uniform random number in [0, 1).
+   * @param direction The sampled unit direction.
+   * @param pdf Its solid angle density.
+   * @return The radiance arriving from the sampled direction.
+   */
+  Eigen::Vector3f Sample(float u1, float u2, Eigen::Vector3f *direction,
+                         float *pdf) const;
+
+  /**
+   * @brief Pdf Solid angle density with which Sample returns direction.
+   */
+  float Pdf(const Eigen::Vector3f &direction) const;
+
+  /**
+   * @brief ProjectSh Projects the radiance onto the first
+   * data_representation::kShCoefficients spherical harmonics, weighting every
+   * texel by its solid angle.
+   * @param coefficients The RGB coefficient of every basis function.
+   */
+  void ProjectSh(std::vector<Eigen::Vector3f> *coefficients) const;
+
+  /**
+   * @brief Empty Whether no face has been loaded.
+   */
+  bool Empty() const { return size_ == 0; }
+
+ private:
+  void FaceCoordinates(const Eigen::Vector3f &direction, int *face, float *s,
+                       float *t) const;
+  Eigen::Vector3f Texel(int face, int x, int y) const;
+
+  /**
+   * @brief size_ Width and height of every face.
+   */
+  int size_;
+
+  /**
+   * @brief faces_ RGB texels of each face.
+   */
+  std::vector<float> faces_[6];
+
+  /**
+   * @brief cdf_ Cumulative distribution over all 6 * size_ * size_ texels.
+   */
+  std::vector<float> cdf_;
+
+  /**
+   * @brief texel_weights_ Unnormalized probability of each texel.
+   */
+  std::vector<float> texel_weights_;
+
+  /**
+   * @brief total_weight_ Sum of texel_weights_.
+   */
+  float total_weight_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  ENVIRONMENT_MAP_H_
@@ -0,0 +1,79 @@
+#include <gl_query.h>
+
+#include <algorithm>
+
+namespace data_visualization {
+
+QueryAverager::QueryAverager(GLenum target, int frames)
+    : target_(target),
+      frames_(frames),
+      queries_(),
+      next_(0),
+      active_(false),
+      dropped_(0),
+      sum_(0),
+      count_(0),
+      average_(0.0) {
+  std::fill_n(pending_, kQueryRingSize, false);
+}
+
+void QueryAverager::Create() {
+  glGenQueries(kQueryRingSize, queries_);
+  Reset();
+}
+
+void QueryAverager::Release() {
+  glDeleteQueries(kQueryRingSize, queries_);
+  std::fill_n(queries_, kQueryRingSize, 0);
+}
+
+void QueryAverager::Begin() {
+  active_ = !pending_[next_];
+  if (active_) glBeginQuery(target_, queries_[next_]);
+}
+
+void QueryAverager::End() {
+  if (!active_) return;
+  glEndQuery(target_);
+  pending_[next_] = true;
+  next_ = (next_ + 1) % kQueryRingSize;
+  active_ = false;
+}
+
+bool QueryAverager::Collect() {
+  bool ready = false;
+  // Oldest first, stopping at the first result that is not available yet,
+  // since later ones cannot be either.
+  for (int i = 0; i < kQueryRingSize; ++i) {
+    const int kQuery = (next_ + i) % kQueryRingSize;
+    if (!pending_[kQuery]) continue;
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(queries_[kQuery], GL_QUERY_RESULT_AVAILABLE,
+                        &available);
+    if (available == GL_FALSE) break;
+    GLuint64 result = 0;
+    glGetQueryObjectui64v(queries_[kQuery], GL_QUERY_RESULT, &result);
+    pending_[kQuery] = false;
+    if (dropped_ > 0) {
+      --dropped_;
+      continue;
+    }
+    sum_ += result;
+    if (++count_ == frames_) {
+      average_ = static_cast<double>(sum_) / count_;
+      sum_ = 0;
+      count_ = 0;
+      ready = true;
+    }
+  }
+  return ready;
+}
+
+void QueryAverager::Reset() {
+  dropped_ = static_cast<int>(std::count(pending_, pending_ + kQueryRingSize,
+                                         true));
+  sum_ = 0;
+  count_ = 0;
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,90 @@
+#ifndef GL_QUERY_H_
+#define GL_QUERY_H_
+
+#include <GL/glew.h>
+
+namespace data_visualization {
+
+/**
+ * @brief kQueryRingSize Queries of a QueryAverager in flight at once, frames
+ * its results may lag behind.
+ */
+const int kQueryRingSize = 4;
+
+/**
+ * @brief QueryAverager GL query around a part of every frame, such as
+ * GL_TIME_ELAPSED or GL_SAMPLES_PASSED, averaged over a number of frames.
+ * Each frame uses the next query of a ring, and results are only read once
+ * GL_QUERY_RESULT_AVAILABLE says so, so that reading them never waits for the
+ * GPU. A frame is skipped when every query of the ring is still in flight.
+ */
+class QueryAverager {
+ public:
+  /**
+   * @brief QueryAverager Constructor of the class.
+   * @param target Target of the queries.
+   * @param frames Results each average is taken over.
+   */
+  QueryAverager(GLenum target, int frames);
+
+  /**
+   * @brief Create Generates the queries. Called with the context current.
+   */
+  void Create();
+
+  /**
+   * @brief Release Deletes the queries.
+   */
+  void Release();
+
+  /**
+   * @brief Begin, End Delimit the part of the frame that is measured. Calls
+   * to Begin and End of different averagers must not overlap if they have
+   * the same target.
+   */
+  void Begin();
+  void End();
+
+  /**
+   * @brief Collect Reads the results that are available.
+   * @return Whether a new average is ready.
+   */
+  bool Collect();
+
+  /**
+   * @brief Reset Drops the results in flight and the partial average, e.g.
+   * after the measured work changes.
+   */
+  void Reset();
+
+  /**
+   * @brief average The last complete average, in the units of the target.
+   */
+  double average() const { return average_; }
+
+ private:
+  GLenum target_;
+  int frames_;
+  GLuint queries_[kQueryRingSize];
+
+  /**
+   * @brief pending_ Whether each query has ended and not been read yet.
+   */
+  bool pending_[kQueryRingSize];
+  int next_;
+  bool active_;
+
+  /**
+   * @brief dropped_ Oldest pending results that Collect reads and ignores,
+   * because they were in flight when Reset was called.
+   */
+  int dropped_;
+
+  GLuint64 sum_;
+  int count_;
+  double average_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  GL_QUERY_H_
@@ -0,0 +1,130 @@
+#include <gl_state_cache.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace data_visualization {
+
+namespace {
+
+// Name that no texture, program, vertex array or framebuffer gets.
+const GLuint kUnknownName = std::numeric_limits<GLuint>::max();
+
+/**
+ * @brief TargetIndex Slot of a texture target in the bindings of a unit, or -1
+ * for targets that are not cached.
+ */
+int TargetIndex(GLenum target) {
+  switch (target) {
+    case GL_TEXTURE_2D:
+      return 0;
+    case GL_TEXTURE_3D:
+      return 1;
+    case GL_TEXTURE_CUBE_MAP:
+      return 2;
+    default:
+      return -1;
+  }
+}
+
+}  // namespace
+
+GLStateCache::GLStateCache()
+    : issued_(0), filtered_(0), frame_issued_(0), frame_filtered_(0) {
+  Invalidate();
+}
+
+void GLStateCache::Invalidate() {
+  for (GLuint(&unit)[3] : textures_) std::fill_n(unit, 3, kUnknownName);
+  active_unit_ = -1;
+  program_ = kUnknownName;
+  vertex_array_ = kUnknownName;
+  framebuffer_ = kUnknownName;
+  std::fill_n(viewport_, 4, -1);
+  depth_func_ = GL_NONE;
+  depth_mask_ = -1;
+  // NaN compares unequal to every color.
+  std::fill_n(clear_color_, 4, std::numeric_limits<GLfloat>::quiet_NaN());
+}
+
+void GLStateCache::BeginFrame() {
+  frame_issued_ = issued_;
+  frame_filtered_ = filtered_;
+  issued_ = 0;
+  filtered_ = 0;
+}
+
+bool GLStateCache::Filter(bool redundant) {
+  if (redundant) {
+    ++filtered_;
+    return false;
+  }
+  ++issued_;
+  return true;
+}
+
+void GLStateCache::BindTexture(int unit, GLenum target, GLuint texture) {
+  const int kTarget = TargetIndex(target);
+  const bool kCached = unit < kCachedTextureUnits && kTarget >= 0;
+  if (!Filter(kCached && textures_[unit][kTarget] == texture)) return;
+  if (active_unit_ != unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    active_unit_ = unit;
+  }
+  glBindTexture(target, texture);
+  if (kCached) textures_[unit][kTarget] = texture;
+}
+
+void GLStateCache::UseProgram(GLuint program) {
+  if (!Filter(program_ == program)) return;
+  glUseProgram(program);
+  program_ = program;
+}
+
+void GLStateCache::BindVertexArray(GLuint vertex_array) {
+  if (!Filter(vertex_array_ == vertex_array)) return;
+  glBindVertexArray(vertex_array);
+  vertex_array_ = vertex_array;
+}
+
+void GLStateCache::BindFramebuffer(GLuint framebuffer) {
+  if (!Filter(framebuffer_ == framebuffer)) return;
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  framebuffer_ = framebuffer;
+}
+
+void GLStateCache::Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  if (!Filter(viewport_[0] == x && viewport_[1] == y &&
+              viewport_[2] == width && viewport_[3] == height))
+    return;
+  glViewport(x, y, width, height);
+  viewport_[0] = x;
+  viewport_[1] = y;
+  viewport_[2] = width;
+  viewport_[3] = height;
+}
+
+void GLStateCache::DepthFunc(GLenum func) {
+  if (!Filter(depth_func_ == func)) return;
+  glDepthFunc(func);
+  depth_func_ = func;
+}
+
+void GLStateCache::DepthMask(GLboolean flag) {
+  if (!Filter(depth_mask_ == flag)) return;
+  glDepthMask(flag);
+  depth_mask_ = flag;
+}
+
+void GLStateCache::ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+  if (!Filter(clear_color_[0] == r && clear_color_[1] == g &&
+              clear_color_[2] == b && clear_color_[3] == a))
+    return;
+  glClearColor(r, g, b, a);
+  clear_color_[0] = r;
+  clear_color_[1] = g;
+  clear_color_[2] = b;
+  clear_color_[3] = a;
+}
+
+}  // namespace data_visualization
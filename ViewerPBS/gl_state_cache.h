@@ -0,0 +1,100 @@
+#ifndef GL_STATE_CACHE_H_
+#define GL_STATE_CACHE_H_
+
+#include <GL/glew.h>
+
+namespace data_visualization {
+
+/**
+ * @brief kCachedTextureUnits Texture units tracked by the cache. Bindings to
+ * higher units are always issued.
+ */
+const int kCachedTextureUnits = 32;
+
+/**
+ * @brief GLStateCache Shadow copy of the GL state that paintGL sets every
+ * frame: texture bindings per unit, the current program, vertex array,
+ * framebuffer, viewport, depth function and mask, and clear color. Calls that
+ * would set the value already in place are dropped. Code that changes this
+ * state directly must call Invalidate afterwards, so that the next call of
+ * each kind is issued again.
+ */
+class GLStateCache {
+ public:
+  /**
+   * @brief GLStateCache Constructor of the class. Starts invalidated.
+   */
+  GLStateCache();
+
+  /**
+   * @brief Invalidate Forgets the shadowed state.
+   */
+  void Invalidate();
+
+  /**
+   * @brief BeginFrame Closes the counters of the previous frame and starts
+   * counting the next one.
+   */
+  void BeginFrame();
+
+  /**
+   * @brief BindTexture Binds a texture to a unit, activating the unit first
+   * if needed.
+   * @param unit Index of the unit, without GL_TEXTURE0.
+   * @param target GL_TEXTURE_2D, GL_TEXTURE_3D or GL_TEXTURE_CUBE_MAP.
+   * @param texture Name of the texture.
+   */
+  void BindTexture(int unit, GLenum target, GLuint texture);
+
+  void UseProgram(GLuint program);
+  void BindVertexArray(GLuint vertex_array);
+  void BindFramebuffer(GLuint framebuffer);
+  void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+  void DepthFunc(GLenum func);
+  void DepthMask(GLboolean flag);
+  void ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+
+  /**
+   * @brief issued Calls issued during the last complete frame.
+   */
+  int issued() const { return frame_issued_; }
+
+  /**
+   * @brief filtered Calls dropped during the last complete frame.
+   */
+  int filtered() const { return frame_filtered_; }
+
+ private:
+  /**
+   * @brief Filter Counts a call and tells whether it has to be issued.
+   * @param redundant Whether the call sets the value already in place.
+   */
+  bool Filter(bool redundant);
+
+  /**
+   * @brief textures_ Bound texture of each unit, for the 2D, 3D and cube map
+   * targets. Invalidated entries hold values that no call can match.
+   */
+  GLuint textures_[kCachedTextureUnits][3];
+  GLint active_unit_;
+  GLuint program_;
+  GLuint vertex_array_;
+  GLuint framebuffer_;
+  GLint viewport_[4];
+  GLenum depth_func_;
+
+  /**
+   * @brief depth_mask_ GL_TRUE or GL_FALSE, or -1 when invalidated.
+   */
+  GLint depth_mask_;
+  GLfloat clear_color_[4];
+
+  int issued_;
+  int filtered_;
+  int frame_issued_;
+  int frame_filtered_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  GL_STATE_CACHE_H_
@@ -2,18 +2,27 @@
 
 #include <glwidget.h>
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <utility>
 #include <QBuffer>
+#include <QRunnable>
 
+#include "./ambient_occlusion.h"
+#include "./bvh.h"
+#include "./environment_map.h"
 #include "./mesh_io.h"
+#include "./render_graph.h"
+#include "./shader_program.h"
+#include "./ssao.h"
 #include "./triangle_mesh.h"
 
 #include "glm/glm.hpp"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <QRandomGenerator>
 
 #ifndef M_PI
     #define M_PI 3.14159265358979323846
@@ -21,10 +30,6 @@
 
 namespace {
 
-const double kFieldOfView = 60;
-const double kZNear = 0.3;
-const double kZFar = 2;
-
 const char kPhongVertexShaderFile[] = "../../ViewerPBS/shaders/phong.vert";
 const char kPhongFragmentShaderFile[] = "../../ViewerPBS/shaders/phong.frag";
 const char kTextureMappingColorVertexShaderFile[] = "../../ViewerPBS/shaders/texture_mapping_color.vert";
@@ -47,20 +52,104 @@ const char kStepOneVertexShaderFile[] = "../../ViewerPBS/shaders/step_one.vert";
 const char kStepOneFragmentShaderFile[] = "../../ViewerPBS/shaders/step_one.frag";
 const char kStepTwoVertexShaderFile[] = "../../ViewerPBS/shaders/step_two.vert";
 const char kStepTwoFragmentShaderFile[] = "../../ViewerPBS/shaders/step_two.frag";
+const char kSsaoDownsampleFragmentShaderFile[] = "../../ViewerPBS/shaders/ssao_downsample.frag";
+const char kSsaoUpsampleFragmentShaderFile[] = "../../ViewerPBS/shaders/ssao_upsample.frag";
+const char kSsaoTemporalFragmentShaderFile[] = "../../ViewerPBS/shaders/ssao_temporal.frag";
 const char kStepThreeVertexShaderFile[] = "../../ViewerPBS/shaders/step_three.vert";
 const char kStepThreeFragmentShaderFile[] = "../../ViewerPBS/shaders/step_three.frag";
+const char kSsaoComputeShaderFile[] = "../../ViewerPBS/shaders/ssao.comp";
+const char kSsaoBlurComputeShaderFile[] = "../../ViewerPBS/shaders/ssao_blur.comp";
 const char kStepFourVertexShaderFile[] = "../../ViewerPBS/shaders/step_four.vert";
 const char kStepFourFragmentShaderFile[] = "../../ViewerPBS/shaders/step_four.frag";
+const char kDeferredVertexShaderFile[] = "../../ViewerPBS/shaders/deferred.vert";
+
+// Prepended to the lighting programs and the first SSAO step to build their
+// deferred variants.
+const char kDeferredDefines[] = "#define DEFERRED\n";
+
+// Prepended to the blur to build its vertical pass.
+const char kVerticalDefines[] = "#define VERTICAL\n";
 
 
 const int kVertexAttributeIdx = 0;
 const int kNormalAttributeIdx = 1;
 const int kTextureAttributeIdx = 2;
-
-// SSAO Kernel
-std::uniform_real_distribution<float> randomFloats(0.0, 1.0); // random floats between [0.0, 1.0]
-//float x = randomFloats(*QRandomGenerator::global());
-std::vector<glm::vec2> ssao_kernel;                              /* use circle of radius 2 */
+const int kAmbientOcclusionAttributeIdx = 3;
+// The kShCoefficients transfer coefficients take three vec3 attributes.
+const int kRadianceTransferAttributeIdx = 4;
+// World space splat radius of point clouds.
+const int kSplatRadiusAttributeIdx = 7;
+
+// Ambient occlusion modes
+const unsigned int kScreenSpaceAO = 0;
+const unsigned int kBakedAO = 1;
+const unsigned int kDistanceFieldAO = 2;
+
+// Composite mode of the lighting programs (Frame.composite_mode) that reads
+// the blurred screen space ambient occlusion. The other direct composites
+// use the ambient occlusion mode.
+const int kScreenSpaceComposite = 3;
+
+// Diffuse image based lighting modes
+const unsigned int kIrradianceMapDiffuse = 0;
+const unsigned int kRadianceTransferDiffuse = 1;
+const unsigned int kProbeVolumeDiffuse = 2;
+
+// First texture unit of the three probe volume textures (red, green, blue).
+const int kProbeVolumeTextureUnit = 16;
+
+// Texture unit of the signed distance field.
+const int kDistanceFieldTextureUnit = 19;
+
+// Texture unit of the SSAO history read by the temporal mode.
+const int kSsaoHistoryTextureUnit = 25;
+
+// Texture unit of the output of the horizontal SSAO blur pass.
+const int kSsaoBlurHorizontalTextureUnit = 26;
+
+// Pixels per side of the tile of a workgroup of the SSAO compute shader
+// (local_size_x and local_size_y of ssao.comp), and pixels of the row of a
+// workgroup of the horizontal blur (local_size_x of ssao_blur.comp).
+const int kSsaoComputeTileSize = 16;
+const int kSsaoBlurComputeRowSize = 128;
+
+// Weight of the new SSAO estimate in the temporal mode, and still frames
+// rendered after the camera stops so that the average converges (the weight
+// of the first one falls below 2%).
+const float kTemporalBlend = 0.125f;
+const int kTemporalFrames = 32;
+
+// Samples per frame of the SSAO estimator in the temporal mode, taken from
+// successive slices of the kernel, so that the history averages the whole
+// kernel over a few frames.
+const int kTemporalSamples = 8;
+
+// Kernel rotation between frames in turns, which covers the circle evenly.
+const double kGoldenRatioConjugate = 0.6180339887498949;
+
+// Shader mode of the BRDF program, the only one tracing the distance field.
+const unsigned int kBrdfShader = 3;
+
+// Number of frames the GPU time of the first SSAO step is averaged over while
+// profiling, to compare it with the software rasterizer (--gbuffer).
+const int kStepOneTimingFrames = 60;
+
+// Number of frames the GPU times of the SSAO estimator and of the horizontal
+// blur are averaged over while profiling, to compare the compute path with
+// the fragment passes.
+const int kSsaoTimingFrames = 60;
+
+// Number of frames the fragments shaded by the forward lighting pass are
+// averaged over while profiling, to compare the shared depth test (key Z) with no test.
+const int kShadedFragmentsFrames = 60;
+
+// The off-screen targets grow in steps of kTargetGranularity pixels, and
+// shrink when the viewport falls below kTargetShrinkRatio of their size.
+const int kTargetGranularity = 128;
+const float kTargetShrinkRatio = 0.5f;
+
+// SSAO Kernel, shared with the CPU implementation (data_visualization::Ssao).
+std::vector<Eigen::Vector2f> ssao_kernel;
 
 // light
 // ------
@@ -143,30 +232,139 @@ bool ReadFile(const std::string filename, std::string *shader_source) {
   stream << infile.rdbuf();
   infile.close();
 
-  *shader_source = stream.str();
+  // Expand #include "file" lines, relative to the including file, which share
+  // the uniform block declarations between shaders.
+  std::string source = stream.str();
+  const std::string kDirectory =
+      filename.substr(0, filename.find_last_of('/') + 1);
+  const std::string kInclude = "#include \"";
+  size_t pos = 0;
+  while ((pos = source.find(kInclude, pos)) != std::string::npos) {
+    const size_t kNameBegin = pos + kInclude.size();
+    const size_t kNameEnd = source.find('"', kNameBegin);
+    if (kNameEnd == std::string::npos) break;
+    std::string included;
+    if (!ReadFile(kDirectory + source.substr(kNameBegin, kNameEnd - kNameBegin),
+                  &included))
+      return false;
+    source.replace(pos, kNameEnd + 1 - pos, included);
+    pos += included.size();
+  }
+
+  *shader_source = source;
   return true;
 }
 
-bool LoadImage(const std::string &path, GLuint cube_map_pos) {
-  QImage image;
-  std::cout<<path.c_str();
-  bool res = image.load(path.c_str());
-  image = image.convertToFormat(QImage::Format_RGB888);
-  if (res) {
-    QImage gl_image = image.mirrored();
-    glTexImage2D(cube_map_pos, 0, GL_RGB, image.width(), image.height(), 0,
-                 GL_RGB, GL_UNSIGNED_BYTE, image.bits());
+/**
+ * @brief TargetSize Size of the off-screen targets along one axis, given their
+ * current size and the one of the viewport. Keeps the current size while the
+ * viewport fits in it and is not much smaller.
+ */
+int TargetSize(int current, int viewport) {
+  if (viewport <= current && viewport >= current * kTargetShrinkRatio)
+    return current;
+  return (viewport + kTargetGranularity - 1) / kTargetGranularity *
+         kTargetGranularity;
+}
+
+/**
+ * @brief kCubeMapFaces Files of the faces of a cube map directory, in the
+ * order of their GL_TEXTURE_CUBE_MAP_POSITIVE_X + i targets.
+ */
+const char *const kCubeMapFaces[6] = {"/right.png",  "/left.png",
+                                      "/top.png",    "/bottom.png",
+                                      "/back.png",   "/front.png"};
+
+/**
+ * @brief kModelTextures Textures uploaded with every model: albedo,
+ * metalness, roughness and the SSAO rotations.
+ */
+const char *const kModelTextures[4] = {
+    "../../ViewerPBS/textures/metal_spotty_discoloration/color.jpg",
+    "../../ViewerPBS/textures/metal_spotty_discoloration/metalness.jpg",
+    "../../ViewerPBS/textures/metal_spotty_discoloration/roughness.jpg",
+    "../../ViewerPBS/textures/random_texture/noiseTexture.png"};
+
+/**
+ * @brief DecodeImage Reads an image as RGB texels. Runs on bake_pool_, so
+ * that the render thread only uploads them.
+ */
+bool DecodeImage(const std::string &path, QImage *image) {
+  const bool kLoaded = image->load(path.c_str());
+  *image = image->convertToFormat(QImage::Format_RGB888);
+  return kLoaded;
+}
+
+/**
+ * @brief DecodeCubeMap Reads the six faces of a cube map directory.
+ */
+bool DecodeCubeMap(const std::string &dir, std::vector<QImage> *faces) {
+  faces->resize(6);
+  for (int i = 0; i < 6; ++i)
+    if (!DecodeImage(dir + kCubeMapFaces[i], &(*faces)[i])) return false;
+  return true;
+}
+
+/**
+ * @brief UploadImage Uploads decoded texels to a target of the bound
+ * texture. Images that could not be read are skipped.
+ */
+void UploadImage(const QImage &image, GLenum target) {
+  if (image.isNull()) return;
+  glTexImage2D(target, 0, GL_RGB, image.width(), image.height(), 0, GL_RGB,
+               GL_UNSIGNED_BYTE, image.constBits());
+}
+
+/**
+ * @brief UploadCubeMap Uploads the decoded faces to the bound cube map.
+ */
+void UploadCubeMap(const std::vector<QImage> &faces) {
+  for (int i = 0; i < 6; ++i)
+    UploadImage(faces[i], GL_TEXTURE_CUBE_MAP_POSITIVE_X + i);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
+
+/**
+ * @brief SaveCubeMap Writes the faces read back from an irradiance capture
+ * to a cube map directory. The read back rows are the columns of the faces.
+ */
+void SaveCubeMap(const std::vector<QImage> &captures, const std::string &dir) {
+  for (int i = 0; i < 6; ++i) {
+    const QImage &capture = captures[i];
+    QImage image(capture.height(), capture.width(), QImage::Format_RGBA8888);
+    for (int x = 0; x < image.width(); ++x) {
+      const unsigned char *row = capture.constScanLine(x);
+      for (int y = 0; y < image.height(); ++y)
+        image.setPixel(x, y, qRgba(row[y * 4], row[y * 4 + 1], row[y * 4 + 2],
+                                   row[y * 4 + 3]));
+    }
+    image.save((dir + kCubeMapFaces[i]).c_str(), "PNG");
   }
-  return res;
+}
+
+/**
+ * @brief AddDefines Inserts #define lines after the #version line of a shader.
+ */
+void AddDefines(const std::string &defines, std::string *source) {
+  if (defines.empty()) return;
+  const size_t kLineEnd = source->find('\n');
+  source->insert(kLineEnd == std::string::npos ? source->size() : kLineEnd + 1,
+                 defines);
 }
 
 bool LoadProgram(const std::string &vertex, const std::string &fragment,
-                 QOpenGLShaderProgram *program) {
+                 const std::string &defines, QOpenGLShaderProgram *program) {
   std::string vertex_shader, fragment_shader;
   bool res =
       ReadFile(vertex, &vertex_shader) && ReadFile(fragment, &fragment_shader);
 
   if (res) {
+    AddDefines(defines, &vertex_shader);
+    AddDefines(defines, &fragment_shader);
     program->addShaderFromSourceCode(QOpenGLShader::Vertex,
                                      vertex_shader.c_str());
     program->addShaderFromSourceCode(QOpenGLShader::Fragment,
@@ -174,27 +372,176 @@ bool LoadProgram(const std::string &vertex, const std::string &fragment,
     program->bindAttributeLocation("vertex", kVertexAttributeIdx);
     program->bindAttributeLocation("normal", kNormalAttributeIdx);
     program->bindAttributeLocation("texture_coords", kTextureAttributeIdx);
-    program->link();
+    program->bindAttributeLocation("ambient_occlusion",
+                                   kAmbientOcclusionAttributeIdx);
+    program->bindAttributeLocation("radiance_transfer_0",
+                                   kRadianceTransferAttributeIdx);
+    program->bindAttributeLocation("radiance_transfer_1",
+                                   kRadianceTransferAttributeIdx + 1);
+    program->bindAttributeLocation("radiance_transfer_2",
+                                   kRadianceTransferAttributeIdx + 2);
+    program->bindAttributeLocation("splat_radius", kSplatRadiusAttributeIdx);
+    res = program->link();
   }
 
   return res;
 }
 
+/**
+ * @brief LoadProgram Compiles and links a new program and replaces program
+ * with it, keeping the previous one when that fails.
+ */
+bool LoadProgram(const std::string &vertex, const std::string &fragment,
+                 std::unique_ptr<QOpenGLShaderProgram> *program,
+                 const std::string &defines = "") {
+  std::unique_ptr<QOpenGLShaderProgram> linked =
+      std::make_unique<QOpenGLShaderProgram>();
+  if (!LoadProgram(vertex, fragment, defines, linked.get())) return false;
+  *program = std::move(linked);
+  return true;
+}
+
+template <typename Uniforms>
+bool LoadProgram(const std::string &vertex, const std::string &fragment,
+                 data_visualization::ShaderProgram<Uniforms> *program,
+                 const std::string &defines = "") {
+  std::unique_ptr<QOpenGLShaderProgram> linked;
+  if (!LoadProgram(vertex, fragment, &linked, defines)) return false;
+  program->Reset(std::move(linked));
+  return true;
+}
+
+/**
+ * @brief LoadComputeProgram Compiles and links a new compute program and
+ * replaces program with it, keeping the previous one when that fails.
+ */
+template <typename Uniforms>
+bool LoadComputeProgram(const std::string &compute,
+                        data_visualization::ShaderProgram<Uniforms> *program) {
+  std::string compute_shader;
+  if (!ReadFile(compute, &compute_shader)) return false;
+  std::unique_ptr<QOpenGLShaderProgram> linked =
+      std::make_unique<QOpenGLShaderProgram>();
+  if (!linked->addShaderFromSourceCode(QOpenGLShader::Compute,
+                                       compute_shader.c_str()) ||
+      !linked->link())
+    return false;
+  program->Reset(std::move(linked));
+  return true;
+}
+
+/**
+ * @brief BakeJob Runs a function on a QThreadPool.
+ */
+class BakeJob : public QRunnable {
+ public:
+  explicit BakeJob(const std::function<void()> &run) : run_(run) {}
+  void run() override { run_(); }
+
+ private:
+  std::function<void()> run_;
+};
+
+void LoadBakedLighting(const std::string &model_file,
+                       data_representation::TriangleMesh *mesh) {
+  const std::string kOcclusionFile = model_file + ".ao";
+  const std::string kTransferFile = model_file + ".prt";
+  const bool kHasOcclusion = data_representation::ReadAmbientOcclusion(
+      kOcclusionFile, *mesh, &mesh->ambient_occlusion_);
+  const bool kHasTransfer = data_representation::ReadRadianceTransfer(
+      kTransferFile, *mesh, &mesh->radiance_transfer_);
+  if (kHasOcclusion && kHasTransfer) return;
+
+  data_representation::Bvh bvh;
+  bvh.Build(*mesh);
+
+  if (!kHasOcclusion) {
+    const Eigen::Vector3f kExtent = mesh->max_ - mesh->min_;
+    data_representation::BakeAmbientOcclusion(
+        *mesh, bvh, data_representation::kAmbientOcclusionRays,
+        data_representation::kAmbientOcclusionDistance * kExtent.maxCoeff(),
+        &mesh->ambient_occlusion_);
+
+    if (!data_representation::WriteAmbientOcclusion(
+            kOcclusionFile, *mesh, mesh->ambient_occlusion_))
+      std::cerr << "Error " + kOcclusionFile + " could not be written."
+                << std::endl;
+  }
+
+  if (!kHasTransfer) {
+    data_representation::BakeRadianceTransfer(
+        *mesh, bvh, data_representation::kRadianceTransferRays,
+        &mesh->radiance_transfer_);
+
+    if (!data_representation::WriteRadianceTransfer(
+            kTransferFile, *mesh, mesh->radiance_transfer_))
+      std::cerr << "Error " + kTransferFile + " could not be written."
+                << std::endl;
+  }
+}
+
 }  // end of namespace
 
 GLWidget::GLWidget(QWidget *parent)
     : QGLWidget(parent),
+      deferred_(false),
       initialized_(false),
       width_(0.0),
       height_(0.0),
+      target_width_(0),
+      target_height_(0),
       shader_mode_(0),
+      ao_mode_(kScreenSpaceAO),
+      diffuse_mode_(kIrradianceMapDiffuse),
+      occlusion_culling_(false),
+      point_scale_(0.0f),
+      environment_sh_(data_representation::kShCoefficients,
+                      Eigen::Vector3f::Zero()),
       fresnel_(0.972,0.960,0.915),
       metalness_(1.0),
-      roughness_(0.10){
+      roughness_(0.10),
+      sky_VAO(0),
+      model_VAO(0),
+      sky_buffer_(0),
+      model_buffers_(),
+      resources_version_(0),
+      render_thread_(this,
+                     {[this] { initializeGL(); },
+                      [this] {
+                        paintGL();
+                        return continuous_ || ssao_converging_;
+                      },
+                      [this] { ReleaseGL(); },
+                      [this](double mean, double max) {
+                        emit SetLatency(QString("%1 / %2 ms")
+                                            .arg(mean, 0, 'f', 1)
+                                            .arg(max, 0, 'f', 1));
+                      }}),
+      continuous_(false),
+      framerate_frames_(0),
+      profiling_(false),
+      step_one_timer_(GL_TIME_ELAPSED, kStepOneTimingFrames),
+      shared_depth_(true),
+      fused_composite_(true),
+      shaded_fragments_(GL_SAMPLES_PASSED, kShadedFragmentsFrames),
+      ssao_timer_(GL_TIME_ELAPSED, kSsaoTimingFrames),
+      ssao_blur_timer_(GL_TIME_ELAPSED, kSsaoTimingFrames) {
   setFocusPolicy(Qt::StrongFocus);
+  // The render thread swaps once the frame is complete.
+  setAutoBufferSwap(false);
+  bake_pool_.setMaxThreadCount(1);
+  connect(this, &GLWidget::Baked, this, &GLWidget::PostBaked,
+          Qt::QueuedConnection);
 }
 
 GLWidget::~GLWidget() {
+  // The bakes not started yet are dropped, and their uploads never posted.
+  bake_pool_.clear();
+  bake_pool_.waitForDone();
+  render_thread_.Stop();
+}
+
+void GLWidget::ReleaseGL() {
   if (initialized_) {
     glDeleteTextures(1, &tex_map_albedo_);
     glDeleteTextures(1, &tex_map_metalness_);
@@ -205,215 +552,665 @@ GLWidget::~GLWidget() {
     glDeleteTextures(1, &specular_irradiance_map_);
     glDeleteTextures(1, &diffuse_map_);
     glDeleteTextures(1, &specular_map_);
-    glDeleteTextures(1, &tex_ssao_map_color_);
-    glDeleteTextures(1, &tex_ssao_map_normal_);
-    glDeleteTextures(1, &tex_ssao_map_depth_);
     glDeleteTextures(1, &tex_ssao_map_random_);
-    glDeleteTextures(1, &tex_ssao_map_ssao_);
+    glDeleteTextures(2, ssao_history_maps_);
+    step_one_timer_.Release();
+    shaded_fragments_.Release();
+    ssao_timer_.Release();
+    ssao_blur_timer_.Release();
+    glDeleteVertexArrays(1, &sky_VAO);
+    glDeleteVertexArrays(1, &model_VAO);
+    glDeleteBuffers(1, &sky_buffer_);
+    glDeleteBuffers(kModelBufferCount, model_buffers_);
+    render_graph_.Release();
   }
 }
 
-bool GLWidget::LoadCubeMap(const QString &dir) {
-  glGenVertexArrays(1, &sky_VAO);
-  glBindVertexArray(sky_VAO);
+void GLWidget::Bake(
+    const std::function<data_visualization::RenderThread::Change()> &bake) {
+  bake_pool_.start(new BakeJob([=] {
+    data_visualization::RenderThread::Change upload = bake();
+    {
+      std::lock_guard<std::mutex> lock(baked_mutex_);
+      baked_.push_back(std::move(upload));
+    }
+    emit Baked();
+  }));
+}
 
-  GLuint skyVBO;
-  glGenBuffers(1, &skyVBO);
-  glBindBuffer(GL_ARRAY_BUFFER, skyVBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-  glEnableVertexAttribArray(0);
+void GLWidget::PostBaked() {
+  std::vector<data_visualization::RenderThread::Change> baked;
+  {
+    std::lock_guard<std::mutex> lock(baked_mutex_);
+    baked.swap(baked_);
+  }
+  for (data_visualization::RenderThread::Change &upload : baked)
+    render_thread_.Post(std::move(upload));
+}
+
+void GLWidget::BakeProbeVolume() {
+  if (mesh_ == nullptr || mesh_->faces_.empty() || environment_.Empty())
+    return;
+
+  // The bake reads its own references, as the render thread may replace the
+  // model or the skybox meanwhile.
+  const std::shared_ptr<const data_representation::TriangleMesh> kMesh = mesh_;
+  const std::shared_ptr<const data_visualization::EnvironmentMap>
+      kEnvironment =
+          std::make_shared<data_visualization::EnvironmentMap>(environment_);
+  Bake([=]() -> data_visualization::RenderThread::Change {
+    data_representation::Bvh bvh;
+    bvh.Build(*kMesh);
+    const std::shared_ptr<data_visualization::IrradianceVolume> kVolume =
+        std::make_shared<data_visualization::IrradianceVolume>();
+    kVolume->Bake(*kMesh, bvh, *kEnvironment,
+                  data_visualization::ProbeVolumeSettings());
+
+    return [=] {
+      // A newer model has its own bake queued.
+      if (mesh_ != kMesh) return;
+      ResourcesChanged();
+      probe_volume_ = std::move(*kVolume);
+      UploadProbeVolume();
+      SetSceneUniforms();
+    };
+  });
+}
+
+void GLWidget::UploadProbeVolume() {
+  std::vector<float> texels;
+  for (int channel = 0; channel < 3; ++channel) {
+    probe_volume_.ChannelTexels(channel, &texels);
+    glActiveTexture(GL_TEXTURE0 + kProbeVolumeTextureUnit + channel);
+    glBindTexture(GL_TEXTURE_3D, probe_volume_maps_[channel]);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA32F, probe_volume_.size()[0],
+                 probe_volume_.size()[1], probe_volume_.size()[2], 0, GL_RGBA,
+                 GL_FLOAT, texels.data());
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D, 0);
+  }
+  glActiveTexture(GL_TEXTURE0);
+}
+
+void GLWidget::UploadDistanceField() {
+  glActiveTexture(GL_TEXTURE0 + kDistanceFieldTextureUnit);
+  glBindTexture(GL_TEXTURE_3D, distance_field_map_);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, distance_field_.size()[0],
+               distance_field_.size()[1], distance_field_.size()[2], 0, GL_RED,
+               GL_FLOAT, distance_field_.texels().data());
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_3D, 0);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+void GLWidget::CreateMeshBuffers() {
+  glBindBuffer(GL_ARRAY_BUFFER, model_buffers_[kPositionBuffer]);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * mesh_->vertices_.size(), &mesh_->vertices_[0], GL_STATIC_DRAW);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model_buffers_[kIndexBuffer]);
+  // Faces in cluster order, so that visible clusters are index ranges.
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, occlusion_culler_.indices().size() * sizeof(unsigned int), occlusion_culler_.indices().data(), GL_STATIC_DRAW);
+
+  // vertex positions
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
+  glEnableVertexAttribArray(0);
 
-  std::string path = dir.toUtf8().constData();
-  bool res = LoadImage(path + "/right.png", GL_TEXTURE_CUBE_MAP_POSITIVE_X);
-  res = res && LoadImage(path + "/left.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_X);
-  res = res && LoadImage(path + "/top.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Y);
-  res = res && LoadImage(path + "/bottom.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Y);
-  res = res && LoadImage(path + "/back.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Z);
-  res = res && LoadImage(path + "/front.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Z);
+  // vertex normals
+  glBindBuffer(GL_ARRAY_BUFFER, model_buffers_[kNormalBuffer]);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * mesh_->normals_.size(), &mesh_->normals_[0], GL_STATIC_DRAW);
 
-  if (res) {
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
+
+  // texture coords
+  glBindBuffer(GL_ARRAY_BUFFER, model_buffers_[kTextureBuffer]);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * mesh_->textures_.size(), &mesh_->textures_[0], GL_STATIC_DRAW);
+
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, (void*)0);
 
-    cubemap_path = path;
+  // baked ambient occlusion
+  glBindBuffer(GL_ARRAY_BUFFER, model_buffers_[kAmbientOcclusionBuffer]);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * mesh_->ambient_occlusion_.size(), &mesh_->ambient_occlusion_[0], GL_STATIC_DRAW);
+
+  glEnableVertexAttribArray(kAmbientOcclusionAttributeIdx);
+  glVertexAttribPointer(kAmbientOcclusionAttributeIdx, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+
+  // baked radiance transfer
+  glBindBuffer(GL_ARRAY_BUFFER, model_buffers_[kRadianceTransferBuffer]);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * mesh_->radiance_transfer_.size(), &mesh_->radiance_transfer_[0], GL_STATIC_DRAW);
+
+  for (int i = 0; i < 3; ++i) {
+    glEnableVertexAttribArray(kRadianceTransferAttributeIdx + i);
+    glVertexAttribPointer(kRadianceTransferAttributeIdx + i, 3, GL_FLOAT, GL_FALSE, sizeof(float) * data_representation::kShCoefficients, (void*)(sizeof(float) * 3 * i));
   }
+}
+
+void GLWidget::CreatePointBuffers() {
+  // Node points: position and splat radius.
+  glBindBuffer(GL_ARRAY_BUFFER, model_buffers_[kPositionBuffer]);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * point_octree_.points().size(), point_octree_.points().data(), GL_STATIC_DRAW);
 
+  glEnableVertexAttribArray(kVertexAttributeIdx);
+  glVertexAttribPointer(kVertexAttributeIdx, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void*)0);
+  glEnableVertexAttribArray(kSplatRadiusAttributeIdx);
+  glVertexAttribPointer(kSplatRadiusAttributeIdx, 1, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void*)(sizeof(float) * 3));
+
+  // point normals
+  glBindBuffer(GL_ARRAY_BUFFER, model_buffers_[kNormalBuffer]);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * point_octree_.normals().size(), point_octree_.normals().data(), GL_STATIC_DRAW);
+
+  glEnableVertexAttribArray(kNormalAttributeIdx);
+  glVertexAttribPointer(kNormalAttributeIdx, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
+}
+
+bool GLWidget::LoadPrograms() {
+  ResourcesChanged();
+  bool res = LoadProgram(kPhongVertexShaderFile, kPhongFragmentShaderFile,
+                         &phong_program_);
+  res = LoadProgram(kTextureMappingColorVertexShaderFile,
+                    kTextureMappingColorFragmentShaderFile,
+                    &texture_mapping_color_program_) && res;
+  res = LoadProgram(kTextureMappingMetalnessVertexShaderFile,
+                    kTextureMappingMetalnessFragmentShaderFile,
+                    &texture_mapping_metalness_program_) && res;
+  res = LoadProgram(kTextureMappingRoughnessVertexShaderFile,
+                    kTextureMappingRoughnessFragmentShaderFile,
+                    &texture_mapping_roughness_program_) && res;
+  res = LoadProgram(kBRDFVertexShaderFile, kBRDFFragmentShaderFile,
+                    &brdf_program_) && res;
+  res = LoadProgram(kReflectionVertexShaderFile,
+                    kReflectionFragmentShaderFile, &reflection_program_) &&
+        res;
+  res = LoadProgram(kSkyVertexShaderFile, kSkyFragmentShaderFile,
+                    &sky_program_) && res;
+  res = LoadProgram(kDiffuseIrradianceVertexShaderFile,
+                    kDiffuseIrradianceFragmentShaderFile,
+                    &diffuse_irradiance_program_) && res;
+  res = LoadProgram(kSpecularIrradianceVertexShaderFile,
+                    kSpecularIrradianceFragmentShaderFile,
+                    &specular_irradiance_program_) && res;
+  res = LoadProgram(kStepOneVertexShaderFile, kStepOneFragmentShaderFile,
+                    &step_one_program_) && res;
+  res = LoadProgram(kStepTwoVertexShaderFile, kStepTwoFragmentShaderFile,
+                    &step_two_program_) && res;
+  res = LoadProgram(kStepThreeVertexShaderFile, kStepThreeFragmentShaderFile,
+                    &step_three_program_) && res;
+  res = LoadProgram(kStepThreeVertexShaderFile, kStepThreeFragmentShaderFile,
+                    &vertical_step_three_program_, kVerticalDefines) && res;
+  res = LoadProgram(kStepTwoVertexShaderFile, kSsaoDownsampleFragmentShaderFile,
+                    &ssao_downsample_program_) && res;
+  res = LoadProgram(kStepTwoVertexShaderFile, kStepTwoFragmentShaderFile,
+                    &reduced_step_two_program_) && res;
+  res = LoadProgram(kStepTwoVertexShaderFile, kSsaoUpsampleFragmentShaderFile,
+                    &ssao_upsample_program_) && res;
+  res = LoadProgram(kStepTwoVertexShaderFile, kSsaoTemporalFragmentShaderFile,
+                    &ssao_temporal_program_) && res;
+  res = LoadProgram(kStepFourVertexShaderFile, kStepFourFragmentShaderFile,
+                    &step_four_program_) && res;
+  res = LoadProgram(kStepOneVertexShaderFile, kStepOneFragmentShaderFile,
+                    &deferred_step_one_program_, kDeferredDefines) && res;
+  res = LoadProgram(kDeferredVertexShaderFile, kPhongFragmentShaderFile,
+                    &deferred_phong_program_, kDeferredDefines) && res;
+  res = LoadProgram(kDeferredVertexShaderFile,
+                    kTextureMappingColorFragmentShaderFile,
+                    &deferred_texture_mapping_color_program_,
+                    kDeferredDefines) && res;
+  res = LoadProgram(kDeferredVertexShaderFile,
+                    kTextureMappingMetalnessFragmentShaderFile,
+                    &deferred_texture_mapping_metalness_program_,
+                    kDeferredDefines) && res;
+  res = LoadProgram(kDeferredVertexShaderFile,
+                    kTextureMappingRoughnessFragmentShaderFile,
+                    &deferred_texture_mapping_roughness_program_,
+                    kDeferredDefines) && res;
+  res = LoadProgram(kDeferredVertexShaderFile, kBRDFFragmentShaderFile,
+                    &deferred_brdf_program_, kDeferredDefines) && res;
+  res = LoadProgram(kDeferredVertexShaderFile, kReflectionFragmentShaderFile,
+                    &deferred_reflection_program_, kDeferredDefines) && res;
+  if (!res) std::cerr << "Could not load all the shader programs" << std::endl;
+  // The compute path is optional, and the fragment passes replace it when it
+  // does not build.
+  if (compute_available_ &&
+      !(LoadComputeProgram(kSsaoComputeShaderFile, &ssao_compute_program_) &&
+        LoadComputeProgram(kSsaoBlurComputeShaderFile,
+                           &ssao_blur_compute_program_)))
+    std::cerr << "Could not load the SSAO compute programs, using the "
+                 "fragment passes" << std::endl;
+
+  SetConstantUniforms();
+  SetSceneUniforms();
   return res;
 }
 
-bool GLWidget::LoadModel(const QString &filename) {
-  std::string file = filename.toUtf8().constData();
-  size_t pos = file.find_last_of(".");
-  std::string type = file.substr(pos + 1);
+void GLWidget::SetConstantUniforms() {
+  // G-buffer and SSAO targets, bound to units 9 to 15 every frame, the
+  // targets of the estimator at reduced resolution, bound to units 22 to 24,
+  // and the history of the temporal mode.
+  data_visualization::ShaderProgram<data_visualization::SsaoUniforms>
+      *ssao_programs[] = {&step_two_program_, &step_three_program_,
+                          &vertical_step_three_program_, &step_four_program_,
+                          &ssao_downsample_program_, &ssao_upsample_program_,
+                          &ssao_temporal_program_, &ssao_compute_program_,
+                          &ssao_blur_compute_program_};
+  for (const auto *program : ssao_programs) {
+    if (program->Empty()) continue;
+    program->Bind();
+    const data_visualization::SsaoUniforms &kUniforms = program->uniforms();
+    glUniform1i(kUniforms.texture_ssao_albedo, 9);
+    glUniform1i(kUniforms.texture_ssao_normal, 10);
+    glUniform1i(kUniforms.texture_ssao_depth, 11);
+    glUniform1i(kUniforms.texture_ssao_random, 12);
+    glUniform1i(kUniforms.texture_ssao_ssao, 13);
+    glUniform1i(kUniforms.texture_ssao_ssao_blur, 14);
+    glUniform1i(kUniforms.texture_ssao_lightning, 15);
+    glUniform1i(kUniforms.texture_ssao_reduced_normal, 22);
+    glUniform1i(kUniforms.texture_ssao_reduced_depth, 23);
+    glUniform1i(kUniforms.texture_ssao_reduced_ssao, 24);
+    glUniform1i(kUniforms.texture_ssao_history, kSsaoHistoryTextureUnit);
+  }
+  // The same estimator as step_two_program_, reading the reduced targets.
+  if (!reduced_step_two_program_.Empty()) {
+    reduced_step_two_program_.Bind();
+    const data_visualization::SsaoUniforms &kUniforms =
+        reduced_step_two_program_.uniforms();
+    glUniform1i(kUniforms.texture_ssao_normal, 22);
+    glUniform1i(kUniforms.texture_ssao_depth, 23);
+    glUniform1i(kUniforms.texture_ssao_random, 12);
+  }
+  // The vertical blur pass reads the output of the horizontal one.
+  if (!vertical_step_three_program_.Empty()) {
+    vertical_step_three_program_.Bind();
+    glUniform1i(vertical_step_three_program_.uniforms().texture_ssao_ssao,
+                kSsaoBlurHorizontalTextureUnit);
+  }
 
-  std::unique_ptr<data_representation::TriangleMesh> mesh =
-      std::make_unique<data_representation::TriangleMesh>();
+  data_visualization::ShaderProgram<data_visualization::ShadingUniforms>
+      *shading_programs[] = {&phong_program_,
+                             &texture_mapping_color_program_,
+                             &texture_mapping_metalness_program_,
+                             &texture_mapping_roughness_program_,
+                             &reflection_program_,
+                             &brdf_program_,
+                             &deferred_phong_program_,
+                             &deferred_texture_mapping_color_program_,
+                             &deferred_texture_mapping_metalness_program_,
+                             &deferred_texture_mapping_roughness_program_,
+                             &deferred_reflection_program_,
+                             &deferred_brdf_program_};
+  for (const auto *program : shading_programs) {
+    if (program->Empty()) continue;
+    program->Bind();
+    const data_visualization::ShadingUniforms &kUniforms = program->uniforms();
+    glUniform1i(kUniforms.texture_color, 0);
+    glUniform1i(kUniforms.texture_metalness, 1);
+    glUniform1i(kUniforms.texture_roughness, 2);
+    glUniform1i(kUniforms.texture_chosen, 3);
+    glUniform1i(kUniforms.diffuse_map, 7);
+    glUniform1i(kUniforms.specular_map, 8);
+    for (int channel = 0; channel < 3; ++channel)
+      glUniform1i(kUniforms.probe_volume[channel],
+                  kProbeVolumeTextureUnit + channel);
+    glUniform1i(kUniforms.distance_field, kDistanceFieldTextureUnit);
+    // G-buffer of the deferred mode, bound by the render graph.
+    glUniform1i(kUniforms.texture_gbuffer_normal, 10);
+    glUniform1i(kUniforms.texture_gbuffer_depth, 11);
+    glUniform1i(kUniforms.texture_gbuffer_uv, 20);
+    glUniform1i(kUniforms.texture_gbuffer_surface, 21);
+    glUniform1i(kUniforms.texture_ssao_ssao_blur, 14);
+  }
 
-  bool res = false;
-  if (type.compare("ply") == 0) {
-    res = data_representation::ReadFromPly(file, mesh.get());
+  if (!sky_program_.Empty()) {
+    sky_program_.Bind();
+    glUniform1i(sky_program_.uniforms().skybox_map, 3);
   }
+  glUseProgram(0);
+}
 
-  if (res) {
-    mesh_.reset(mesh.release());
-    camera_.UpdateModel(mesh_->min_, mesh_->max_);
+const data_visualization::ShaderProgram<data_visualization::ShadingUniforms>
+    &GLWidget::ShadingProgram() const {
+  if (shader_mode_ == 0)
+    return deferred_ ? deferred_phong_program_ : phong_program_;
+  if (shader_mode_ == 1) {
+    if (texture_mapping_mode_ == 0)
+      return deferred_ ? deferred_texture_mapping_color_program_
+                       : texture_mapping_color_program_;
+    if (texture_mapping_mode_ == 1)
+      return deferred_ ? deferred_texture_mapping_metalness_program_
+                       : texture_mapping_metalness_program_;
+    if (texture_mapping_mode_ == 2)
+      return deferred_ ? deferred_texture_mapping_roughness_program_
+                       : texture_mapping_roughness_program_;
+  }
+  if (shader_mode_ == 2)
+    return deferred_ ? deferred_reflection_program_ : reflection_program_;
+  return deferred_ ? deferred_brdf_program_ : brdf_program_;
+}
 
-    // Create / Initialize buffers.
-    glGenVertexArrays(1, &model_VAO);
-    glBindVertexArray(model_VAO);
+void GLWidget::SetSceneUniforms() {
+  data_visualization::SceneBlock scene = {};
+  for (int i = 0; i < data_representation::kShCoefficients; ++i)
+    for (int j = 0; j < 3; ++j) scene.environment_sh[i][j] = environment_sh_[i][j];
+  for (int j = 0; j < 3; ++j) {
+    scene.probe_volume_size[j] = probe_volume_.size()[j];
+    scene.probe_volume_min[j] = probe_volume_.min()[j];
+    scene.probe_volume_max[j] = probe_volume_.max()[j];
+    scene.distance_field_size[j] = distance_field_.size()[j];
+    scene.distance_field_min[j] = distance_field_.min()[j];
+    scene.distance_field_max[j] = distance_field_.max()[j];
+    scene.light_object_position[j] = light_position[j];
+    scene.light_color[j] = light_color[j];
+  }
+  scene_block_.Update(scene);
+}
 
-    GLuint VBO,nVBO,EBO,tVBO;
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * mesh_->vertices_.size(), &mesh_->vertices_[0], GL_STATIC_DRAW);
+void GLWidget::DrawModel() {
+  gl_state_.BindVertexArray(model_VAO);
+  if (!point_octree_.Empty()) {
+    const std::vector<data_representation::PointOctree::Node> &kNodes =
+        point_octree_.nodes();
+    std::vector<GLint> firsts(point_nodes_.size());
+    std::vector<GLsizei> counts(point_nodes_.size());
+    for (size_t i = 0; i < point_nodes_.size(); ++i) {
+      firsts[i] = kNodes[point_nodes_[i]].first;
+      counts[i] = kNodes[point_nodes_[i]].count;
+    }
+    glMultiDrawArrays(GL_POINTS, firsts.data(), counts.data(),
+                      static_cast<GLsizei>(point_nodes_.size()));
+  } else if (occlusion_culling_) {
+    const std::vector<data_visualization::DrawRange> &kDraws =
+        occlusion_culler_.draws();
+    std::vector<GLsizei> counts(kDraws.size());
+    std::vector<const void *> offsets(kDraws.size());
+    for (size_t i = 0; i < kDraws.size(); ++i) {
+      counts[i] = kDraws[i].count;
+      offsets[i] = reinterpret_cast<const void *>(
+          sizeof(unsigned int) * static_cast<size_t>(kDraws[i].first));
+    }
+    glMultiDrawElements(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT,
+                        offsets.data(), static_cast<GLsizei>(kDraws.size()));
+  } else {
+    glDrawElements(GL_TRIANGLES, mesh_->faces_.size(), GL_UNSIGNED_INT, 0);
+  }
+}
 
-    glGenBuffers(1, &EBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh_->faces_.size() * sizeof(unsigned int), &mesh_->faces_[0], GL_STATIC_DRAW);
+void GLWidget::LoadModel(const QString &filename) {
+  BakeModel(filename.toUtf8().constData(), true);
+}
 
-    // vertex positions
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
-    glEnableVertexAttribArray(0);
+void GLWidget::BakeModel(const std::string &file, bool report) {
+  Bake([=]() -> data_visualization::RenderThread::Change {
+    size_t pos = file.find_last_of(".");
+    std::string type = file.substr(pos + 1);
 
-    // vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
+    const std::shared_ptr<data_representation::TriangleMesh> kMesh =
+        std::make_shared<data_representation::TriangleMesh>();
 
-    // texture coords
-    glGenBuffers(1, &tVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, tVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * mesh_->textures_.size(), &mesh_->textures_[0], GL_STATIC_DRAW);
+    bool res = false;
+    if (type.compare("ply") == 0) {
+      res = data_representation::ReadFromPly(file, kMesh.get());
+    }
+    if (!res) {
+      return [=] {
+        if (report) emit ModelLoaded(false);
+      };
+    }
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, (void*)0);
+    // Meshes without faces are point clouds: they are drawn from an octree
+    // and have no baked lighting or distance field.
+    const bool kPointCloud = kMesh->faces_.empty();
+    if (!kPointCloud) LoadBakedLighting(file, kMesh.get());
+    const std::shared_ptr<data_visualization::OcclusionCuller> kCuller =
+        std::make_shared<data_visualization::OcclusionCuller>();
+    kCuller->Build(*kMesh);
+    const std::shared_ptr<data_representation::PointOctree> kOctree =
+        std::make_shared<data_representation::PointOctree>();
+    const std::shared_ptr<data_representation::DistanceField> kField =
+        std::make_shared<data_representation::DistanceField>();
+    if (kPointCloud) {
+      kOctree->Build(*kMesh);
+    } else {
+      data_representation::Bvh bvh;
+      bvh.Build(*kMesh);
+      kField->Build(*kMesh, bvh, data_representation::DistanceFieldSettings());
+    }
 
+    const std::shared_ptr<std::vector<QImage>> kTextures =
+        std::make_shared<std::vector<QImage>>(4);
+    for (int i = 0; i < 4; ++i)
+      DecodeImage(kModelTextures[i], &(*kTextures)[i]);
 
-    glGenBuffers(1, &nVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, nVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * mesh_->normals_.size(), &mesh_->normals_[0], GL_STATIC_DRAW);
+    return [=] {
+      UploadModel(kMesh, kCuller.get(), kOctree.get(), kField.get(),
+                  *kTextures);
+      if (report) emit ModelLoaded(true);
+    };
+  });
+}
 
+void GLWidget::UploadModel(
+    const std::shared_ptr<data_representation::TriangleMesh> &mesh,
+    data_visualization::OcclusionCuller *occlusion_culler,
+    data_representation::PointOctree *point_octree,
+    data_representation::DistanceField *distance_field,
+    const std::vector<QImage> &textures) {
+  ResourcesChanged();
+  mesh_ = mesh;
+  camera_.UpdateModel(mesh_->min_, mesh_->max_);
+  occlusion_culler_ = std::move(*occlusion_culler);
+  point_octree_ = std::move(*point_octree);
+  distance_field_ = std::move(*distance_field);
+
+  // Create / Initialize buffers, replacing the ones of the previous model.
+  glDeleteVertexArrays(1, &model_VAO);
+  glDeleteBuffers(kModelBufferCount, model_buffers_);
+  glGenVertexArrays(1, &model_VAO);
+  glBindVertexArray(model_VAO);
+  glGenBuffers(kModelBufferCount, model_buffers_);
+
+  if (point_octree_.Empty())
+    CreateMeshBuffers();
+  else
+    CreatePointBuffers();
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, tex_map_albedo_);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex_map_albedo_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  UploadImage(textures[0], GL_TEXTURE_2D);
+  glGenerateMipmap(GL_TEXTURE_2D);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    LoadImage("../../ViewerPBS/textures/metal_spotty_discoloration/color.jpg", GL_TEXTURE_2D);
-    glGenerateMipmap(GL_TEXTURE_2D);
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_2D, 0);
 
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, tex_map_metalness_);
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, tex_map_metalness_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  UploadImage(textures[1], GL_TEXTURE_2D);
+  glGenerateMipmap(GL_TEXTURE_2D);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    LoadImage("../../ViewerPBS/textures/metal_spotty_discoloration/metalness.jpg", GL_TEXTURE_2D);
-    glGenerateMipmap(GL_TEXTURE_2D);
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_2D, 0);
 
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE2);
+  glBindTexture(GL_TEXTURE_2D, tex_map_roughness_);
 
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, tex_map_roughness_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  UploadImage(textures[2], GL_TEXTURE_2D);
+  glGenerateMipmap(GL_TEXTURE_2D);
+
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glActiveTexture(GL_TEXTURE12);
+    glBindTexture(GL_TEXTURE_2D, tex_ssao_map_random_);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    LoadImage("../../ViewerPBS/textures/metal_spotty_discoloration/roughness.jpg", GL_TEXTURE_2D);
+    UploadImage(textures[3], GL_TEXTURE_2D);
     glGenerateMipmap(GL_TEXTURE_2D);
 
     glBindVertexArray(0);
     glBindTexture(GL_TEXTURE_2D, 0);
 
-    glActiveTexture(GL_TEXTURE12);
-      glBindTexture(GL_TEXTURE_2D, tex_ssao_map_random_);
 
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      LoadImage("../../ViewerPBS/textures/random_texture/noiseTexture.png", GL_TEXTURE_2D);
-      glGenerateMipmap(GL_TEXTURE_2D);
+  if (!distance_field_.Empty()) UploadDistanceField();
+  BakeProbeVolume();
+  SetSceneUniforms();
 
-      glBindVertexArray(0);
-      glBindTexture(GL_TEXTURE_2D, 0);
+  emit SetFaces(QString(std::to_string(mesh_->faces_.size() / 3).c_str()));
+  emit SetVertices(
+      QString(std::to_string(mesh_->vertices_.size() / 3).c_str()));
+}
 
+void GLWidget::LoadSkyboxMap(const QString &dir) {
+  BakeSkyboxMap(dir.toUtf8().constData(), true);
+}
 
-    emit SetFaces(QString(std::to_string(mesh_->faces_.size() / 3).c_str()));
-    emit SetVertices(
-        QString(std::to_string(mesh_->vertices_.size() / 3).c_str()));
-    return true;
-  }
+void GLWidget::BakeSkyboxMap(const std::string &dir, bool report) {
+  Bake([=]() -> data_visualization::RenderThread::Change {
+    const std::shared_ptr<std::vector<QImage>> kFaces =
+        std::make_shared<std::vector<QImage>>();
+    const bool kLoaded = DecodeCubeMap(dir, kFaces.get());
+
+    // Lighting coefficients for the baked radiance transfer and the probes.
+    const std::shared_ptr<data_visualization::EnvironmentMap> kEnvironment =
+        std::make_shared<data_visualization::EnvironmentMap>();
+    const std::shared_ptr<std::vector<Eigen::Vector3f>> kSh =
+        std::make_shared<std::vector<Eigen::Vector3f>>();
+    const bool kLit = kLoaded && kEnvironment->Load(dir);
+    if (kLit) kEnvironment->ProjectSh(kSh.get());
+
+    return [=] {
+      if (kLoaded) {
+        ResourcesChanged();
+        // The arrays of the previous cube map are replaced.
+        glDeleteVertexArrays(1, &sky_VAO);
+        glDeleteBuffers(1, &sky_buffer_);
+        glGenVertexArrays(1, &sky_VAO);
+        glBindVertexArray(sky_VAO);
 
-  return false;
+        glGenBuffers(1, &sky_buffer_);
+        glBindBuffer(GL_ARRAY_BUFFER, sky_buffer_);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices,
+                     GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3,
+                              (void *)0);
+
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, skybox_map_);
+        UploadCubeMap(*kFaces);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        cubemap_path = dir;
+
+        if (kLit) {
+          environment_ = std::move(*kEnvironment);
+          environment_sh_ = std::move(*kSh);
+          BakeProbeVolume();
+          SetSceneUniforms();
+        }
+      }
+      if (report) emit MapLoaded(kLoaded);
+    };
+  });
 }
 
-bool GLWidget::LoadSkyboxMap(const QString &dir) {
-  glActiveTexture(GL_TEXTURE3);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, skybox_map_);
-  bool res = LoadCubeMap(dir);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-  return res;
+void GLWidget::LoadSpecularMap(const QString &dir) {
+  BakeCubeMap(dir.toUtf8().constData(), GL_TEXTURE8, &specular_map_, true);
 }
 
-bool GLWidget::LoadSpecularMap(const QString &dir) {
-  glActiveTexture(GL_TEXTURE8);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, specular_map_);
-  std::string path = dir.toUtf8().constData();
-  bool res = LoadImage(path + "/right.png", GL_TEXTURE_CUBE_MAP_POSITIVE_X);
-  res = res && LoadImage(path + "/left.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_X);
-  res = res && LoadImage(path + "/top.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Y);
-  res = res && LoadImage(path + "/bottom.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Y);
-  res = res && LoadImage(path + "/back.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Z);
-  res = res && LoadImage(path + "/front.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Z);
+void GLWidget::LoadDiffuseMap(const QString &dir) {
+  BakeCubeMap(dir.toUtf8().constData(), GL_TEXTURE7, &diffuse_map_, true);
+}
 
-  if (res) {
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-  }
-  //bool res = LoadCubeMap(dir);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-  return res;
+void GLWidget::BakeCubeMap(const std::string &dir, GLenum unit,
+                           const GLuint *texture, bool report) {
+  Bake([=]() -> data_visualization::RenderThread::Change {
+    const std::shared_ptr<std::vector<QImage>> kFaces =
+        std::make_shared<std::vector<QImage>>();
+    const bool kLoaded = DecodeCubeMap(dir, kFaces.get());
+
+    return [=] {
+      if (kLoaded) {
+        ResourcesChanged();
+        glActiveTexture(unit);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, *texture);
+        UploadCubeMap(*kFaces);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+      }
+      if (report) emit MapLoaded(kLoaded);
+    };
+  });
 }
 
-bool GLWidget::LoadDiffuseMap(const QString &dir) {
-  glActiveTexture(GL_TEXTURE7);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, diffuse_map_);
-  std::string path = dir.toUtf8().constData();
-  bool res = LoadImage(path + "/right.png", GL_TEXTURE_CUBE_MAP_POSITIVE_X);
-  res = res && LoadImage(path + "/left.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_X);
-  res = res && LoadImage(path + "/top.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Y);
-  res = res && LoadImage(path + "/bottom.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Y);
-  res = res && LoadImage(path + "/back.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Z);
-  res = res && LoadImage(path + "/front.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Z);
+void GLWidget::ComputeDiffuseIrradianceMap() {
+  ComputeIrradianceMap(false);
+}
 
-  if (res) {
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-  }
-  //bool res = LoadCubeMap(dir);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-  return res;
+void GLWidget::ComputeSpecularIrradianceMap() {
+  ComputeIrradianceMap(true);
+}
+
+void GLWidget::ComputeIrradianceMap(bool specular) {
+  const std::function<void(bool)> kReport = [=](bool computed) {
+    if (specular)
+      emit SpecularIrradianceMapComputed(computed);
+    else
+      emit DiffuseIrradianceMapComputed(computed);
+  };
+  // cubemap_path belongs to the render thread, which starts the bakes.
+  render_thread_.Post([=] {
+    const std::string kPath = cubemap_path;
+    Bake([=]() -> data_visualization::RenderThread::Change {
+      const std::shared_ptr<std::vector<QImage>> kFaces =
+          std::make_shared<std::vector<QImage>>();
+      if (!DecodeCubeMap(kPath, kFaces.get())) return [=] { kReport(false); };
+
+      return [=] {
+        const std::shared_ptr<std::vector<QImage>> kCaptures =
+            std::make_shared<std::vector<QImage>>();
+        if (specular)
+          ConvolveSpecularIrradianceMap(*kFaces, kCaptures.get());
+        else
+          ConvolveDiffuseIrradianceMap(*kFaces, kCaptures.get());
+
+        // The faces are encoded and written off the render thread as well.
+        Bake([=]() -> data_visualization::RenderThread::Change {
+          SaveCubeMap(*kCaptures,
+                      specular
+                          ? "../../ViewerPBS/textures/SpecularIrradianceMap"
+                          : "../../ViewerPBS/textures/DiffuseIrradianceMap");
+          return [=] { kReport(true); };
+        });
+      };
+    });
+  });
 }
 
-bool GLWidget::ComputeDiffuseIrradianceMap() {
+void GLWidget::ConvolveDiffuseIrradianceMap(const std::vector<QImage> &faces,
+                                            std::vector<QImage> *captures) {
+    ResourcesChanged();
     GLint dims[4] = {0};
     glGetIntegerv(GL_VIEWPORT, dims);
     GLint scrWidth = dims[2];
@@ -423,25 +1220,7 @@ bool GLWidget::ComputeDiffuseIrradianceMap() {
     // --------------------------------------------------------------------------------
     glActiveTexture(GL_TEXTURE4);
     glBindTexture(GL_TEXTURE_CUBE_MAP, env_cubemap_);
-    bool res = LoadImage(cubemap_path + "/right.png", GL_TEXTURE_CUBE_MAP_POSITIVE_X);
-    res = res && LoadImage(cubemap_path + "/left.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_X);
-    res = res && LoadImage(cubemap_path + "/top.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Y);
-    res = res && LoadImage(cubemap_path + "/bottom.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Y);
-    res = res && LoadImage(cubemap_path + "/back.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Z);
-    res = res && LoadImage(cubemap_path + "/front.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Z);
-
-    if (res) {
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    }
-    else
-    {
-        std::cout << "Failed to load diffuse irradiance image." << std::endl;
-        return false;
-    }
+    UploadCubeMap(faces);
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
     // pbr: setup framebuffer
@@ -535,42 +1314,22 @@ bool GLWidget::ComputeDiffuseIrradianceMap() {
         glDrawArrays(GL_TRIANGLES, 0, 36);
         glBindVertexArray(0);
 
-        const int numberOfPixels = 256 * 256 * 4;
-        unsigned char pixels[numberOfPixels];
-
         /// READ THE CONTENT FROM THE FBO
+        QImage capture(256, 256, QImage::Format_RGBA8888);
         glReadBuffer(GL_COLOR_ATTACHMENT0);
-        glReadPixels(0, 0, 256, 256, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-
-        QImage image = QImage(256,256,QImage::Format_RGBA8888);
-        for (int x = 0; x < 256; ++x) {
-            for (int y = 0; y < 256; ++y) {
-                image.setPixel(x, y, qRgba(pixels[x*256*4+y*4], pixels[x*256*4+y*4+1], pixels[x*256*4+y*4+2], pixels[x*256*4+y*4+3]));
-            }
-        }
-        if (i == 0) {
-            image.save("../../ViewerPBS/textures/DiffuseIrradianceMap/right.png", "PNG"); // writes image into ba in PNG format
-        } else if (i == 1) {
-            image.save("../../ViewerPBS/textures/DiffuseIrradianceMap/left.png", "PNG"); // writes image into ba in PNG format
-        } else if (i == 2) {
-            image.save("../../ViewerPBS/textures/DiffuseIrradianceMap/top.png", "PNG"); // writes image into ba in PNG format
-        } else if (i == 3) {
-            image.save("../../ViewerPBS/textures/DiffuseIrradianceMap/bottom.png", "PNG"); // writes image into ba in PNG format
-        } else if (i == 4) {
-            image.save("../../ViewerPBS/textures/DiffuseIrradianceMap/back.png", "PNG"); // writes image into ba in PNG format
-        } else if (i == 5) {
-            image.save("../../ViewerPBS/textures/DiffuseIrradianceMap/front.png", "PNG"); // writes image into ba in PNG format
-        }
+        glReadPixels(0, 0, 256, 256, GL_RGBA, GL_UNSIGNED_BYTE, capture.bits());
+        captures->push_back(capture);
     }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // then before rendering, configure the viewport to the original framebuffer's screen dimensions
     glViewport(0, 0, scrWidth, scrHeight);
     glDeleteFramebuffers(1, &captureDiffuseFBO);
-    return true;
 }
 
-bool GLWidget::ComputeSpecularIrradianceMap() {
+void GLWidget::ConvolveSpecularIrradianceMap(const std::vector<QImage> &faces,
+                                             std::vector<QImage> *captures) {
+    ResourcesChanged();
     GLint dims[4] = {0};
     glGetIntegerv(GL_VIEWPORT, dims);
     GLint scrWidth = dims[2];
@@ -580,25 +1339,7 @@ bool GLWidget::ComputeSpecularIrradianceMap() {
     // --------------------------------------------------------------------------------
     glActiveTexture(GL_TEXTURE4);
     glBindTexture(GL_TEXTURE_CUBE_MAP, env_cubemap_);
-    bool res = LoadImage(cubemap_path + "/right.png", GL_TEXTURE_CUBE_MAP_POSITIVE_X);
-    res = res && LoadImage(cubemap_path + "/left.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_X);
-    res = res && LoadImage(cubemap_path + "/top.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Y);
-    res = res && LoadImage(cubemap_path + "/bottom.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Y);
-    res = res && LoadImage(cubemap_path + "/back.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Z);
-    res = res && LoadImage(cubemap_path + "/front.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Z);
-
-    if (res) {
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    }
-    else
-    {
-        std::cout << "Failed to load specular irradiance image." << std::endl;
-        return false;
-    }
+    UploadCubeMap(faces);
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
     // pbr: setup framebuffer
@@ -694,39 +1435,17 @@ bool GLWidget::ComputeSpecularIrradianceMap() {
         glDrawArrays(GL_TRIANGLES, 0, 36);
         glBindVertexArray(0);
 
-        const int numberOfPixels = 256 * 256 * 4;
-        unsigned char pixels[numberOfPixels];
-
         /// READ THE CONTENT FROM THE FBO
+        QImage capture(256, 256, QImage::Format_RGBA8888);
         glReadBuffer(GL_COLOR_ATTACHMENT0);
-        glReadPixels(0, 0, 256, 256, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-
-        QImage image = QImage(256,256,QImage::Format_RGBA8888);
-        for (int x = 0; x < 256; ++x) {
-            for (int y = 0; y < 256; ++y) {
-                image.setPixel(x, y, qRgba(pixels[x*256*4+y*4], pixels[x*256*4+y*4+1], pixels[x*256*4+y*4+2], pixels[x*256*4+y*4+3]));
-            }
-        }
-        if (i == 0) {
-            image.save("../../ViewerPBS/textures/SpecularIrradianceMap/right.png", "PNG"); // writes image into ba in PNG format
-        } else if (i == 1) {
-            image.save("../../ViewerPBS/textures/SpecularIrradianceMap/left.png", "PNG"); // writes image into ba in PNG format
-        } else if (i == 2) {
-            image.save("../../ViewerPBS/textures/SpecularIrradianceMap/top.png", "PNG"); // writes image into ba in PNG format
-        } else if (i == 3) {
-            image.save("../../ViewerPBS/textures/SpecularIrradianceMap/bottom.png", "PNG"); // writes image into ba in PNG format
-        } else if (i == 4) {
-            image.save("../../ViewerPBS/textures/SpecularIrradianceMap/back.png", "PNG"); // writes image into ba in PNG format
-        } else if (i == 5) {
-            image.save("../../ViewerPBS/textures/SpecularIrradianceMap/front.png", "PNG"); // writes image into ba in PNG format
-        }
+        glReadPixels(0, 0, 256, 256, GL_RGBA, GL_UNSIGNED_BYTE, capture.bits());
+        captures->push_back(capture);
     }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // then before rendering, configure the viewport to the original framebuffer's screen dimensions
     glViewport(0, 0, scrWidth, scrHeight);
     glDeleteFramebuffers(1, &captureSpecularFBO);
-    return true;
 }
 
 void GLWidget::initializeGL() {
@@ -737,14 +1456,33 @@ void GLWidget::initializeGL() {
     ssao_k_ = 2.5f;
     ssao_beta_ = 0.0001f;
     ssao_epsilon_ = 0.0001f;
+    ssao_resolution_ = 1;
+    ssao_temporal_ = false;
+    ssao_blur_radius_ = 3;
+    ssao_compute_ = false;
     ssao_render_mode_ = 5;
     skybox_mode_ = 0;
   glewInit();
+  // main requests OpenGL 4.3 when the platform supports it.
+  compute_available_ = GLEW_VERSION_4_3;
+  emit SetComputeAvailable(compute_available_);
 
   glEnable(GL_NORMALIZE);
   glEnable(GL_CULL_FACE);
   glCullFace(GL_BACK);
   glEnable(GL_DEPTH_TEST);
+  // Point cloud splats size themselves in the vertex shaders.
+  glEnable(GL_PROGRAM_POINT_SIZE);
+  // Point clouds have no baked ambient occlusion; meshes set the array.
+  glVertexAttrib1f(kAmbientOcclusionAttributeIdx, 1.0f);
+
+  glGenTextures(3, probe_volume_maps_);
+  glGenTextures(1, &distance_field_map_);
+
+  step_one_timer_.Create();
+  shaded_fragments_.Create();
+  ssao_timer_.Create();
+  ssao_blur_timer_.Create();
 
   glGenTextures(1, &tex_map_albedo_);
   glGenTextures(1, &tex_map_metalness_);
@@ -755,122 +1493,36 @@ void GLWidget::initializeGL() {
   glGenTextures(1, &specular_irradiance_map_);
   glGenTextures(1, &diffuse_map_);
   glGenTextures(1, &specular_map_);
-  glGenTextures(1, &tex_ssao_map_color_);
-  glGenTextures(1, &tex_ssao_map_normal_);
-  glGenTextures(1, &tex_ssao_map_depth_);
   glGenTextures(1, &tex_ssao_map_random_);
-  glGenTextures(1, &tex_ssao_map_ssao_);
-
-  phong_program_ = std::make_unique<QOpenGLShaderProgram>();
-  texture_mapping_color_program_ = std::make_unique<QOpenGLShaderProgram>();
-  texture_mapping_metalness_program_ = std::make_unique<QOpenGLShaderProgram>();
-  texture_mapping_roughness_program_ = std::make_unique<QOpenGLShaderProgram>();
-  reflection_program_ = std::make_unique<QOpenGLShaderProgram>();
-  brdf_program_ = std::make_unique<QOpenGLShaderProgram>();
-  sky_program_ = std::make_unique<QOpenGLShaderProgram>();
-  diffuse_irradiance_program_ = std::make_unique<QOpenGLShaderProgram>();
-  specular_irradiance_program_ = std::make_unique<QOpenGLShaderProgram>();
-  step_one_program_ = std::make_unique<QOpenGLShaderProgram>();
-  step_two_program_ = std::make_unique<QOpenGLShaderProgram>();
-  step_three_program_ = std::make_unique<QOpenGLShaderProgram>();
-  step_four_program_ = std::make_unique<QOpenGLShaderProgram>();
-
-  bool res =
-          LoadProgram(kPhongVertexShaderFile, kPhongFragmentShaderFile,
-                                     phong_program_.get());
-  res = res && LoadProgram(kTextureMappingColorVertexShaderFile, kTextureMappingColorFragmentShaderFile,
-                           texture_mapping_color_program_.get());
-  res = res && LoadProgram(kTextureMappingMetalnessVertexShaderFile, kTextureMappingMetalnessFragmentShaderFile,
-                           texture_mapping_metalness_program_.get());
-  res = res && LoadProgram(kTextureMappingRoughnessVertexShaderFile, kTextureMappingRoughnessFragmentShaderFile,
-                           texture_mapping_roughness_program_.get());
-  res = res && LoadProgram(kBRDFVertexShaderFile, kBRDFFragmentShaderFile,
-                           brdf_program_.get());
-  res = res && LoadProgram(kReflectionVertexShaderFile, kReflectionFragmentShaderFile,
-                           reflection_program_.get());
-  res = res && LoadProgram(kSkyVertexShaderFile, kSkyFragmentShaderFile,
-                           sky_program_.get());
-  res = res && LoadProgram(kDiffuseIrradianceVertexShaderFile, kDiffuseIrradianceFragmentShaderFile,
-                           diffuse_irradiance_program_.get());
-  res = res && LoadProgram(kSpecularIrradianceVertexShaderFile, kSpecularIrradianceFragmentShaderFile,
-                           specular_irradiance_program_.get());
-  res = res && LoadProgram(kStepOneVertexShaderFile, kStepOneFragmentShaderFile,
-                           step_one_program_.get());
-  res = res && LoadProgram(kStepTwoVertexShaderFile, kStepTwoFragmentShaderFile,
-                           step_two_program_.get());
-  res = res && LoadProgram(kStepThreeVertexShaderFile, kStepThreeFragmentShaderFile,
-                           step_three_program_.get());
-  res = res && LoadProgram(kStepFourVertexShaderFile, kStepFourFragmentShaderFile,
-                           step_four_program_.get());
-
-  LoadModel("../../NewModels/PLY/dragon_vrip.ply");
-  LoadSkyboxMap("../../ViewerPBS/textures/desert_specular/");
-  LoadDiffuseMap("../../ViewerPBS/textures/desert_diffuse/");
-  LoadSpecularMap("../../ViewerPBS/textures/desert_specular/");
-
-  // pbr: setup framebuffer
-  // ----------------------
-  GLint dims[4] = {0};
-  glGetIntegerv(GL_VIEWPORT, dims);
-  //GLint scrWidth = dims[2];
-  //GLint scrHeight = dims[3];
-  GLint scrWidth = 600;
-  GLint scrHeight = 600;
-
-  /*************** First render step: Normal, Albedo, Depth ***************/
-  // generate the textures where you will store the information
-  // create a color attachment texture
-  glGenTextures(1, &tex_ssao_map_color_);
-  glBindTexture(GL_TEXTURE_2D, tex_ssao_map_color_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, scrWidth, scrHeight,
-               0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-  // create a normal attachment texture
-  glGenTextures(1, &tex_ssao_map_normal_);
-  glBindTexture(GL_TEXTURE_2D, tex_ssao_map_normal_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, scrWidth, scrHeight,
-               0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-  // create a depth attachment texture
-  glGenTextures(1, &tex_ssao_map_depth_);
-  glBindTexture(GL_TEXTURE_2D, tex_ssao_map_depth_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32, scrWidth, scrHeight,
-               0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glGenTextures(2, ssao_history_maps_);
+  ssao_history_index_ = 0;
+  ssao_history_width_ = 0;
+  ssao_history_height_ = 0;
+  ssao_history_valid_ = false;
+  std::fill_n(previous_transform_, 16, 0.0f);
+  ssao_frame_ = 0;
+  ssao_still_frames_ = 0;
+  ssao_converging_ = false;
 
+  //Kernel sampling
+  data_visualization::MakeSsaoKernel(0, &ssao_kernel);
 
-  // generate the FrameBuffers and attach the textures to them
-  // generate the RenderBuffers and attach the textures to them
-  glGenFramebuffers(1, &ssao_normal_FBO);
-  glGenRenderbuffers(1, &ssao_depth_RBO);
-
-  glBindFramebuffer(GL_FRAMEBUFFER, ssao_normal_FBO);
-  glBindRenderbuffer(GL_RENDERBUFFER, ssao_depth_RBO);
-  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, scrWidth, scrHeight); // use a single renderbuffer object for depth
-  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, ssao_depth_RBO);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex_ssao_map_normal_, 0);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, tex_ssao_map_depth_, 0);
-
-  // define the array of color buffers where the fragment shader will draw into
-  glDrawBuffer(GL_COLOR_ATTACHMENT0);
-
-  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-      qDebug() << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!";
+  frame_block_.Create(data_visualization::kFrameBlockBinding);
+  material_block_.Create(data_visualization::kMaterialBlockBinding);
+  scene_block_.Create(data_visualization::kSceneBlockBinding);
+  ssao_block_.Create(data_visualization::kSsaoBlockBinding);
 
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  bool res = LoadPrograms();
 
-  /*************** Second render step: SSAO ***************/
+  BakeModel("../../NewModels/PLY/dragon_vrip.ply", false);
+  BakeSkyboxMap("../../ViewerPBS/textures/desert_specular/", false);
+  BakeCubeMap("../../ViewerPBS/textures/desert_diffuse/", GL_TEXTURE7,
+              &diffuse_map_, false);
+  BakeCubeMap("../../ViewerPBS/textures/desert_specular/", GL_TEXTURE8,
+              &specular_map_, false);
 
-  // Generate the structures (VAO, VBO) to render the quad
+  // Generate the structures (VAO, VBO) to render the screen space quad of
+  // the SSAO passes. Their targets are created by the render graph.
   glGenVertexArrays(1, &quad_VAO);
   glBindVertexArray(quad_VAO);
 
@@ -882,97 +1534,11 @@ void GLWidget::initializeGL() {
   glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
   glEnableVertexAttribArray(2);
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-
-  // create a ssao attachment texture
-  glGenTextures(1, &tex_ssao_map_ssao_);
-  glBindTexture(GL_TEXTURE_2D, tex_ssao_map_ssao_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, scrWidth, scrHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-  // generate the FrameBuffers and attach the textures to them
-  glGenFramebuffers(1, &ssao_ssao_FBO);
-
-  glBindFramebuffer(GL_FRAMEBUFFER, ssao_ssao_FBO);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex_ssao_map_ssao_, 0);
-
-  // define the array of color buffers where the fragment shader will draw into
-  glDrawBuffer(GL_COLOR_ATTACHMENT0);
-
-  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-      qDebug() << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!";
-
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-  /*************** Third render step: SSAO Blur ***************/
-
-  // create a ssao attachment texture
-  glGenTextures(1, &tex_ssao_map_ssao_blur_);
-  glBindTexture(GL_TEXTURE_2D, tex_ssao_map_ssao_blur_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, scrWidth, scrHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-  // generate the FrameBuffers and attach the textures to them
-  glGenFramebuffers(1, &ssao_ssao_blur_FBO);
-
-  glBindFramebuffer(GL_FRAMEBUFFER, ssao_ssao_blur_FBO);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex_ssao_map_ssao_blur_, 0);
-
-  // define the array of color buffers where the fragment shader will draw into
-  glDrawBuffer(GL_COLOR_ATTACHMENT0);
-
-  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-      qDebug() << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!";
-
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-  /*************** Fourth render step: Lightning Effects ***************/
-
-  // create a ssao attachment texture
-  glGenTextures(1, &tex_ssao_map_lightning_);
-  glBindTexture(GL_TEXTURE_2D, tex_ssao_map_lightning_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, scrWidth, scrHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-  // generate the FrameBuffers and attach the textures to them
-  glGenFramebuffers(1, &ssao_ssao_lightning_FBO);
-
-  glBindFramebuffer(GL_FRAMEBUFFER, ssao_ssao_lightning_FBO);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex_ssao_map_lightning_, 0);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, tex_ssao_map_color_, 0);
-
-  // define the array of color buffers where the fragment shader will draw into
-  const GLenum buffers[]{ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_DEPTH_ATTACHMENT};
-  glDrawBuffers(2, buffers);
-
-  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-      qDebug() << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!";
-
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glBindVertexArray(0);
 
   if (!res) exit(0);
 
-  //Kernel sampling
-  float twopi = 2 * M_PI;
-  for (unsigned int i = 0; i < 64; ++i)
-  {
-      float theta = twopi * randomFloats(*QRandomGenerator::global());        /* angle is uniform */
-      float r = /*ssao_radius_ **/ sqrt(randomFloats(*QRandomGenerator::global()));   /* radius proportional to sqrt(U), U~U(0,1) */
-      glm::vec2 sample(
-          r*cos(theta),
-          r*sin(theta)
-      );
-      ssao_kernel.push_back(sample);
-  }
-
+  ResourcesChanged();
   initialized_ = true;
 }
 
@@ -980,124 +1546,135 @@ void GLWidget::resizeGL(int w, int h) {
   if (h == 0) h = 1;
   width_ = w;
   height_ = h;
+  target_width_ = TargetSize(target_width_, w);
+  target_height_ = TargetSize(target_height_, h);
+  ssao_history_valid_ = false;
 
   camera_.SetViewport(0, 0, w, h);
-  camera_.SetProjection(kFieldOfView, kZNear, kZFar);
+  camera_.SetProjection(data_visualization::kFieldOfView,
+                        data_visualization::kZNear,
+                        data_visualization::kZFar);
+}
+
+void GLWidget::showEvent(QShowEvent *event) {
+  QGLWidget::showEvent(event);
+  if (!render_thread_.isRunning()) render_thread_.Start();
+}
+
+void GLWidget::resizeEvent(QResizeEvent *event) {
+  QWidget::resizeEvent(event);
+  const int kWidth = static_cast<int>(width() * devicePixelRatioF());
+  const int kHeight = static_cast<int>(height() * devicePixelRatioF());
+  render_thread_.Post([=] { resizeGL(kWidth, kHeight); });
+}
+
+void GLWidget::paintEvent(QPaintEvent *event) {
+  render_thread_.RequestFrame();
 }
 
 void GLWidget::mousePressEvent(QMouseEvent *event) {
-  if (event->button() == Qt::LeftButton) {
-    camera_.StartRotating(event->x(), event->y());
-  }
-  if (event->button() == Qt::RightButton) {
-    camera_.StartZooming(event->x(), event->y());
-  }
-  updateGL();
+  const Qt::MouseButton kButton = event->button();
+  const int kX = event->x(), kY = event->y();
+  render_thread_.Post([=] {
+    if (kButton == Qt::LeftButton) {
+      camera_.StartRotating(kX, kY);
+    }
+    if (kButton == Qt::RightButton) {
+      camera_.StartZooming(kX, kY);
+    }
+  });
 }
 
 void GLWidget::mouseMoveEvent(QMouseEvent *event) {
-  camera_.SetRotationX(event->y());
-  camera_.SetRotationY(event->x());
-  camera_.SafeZoom(event->y());
-  updateGL();
+  const int kX = event->x(), kY = event->y();
+  render_thread_.Post([=] {
+    camera_.SetRotationX(kY);
+    camera_.SetRotationY(kX);
+    camera_.SafeZoom(kY);
+  });
 }
 
 void GLWidget::mouseReleaseEvent(QMouseEvent *event) {
-  if (event->button() == Qt::LeftButton) {
-    camera_.StopRotating(event->x(), event->y());
-  }
-  if (event->button() == Qt::RightButton) {
-    camera_.StopZooming(event->x(), event->y());
-  }
-  updateGL();
+  const Qt::MouseButton kButton = event->button();
+  const int kX = event->x(), kY = event->y();
+  render_thread_.Post([=] {
+    if (kButton == Qt::LeftButton) {
+      camera_.StopRotating(kX, kY);
+    }
+    if (kButton == Qt::RightButton) {
+      camera_.StopZooming(kX, kY);
+    }
+  });
 }
 
 void GLWidget::keyPressEvent(QKeyEvent *event) {
-  if (event->key() == Qt::Key_Up) camera_.Zoom(-1);
-  if (event->key() == Qt::Key_Down) camera_.Zoom(1);
-
-  if (event->key() == Qt::Key_Left) camera_.Rotate(-1);
-  if (event->key() == Qt::Key_Right) camera_.Rotate(1);
-
-  if (event->key() == Qt::Key_W) camera_.Zoom(-1);
-  if (event->key() == Qt::Key_S) camera_.Zoom(1);
-
-  if (event->key() == Qt::Key_A) camera_.Rotate(-1);
-  if (event->key() == Qt::Key_D) camera_.Rotate(1);
-
-  if (event->key() == Qt::Key_R) {
-    phong_program_.reset();
-    phong_program_ = std::make_unique<QOpenGLShaderProgram>();
-    LoadProgram(kPhongVertexShaderFile, kPhongFragmentShaderFile,
-                phong_program_.get());
-    texture_mapping_color_program_.reset();
-    texture_mapping_color_program_ = std::make_unique<QOpenGLShaderProgram>();
-    LoadProgram(kTextureMappingColorVertexShaderFile, kTextureMappingColorFragmentShaderFile,
-                texture_mapping_color_program_.get());
-    texture_mapping_metalness_program_.reset();
-    texture_mapping_metalness_program_ = std::make_unique<QOpenGLShaderProgram>();
-    LoadProgram(kTextureMappingMetalnessVertexShaderFile, kTextureMappingMetalnessFragmentShaderFile,
-                texture_mapping_metalness_program_.get());
-    texture_mapping_roughness_program_.reset();
-    texture_mapping_roughness_program_ = std::make_unique<QOpenGLShaderProgram>();
-    LoadProgram(kTextureMappingRoughnessVertexShaderFile, kTextureMappingRoughnessFragmentShaderFile,
-                texture_mapping_roughness_program_.get());
-    reflection_program_.reset();
-    reflection_program_ = std::make_unique<QOpenGLShaderProgram>();
-    LoadProgram(kReflectionVertexShaderFile, kReflectionFragmentShaderFile,
-                reflection_program_.get());
-
-    brdf_program_.reset();
-    brdf_program_ = std::make_unique<QOpenGLShaderProgram>();
-    LoadProgram(kBRDFVertexShaderFile, kBRDFFragmentShaderFile,
-                brdf_program_.get());
-
-    sky_program_.reset();
-    sky_program_ = std::make_unique<QOpenGLShaderProgram>();
-    LoadProgram(kSkyVertexShaderFile, kSkyFragmentShaderFile,
-                sky_program_.get());
-
-    diffuse_irradiance_program_.reset();
-    diffuse_irradiance_program_ = std::make_unique<QOpenGLShaderProgram>();
-    LoadProgram(kDiffuseIrradianceVertexShaderFile, kDiffuseIrradianceFragmentShaderFile,
-                diffuse_irradiance_program_.get());
-
-    specular_irradiance_program_.reset();
-    specular_irradiance_program_ = std::make_unique<QOpenGLShaderProgram>();
-    LoadProgram(kSpecularIrradianceVertexShaderFile, kSpecularIrradianceFragmentShaderFile,
-                specular_irradiance_program_.get());
-
-    step_one_program_.reset();
-    step_one_program_ = std::make_unique<QOpenGLShaderProgram>();
-    LoadProgram(kStepOneVertexShaderFile, kStepOneFragmentShaderFile,
-                step_one_program_.get());
-
-    step_two_program_.reset();
-    step_two_program_ = std::make_unique<QOpenGLShaderProgram>();
-    LoadProgram(kStepTwoVertexShaderFile, kStepTwoFragmentShaderFile,
-                step_two_program_.get());
-
-    step_three_program_.reset();
-    step_three_program_ = std::make_unique<QOpenGLShaderProgram>();
-    LoadProgram(kStepThreeVertexShaderFile, kStepThreeFragmentShaderFile,
-                step_three_program_.get());
-
-    step_four_program_.reset();
-    step_four_program_ = std::make_unique<QOpenGLShaderProgram>();
-    LoadProgram(kStepFourVertexShaderFile, kStepFourFragmentShaderFile,
-                step_four_program_.get());
-  }
+  const int kKey = event->key();
+  render_thread_.Post([=] {
+    if (kKey == Qt::Key_Up) camera_.Zoom(-1);
+    if (kKey == Qt::Key_Down) camera_.Zoom(1);
+
+    if (kKey == Qt::Key_Left) camera_.Rotate(-1);
+    if (kKey == Qt::Key_Right) camera_.Rotate(1);
+
+    if (kKey == Qt::Key_W) camera_.Zoom(-1);
+    if (kKey == Qt::Key_S) camera_.Zoom(1);
+
+    if (kKey == Qt::Key_A) camera_.Rotate(-1);
+    if (kKey == Qt::Key_D) camera_.Rotate(1);
 
-  updateGL();
+    if (kKey == Qt::Key_R) LoadPrograms();
+
+    if (kKey == Qt::Key_C) SetContinuousRendering(!continuous_);
+    if (kKey == Qt::Key_P) SetProfiling(!profiling_);
+    if (kKey == Qt::Key_Z) shared_depth_ = !shared_depth_;
+    if (kKey == Qt::Key_F) fused_composite_ = !fused_composite_;
+  });
+}
+
+void GLWidget::ResourcesChanged() {
+  gl_state_.Invalidate();
+  ++resources_version_;
+  ssao_history_valid_ = false;
 }
 
 void GLWidget::paintGL() {
-  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  if (continuous_) {
+    ++framerate_frames_;
+    const qint64 kElapsed = framerate_clock_.elapsed();
+    if (kElapsed >= 1000) {
+      emit SetFramerate(QString::number(framerate_frames_ * 1000.0 / kElapsed,
+                                        'f', 1));
+      framerate_frames_ = 0;
+      framerate_clock_.start();
+    }
+  }
+
+  // Results of earlier frames, read without waiting for the GPU.
+  if (profiling_ && step_one_timer_.Collect())
+    emit SetGBufferTime(
+        QString("%1 ms").arg(step_one_timer_.average() / 1e6, 0, 'f', 2));
+  if (profiling_ && shaded_fragments_.Collect())
+    emit SetShadedFragments(
+        QString::number(shaded_fragments_.average(), 'f', 0));
+  const bool kSsaoTimed = profiling_ && ssao_timer_.Collect();
+  const bool kSsaoBlurTimed = profiling_ && ssao_blur_timer_.Collect();
+  if (kSsaoTimed || kSsaoBlurTimed)
+    emit SetSsaoTime(QString("%1 / %2 ms")
+                         .arg(ssao_timer_.average() / 1e6, 0, 'f', 2)
+                         .arg(ssao_blur_timer_.average() / 1e6, 0, 'f', 2));
+
+  gl_state_.BeginFrame();
+  emit SetStateCalls(QString("%1 / %2")
+                         .arg(gl_state_.issued())
+                         .arg(gl_state_.filtered()));
+
+  gl_state_.ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   //glDepthFunc(GL_LEQUAL);
 
   if (initialized_) {
-    camera_.SetViewport();
+    gl_state_.Viewport(0, 0, static_cast<GLsizei>(width_),
+                       static_cast<GLsizei>(height_));
 
     Eigen::Matrix4f projection = camera_.SetProjection();
     Eigen::Matrix4f view = camera_.SetView();
@@ -1105,6 +1682,24 @@ void GLWidget::paintGL() {
     Eigen::Matrix4f model = camera_.SetModel();
 
     Eigen::Matrix4f t = view * model;
+
+    if (!point_octree_.Empty()) {
+      // Splat diameter in pixels per object space radius over clip w; the
+      // model matrix scales uniformly.
+      point_scale_ =
+          projection(1, 1) * height_ * model.block<3, 1>(0, 0).norm();
+      point_octree_.Select(projection * view * model, point_scale_ * 0.5f,
+                           data_representation::kPointBudget, &point_nodes_);
+    }
+
+    if (occlusion_culling_ && mesh_ != nullptr) {
+      occlusion_culler_.Cull(*mesh_, projection, view, model,
+                             static_cast<int>(width_),
+                             static_cast<int>(height_));
+      emit SetCulledDraws(QString("%1 / %2")
+                              .arg(occlusion_culler_.culled())
+                              .arg(occlusion_culler_.clusters()));
+    }
     Eigen::Matrix3f normal;
     for (int i = 0; i < 3; ++i)
       for (int j = 0; j < 3; ++j) normal(i, j) = t(i, j);
@@ -1114,523 +1709,707 @@ void GLWidget::paintGL() {
     Eigen::Vector4f aux_light_position(light_position[0],light_position[1],light_position[2],1.0);
     aux_light_position = t * aux_light_position;
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex_map_albedo_);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, tex_map_metalness_);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, tex_map_roughness_);
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, skybox_map_);
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, env_cubemap_);
-    glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, diffuse_irradiance_map_);
-    glActiveTexture(GL_TEXTURE6);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, specular_irradiance_map_);
-    glActiveTexture(GL_TEXTURE7);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, diffuse_map_);
-    glActiveTexture(GL_TEXTURE8);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, specular_map_);
-    glActiveTexture(GL_TEXTURE9);
-    glBindTexture(GL_TEXTURE_2D, tex_ssao_map_color_);
-    glActiveTexture(GL_TEXTURE10);
-    glBindTexture(GL_TEXTURE_2D, tex_ssao_map_normal_);
-    glActiveTexture(GL_TEXTURE11);
-    glBindTexture(GL_TEXTURE_2D, tex_ssao_map_depth_);
-    glActiveTexture(GL_TEXTURE12);
-    glBindTexture(GL_TEXTURE_2D, tex_ssao_map_random_);
-    glActiveTexture(GL_TEXTURE13);
-    glBindTexture(GL_TEXTURE_2D, tex_ssao_map_ssao_);
-    glActiveTexture(GL_TEXTURE14);
-    glBindTexture(GL_TEXTURE_2D, tex_ssao_map_ssao_blur_);
-    glActiveTexture(GL_TEXTURE15);
-    glBindTexture(GL_TEXTURE_2D, tex_ssao_map_lightning_);
-
-
-    /*************** First render step ***************/
-    // bind the corresponding frame buffer.
-    glBindFramebuffer(GL_FRAMEBUFFER, ssao_normal_FBO);
-    //clear the buffers (at least color and depth), send the uniforms, and draw the geometry.
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-  GLint projection_location,
-        view_location,
-        inverse_view_location,
-        model_location,
-        normal_matrix_location,
-        specular_map_location,
-        diffuse_map_location,
-        texture_chosen_location,
-        fresnel_location,
-        metalness_location,
-        roughness_location,
-        albedo_location,
-        ao_location,
-        light_position_location,
-        light_color_location,
-        material_ambient_location,
-        material_diffuse_location,
-        material_specular_location,
-        material_shininess_location,
-        texture_color_location,
-        texture_metalness_location,
-        texture_roughness_location,
-        texture_ssao_albedo_location,
-        texture_ssao_normal_location,
-        texture_ssao_depth_location,
-        texture_ssao_random_location,
-        ssao_samples_location,
-        ssao_n_samples_location,
-        ssao_radius_location,
-        ssao_sigma_location,
-        ssao_k_location,
-        ssao_beta_location,
-        ssao_epsilon_location,
-        ssao_render_mode_location,
-        texture_ssao_ssao_location,
-        texture_ssao_ssao_blur_location,
-        texture_ssao_lightning_location;
-
-    if (mesh_ != nullptr) {
-
-        step_one_program_->bind();
-        projection_location = step_one_program_->uniformLocation("projection");
-        view_location = step_one_program_->uniformLocation("view");
-        model_location = step_one_program_->uniformLocation("model");
-        normal_matrix_location = step_one_program_->uniformLocation("normal_matrix");
-
-        glUniformMatrix4fv(projection_location, 1, GL_FALSE, projection.data());
-        glUniformMatrix4fv(view_location, 1, GL_FALSE, view.data());
-        glUniformMatrix4fv(model_location, 1, GL_FALSE, model.data());
-        glUniformMatrix3fv(normal_matrix_location, 1, GL_FALSE, normal.data());
-
-      // Implement model rendering.
-      // Activem l'Array a pintar
-      glBindVertexArray(model_VAO);
-      // Pintem l'escena
-      glDrawElements(GL_TRIANGLES, mesh_->faces_.size(), GL_UNSIGNED_INT, 0);
-      // Desactivem el model_VAO
-      glBindVertexArray(0);
+    gl_state_.BindTexture(0, GL_TEXTURE_2D, tex_map_albedo_);
+    gl_state_.BindTexture(1, GL_TEXTURE_2D, tex_map_metalness_);
+    gl_state_.BindTexture(2, GL_TEXTURE_2D, tex_map_roughness_);
+    gl_state_.BindTexture(3, GL_TEXTURE_CUBE_MAP, skybox_map_);
+    gl_state_.BindTexture(4, GL_TEXTURE_CUBE_MAP, env_cubemap_);
+    gl_state_.BindTexture(5, GL_TEXTURE_CUBE_MAP, diffuse_irradiance_map_);
+    gl_state_.BindTexture(6, GL_TEXTURE_CUBE_MAP, specular_irradiance_map_);
+    gl_state_.BindTexture(7, GL_TEXTURE_CUBE_MAP, diffuse_map_);
+    gl_state_.BindTexture(8, GL_TEXTURE_CUBE_MAP, specular_map_);
+    for (int channel = 0; channel < 3; ++channel)
+      gl_state_.BindTexture(kProbeVolumeTextureUnit + channel, GL_TEXTURE_3D,
+                            probe_volume_maps_[channel]);
+    gl_state_.BindTexture(kDistanceFieldTextureUnit, GL_TEXTURE_3D,
+                          distance_field_map_);
+
+
+    // With baked or distance field ambient occlusion the lighting pass
+    // composites directly into the default framebuffer, so the SSAO passes
+    // are only needed to display their intermediate results. Shaders other
+    // than the BRDF one keep screen space AO in the distance field mode.
+    // With the fused composite, screen space AO is also composited by the
+    // lighting pass, which samples the blurred target itself instead of
+    // writing the lighting and albedo targets for step_four.
+    const bool kDistanceFieldComposite = ao_mode_ == kDistanceFieldAO &&
+                                         shader_mode_ == kBrdfShader &&
+                                         !distance_field_.Empty();
+    const bool kFusedComposite = ssao_render_mode_ == 5 && fused_composite_ &&
+                                 ao_mode_ != kBakedAO &&
+                                 !kDistanceFieldComposite;
+    const bool kDirectComposite =
+        ssao_render_mode_ == 5 &&
+        (ao_mode_ == kBakedAO || kDistanceFieldComposite || kFusedComposite);
+
+    // Shared uniform blocks, uploaded only when their contents change.
+    data_visualization::FrameBlock frame = {};
+    std::copy_n(projection.data(), 16, frame.projection);
+    std::copy_n(view.data(), 16, frame.view);
+    std::copy_n(inverse_view.data(), 16, frame.inverse_view);
+    std::copy_n(model.data(), 16, frame.model);
+    for (int column = 0; column < 3; ++column)
+      std::copy_n(normal.col(column).data(), 3, &frame.normal_matrix[column * 4]);
+    std::copy_n(aux_light_position.data(), 3, frame.light_position);
+    frame.point_scale = point_scale_;
+    frame.composite_mode =
+        !kDirectComposite ? 0
+                          : kFusedComposite ? kScreenSpaceComposite
+                                            : static_cast<int>(ao_mode_);
+    frame.diffuse_mode = diffuse_mode_;
+    frame.z_near = static_cast<float>(data_visualization::kZNear);
+    frame.z_far = static_cast<float>(data_visualization::kZFar);
+    frame.viewport_size[0] = width_;
+    frame.viewport_size[1] = height_;
+    frame.target_scale[0] = width_ / target_width_;
+    frame.target_scale[1] = height_ / target_height_;
+    frame_block_.Update(frame);
+
+    data_visualization::MaterialBlock material = {};
+    for (int j = 0; j < 3; ++j) {
+      material.material_ambient[j] = material_ambient[j];
+      material.material_diffuse[j] = material_diffuse[j];
+      material.material_specular[j] = material_specular[j];
+      material.fresnel[j] = fresnel_[j];
+    }
+    material.material_shininess = material_shininess;
+    material.metalness = metalness_;
+    material.roughness = roughness_;
+    material_block_.Update(material);
+
+    data_visualization::SsaoBlock ssao = {};
+    const int kSamples = ssao_temporal_
+                             ? std::min(kTemporalSamples, ssao_n_samples_)
+                             : ssao_n_samples_;
+    // The temporal mode starts each frame at the next slice of the kernel.
+    const int kSlice = ssao_temporal_ && ssao_n_samples_ > 0
+                           ? ssao_frame_ % ssao_n_samples_ * kSamples %
+                                 ssao_n_samples_
+                           : 0;
+    for (int i = 0; i < static_cast<int>(ssao_kernel.size()); ++i) {
+      const int kSample = i < ssao_n_samples_ ? (i + kSlice) % ssao_n_samples_
+                                              : i;
+      std::copy_n(ssao_kernel[kSample].data(), 2, ssao.ssao_samples[i]);
     }
+    ssao.ssao_n_samples = kSamples;
+    ssao.ssao_radius = ssao_radius_;
+    ssao.ssao_sigma = ssao_sigma_;
+    ssao.ssao_k = ssao_k_;
+    ssao.ssao_beta = ssao_beta_;
+    ssao.ssao_epsilon = ssao_epsilon_;
+    ssao.ssao_render_mode = ssao_render_mode_;
+    ssao.ssao_resolution = ssao_resolution_;
+    std::vector<float> blur_weights;
+    data_visualization::MakeBlurWeights(ssao_blur_radius_, &blur_weights);
+    ssao.ssao_blur_radius = ssao_blur_radius_;
+    for (size_t i = 0; i < blur_weights.size(); ++i)
+      ssao.ssao_blur_weights[i][0] = blur_weights[i];
+
+    // The temporal mode keeps two histories of the size of the targets, and
+    // reprojects the one of the previous frame.
+    const Eigen::Matrix4f kTransform = projection * view * model;
+    const Eigen::Map<const Eigen::Matrix4f> kPreviousTransform(
+        previous_transform_);
+    const bool kStill = kPreviousTransform == kTransform;
+    ssao_converging_ = false;
+    if (ssao_temporal_) {
+      if (ssao_history_width_ != target_width_ ||
+          ssao_history_height_ != target_height_) {
+        for (GLuint map : ssao_history_maps_) {
+          gl_state_.BindTexture(kSsaoHistoryTextureUnit, GL_TEXTURE_2D, map);
+          glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, target_width_,
+                       target_height_, 0, GL_RG, GL_HALF_FLOAT, nullptr);
+          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        ssao_history_width_ = target_width_;
+        ssao_history_height_ = target_height_;
+        ssao_history_valid_ = false;
+      }
+      const Eigen::Matrix4f kReprojection =
+          kPreviousTransform * kTransform.inverse();
+      std::copy_n(kReprojection.data(), 16, ssao.ssao_reprojection);
+      const double kTurns = ssao_frame_ * kGoldenRatioConjugate;
+      ssao.ssao_rotation = static_cast<float>(kTurns - std::floor(kTurns));
+      ssao.ssao_blend = ssao_history_valid_ ? kTemporalBlend : 1.0f;
+
+      // This frame writes the other history and reads the one of the previous
+      // frame. More frames are needed while the camera has not been still for
+      // long enough. Updated here rather than in the temporal pass, which the
+      // graph culls when the obscurance is not displayed.
+      ssao_history_index_ = 1 - ssao_history_index_;
+      ssao_history_valid_ = true;
+      ++ssao_frame_;
+      ssao_still_frames_ = kStill ? ssao_still_frames_ + 1 : 0;
+      ssao_converging_ = ssao_still_frames_ < kTemporalFrames;
+    }
+    std::copy_n(kTransform.data(), 16, previous_transform_);
+    ssao_block_.Update(ssao);
+
+    // Cache keys of the passes, hashing what each one depends on besides the
+    // targets it reads. Tweaking the SSAO parameters only reruns the SSAO
+    // and blur passes, and tweaking the material only the lighting pass.
+    const float kViewport[4] = {width_, height_, frame.target_scale[0],
+                                frame.target_scale[1]};
+    uint64_t geometry_key = data_visualization::HashValue(resources_version_);
+    geometry_key = data_visualization::HashValue(kViewport, geometry_key);
+    geometry_key = data_visualization::HashValue(frame.projection, geometry_key);
+    geometry_key = data_visualization::HashValue(frame.view, geometry_key);
+    geometry_key = data_visualization::HashValue(frame.model, geometry_key);
+    geometry_key = data_visualization::HashValue(frame.point_scale, geometry_key);
+    geometry_key =
+        data_visualization::HashValue(occlusion_culling_, geometry_key);
+    geometry_key = data_visualization::HashValue(deferred_, geometry_key);
+
+    // The render mode is only read by the composite, and the blur
+    // parameters by the blur.
+    data_visualization::SsaoBlock ssao_parameters = ssao;
+    ssao_parameters.ssao_render_mode = 0;
+    ssao_parameters.ssao_blur_radius = 0;
+    std::fill_n(&ssao_parameters.ssao_blur_weights[0][0],
+                sizeof(ssao.ssao_blur_weights) / sizeof(float), 0.0f);
+    const uint64_t kSsaoKey = data_visualization::HashValue(ssao_parameters);
+    const uint64_t kBlurKey =
+        data_visualization::HashValue(ssao.ssao_blur_weights);
+    // The resampling passes only depend on their reads.
+    const uint64_t kResampleKey = 1;
+
+    uint64_t lighting_key = data_visualization::HashValue(resources_version_);
+    lighting_key = data_visualization::HashValue(kViewport, lighting_key);
+    lighting_key = data_visualization::HashValue(frame, lighting_key);
+    lighting_key = data_visualization::HashValue(material, lighting_key);
+    lighting_key =
+        data_visualization::HashValue(scene_block_.block(), lighting_key);
+    const unsigned int kModes[3] = {shader_mode_, texture_mapping_mode_,
+                                    skybox_mode_};
+    lighting_key = data_visualization::HashValue(kModes, lighting_key);
+    lighting_key =
+        data_visualization::HashValue(occlusion_culling_, lighting_key);
+    lighting_key = data_visualization::HashValue(deferred_, lighting_key);
+    lighting_key = data_visualization::HashValue(shared_depth_, lighting_key);
+
+    // The passes only run when the displayed output depends on them: the
+    // normal and depth modes skip the SSAO and lighting passes, and the
+    // direct composite modes only run the lighting pass.
+    // Off-screen targets of the SSAO and lighting passes, drawn with the
+    // viewport in their bottom left corner: octahedral encoded normals (see
+    // normal.glsl), single channel obscurance and RGB colors.
+    const data_visualization::RenderTargetDesc kColorTarget = {
+        GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, target_width_, target_height_};
+    const data_visualization::RenderTargetDesc kNormalTarget = {
+        GL_RG16, GL_RG, GL_UNSIGNED_SHORT, target_width_, target_height_};
+    const data_visualization::RenderTargetDesc kObscuranceTarget = {
+        GL_R8, GL_RED, GL_UNSIGNED_BYTE, target_width_, target_height_};
+    const data_visualization::RenderTargetDesc kUvTarget = {
+        GL_RG16F, GL_RG, GL_HALF_FLOAT, target_width_, target_height_};
+    const data_visualization::RenderTargetDesc kSurfaceTarget = {
+        GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, target_width_, target_height_};
+    const data_visualization::RenderTargetDesc kDepthTarget = {
+        GL_DEPTH_COMPONENT32, GL_DEPTH_COMPONENT, GL_FLOAT, target_width_,
+        target_height_};
+    render_graph_.Reset();
+    const int kAlbedo = render_graph_.CreateTarget("albedo", kColorTarget, 9);
+    const int kNormal = render_graph_.CreateTarget("normal", kNormalTarget, 10);
+    const int kDepth = render_graph_.CreateTarget("depth", kDepthTarget, 11);
+    const int kRandom =
+        render_graph_.ImportTexture("random", tex_ssao_map_random_, 12);
+    const int kSsao = render_graph_.CreateTarget("ssao", kObscuranceTarget, 13);
+    const int kSsaoBlurHorizontal = render_graph_.CreateTarget(
+        "ssao_blur_horizontal", kObscuranceTarget,
+        kSsaoBlurHorizontalTextureUnit);
+    const int kSsaoBlur =
+        render_graph_.CreateTarget("ssao_blur", kObscuranceTarget, 14);
+    const int kLighting =
+        render_graph_.CreateTarget("lighting", kColorTarget, 15);
+    // Depth of the lighting pass when it does not share the one of the
+    // G-buffer, never sampled.
+    const int kLightingDepth =
+        render_graph_.CreateTarget("lighting_depth", kDepthTarget, -1);
+    const int kUv = render_graph_.CreateTarget("uv", kUvTarget, 20);
+    const int kSurface =
+        render_graph_.CreateTarget("surface", kSurfaceTarget, 21);
+
+    // Targets of the SSAO estimator at reduced resolution, drawn with a
+    // viewport reduced by the same factor. The full resolution sizes are
+    // multiples of kTargetGranularity, which the factor divides.
+    const int kReducedWidth = target_width_ / ssao_resolution_;
+    const int kReducedHeight = target_height_ / ssao_resolution_;
+    const GLsizei kReducedViewport[2] = {
+        static_cast<GLsizei>(std::ceil(width_ / ssao_resolution_)),
+        static_cast<GLsizei>(std::ceil(height_ / ssao_resolution_))};
+    const data_visualization::RenderTargetDesc kReducedNormalTarget = {
+        GL_RG16, GL_RG, GL_UNSIGNED_SHORT, kReducedWidth, kReducedHeight};
+    const data_visualization::RenderTargetDesc kReducedObscuranceTarget = {
+        GL_R8, GL_RED, GL_UNSIGNED_BYTE, kReducedWidth, kReducedHeight};
+    const data_visualization::RenderTargetDesc kReducedDepthTarget = {
+        GL_DEPTH_COMPONENT32, GL_DEPTH_COMPONENT, GL_FLOAT, kReducedWidth,
+        kReducedHeight};
+    const int kReducedNormal = render_graph_.CreateTarget(
+        "reduced_normal", kReducedNormalTarget, 22);
+    const int kReducedDepth = render_graph_.CreateTarget(
+        "reduced_depth", kReducedDepthTarget, 23);
+    const int kReducedSsao = render_graph_.CreateTarget(
+        "reduced_ssao", kReducedObscuranceTarget, 24);
+
+    // In the temporal mode the blur reads the accumulated obscurance, bound
+    // where it would read the estimate.
+    const int kHistory = render_graph_.ImportTexture(
+        "ssao_history", ssao_history_maps_[1 - ssao_history_index_],
+        kSsaoHistoryTextureUnit);
+    const int kAccumulated = render_graph_.ImportTexture(
+        "ssao_accumulated", ssao_history_maps_[ssao_history_index_], 13);
+    const int kSsaoResult = ssao_temporal_ ? kAccumulated : kSsao;
 
-    //glDepthFunc(GL_LEQUAL);
-
-    /*sky_program_->bind();
-    projection_location = sky_program_->uniformLocation("projection");
-    view_location = sky_program_->uniformLocation("view");
-    GLint skybox_map_location = sky_program_->uniformLocation("skybox_map_");
-
-    glUniformMatrix4fv(projection_location, 1, GL_FALSE, projection.data());
-    view(0,3) = 0.f;
-    view(1,3) = 0.f;
-    view(2,3) = 0.f;
-    view(3,3) = 0.f;
-    glUniformMatrix4fv(view_location, 1, GL_FALSE, view.data());
-
-    glBindVertexArray(sky_VAO);
-    glUniform1i(skybox_map_location, 3);*/
-    // Implement the rendering of a bounding cube displaying the environment map.
-    //glDrawArrays(GL_TRIANGLES, 0, 36);
-    //glDepthFunc(GL_LESS);
-    glBindVertexArray(0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    /*************** First render step ***************/
+    // The deferred G-buffer also holds the texture coordinates and the baked
+    // lighting (radiance transfer irradiance and ambient occlusion).
+    const std::vector<int> kGBuffer =
+        deferred_ ? std::vector<int>{kNormal, kDepth, kUv, kSurface}
+                  : std::vector<int>{kNormal, kDepth};
+    render_graph_.AddPass("G-buffer", {}, kGBuffer, [&]() {
+      if (profiling_) step_one_timer_.Begin();
+
+      //clear the buffers (at least color and depth), send the uniforms, and draw the geometry.
+      gl_state_.ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+      if (mesh_ != nullptr) {
+        if (deferred_)
+          deferred_step_one_program_.Bind(&gl_state_);
+        else
+          step_one_program_.Bind(&gl_state_);
+
+        // Implement model rendering.
+        DrawModel();
+      }
+      if (profiling_) step_one_timer_.End();
+    }, geometry_key);
 
     /*************** Second render step ***************/
-    // second render pass: draw as normal
-    // ----------------------------------
-    // bind the corresponding frame buffer.
-    glBindFramebuffer(GL_FRAMEBUFFER, ssao_ssao_FBO);
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    step_two_program_->bind();
-    projection_location = step_two_program_->uniformLocation("projection");
-    view_location = step_two_program_->uniformLocation("view");
-    inverse_view_location = step_two_program_->uniformLocation("inverse_view");
-    model_location = step_two_program_->uniformLocation("model");
-    normal_matrix_location = step_two_program_->uniformLocation("normal_matrix");
-    texture_ssao_albedo_location = step_two_program_->uniformLocation("texture_ssao_albedo");
-    texture_ssao_normal_location = step_two_program_->uniformLocation("texture_ssao_normal");
-    texture_ssao_depth_location = step_two_program_->uniformLocation("texture_ssao_depth");
-    texture_ssao_random_location = step_two_program_->uniformLocation("texture_ssao_random");
-    ssao_samples_location = step_two_program_->uniformLocation("ssao_samples");
-    ssao_n_samples_location = step_two_program_->uniformLocation("ssao_n_samples");
-    ssao_radius_location = step_two_program_->uniformLocation("ssao_radius");
-    ssao_sigma_location = step_two_program_->uniformLocation("ssao_sigma");
-    ssao_k_location = step_two_program_->uniformLocation("ssao_k");
-    ssao_beta_location = step_two_program_->uniformLocation("ssao_beta");
-    ssao_epsilon_location = step_two_program_->uniformLocation("ssao_epsilon");
-    ssao_render_mode_location = step_two_program_->uniformLocation("ssao_render_mode");
-    glUniformMatrix4fv(projection_location, 1, GL_FALSE, projection.data());
-    glUniformMatrix4fv(view_location, 1, GL_FALSE, view.data());
-    glUniformMatrix4fv(model_location, 1, GL_FALSE, model.data());
-    glUniformMatrix3fv(normal_matrix_location, 1, GL_FALSE, normal.data());
-    glUniform1i(texture_ssao_albedo_location, 9);
-    glUniform1i(texture_ssao_normal_location, 10);
-    glUniform1i(texture_ssao_depth_location, 11);
-    glUniform1i(texture_ssao_random_location, 12);
-
-    glUniform2fv(ssao_samples_location,ssao_n_samples_,glm::value_ptr(ssao_kernel[0]));
-    glUniform1i(ssao_n_samples_location,ssao_n_samples_);
-    glUniform1f(ssao_radius_location,ssao_radius_);
-    glUniform1f(ssao_sigma_location,ssao_sigma_);
-    glUniform1f(ssao_k_location,ssao_k_);
-    glUniform1f(ssao_beta_location,ssao_beta_);
-    glUniform1f(ssao_epsilon_location,ssao_epsilon_);
-    glUniform1i(ssao_render_mode_location,ssao_render_mode_);
-
-    // now draw the mirror quad with screen texture
-    // --------------------------------------------
-    //glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
-
-    glBindVertexArray(quad_VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    // The compute path estimates the obscurance at full resolution in
+    // ssao.comp, and blurs it horizontally in ssao_blur.comp.
+    const bool kComputeSsao = ssao_compute_ &&
+                              !ssao_compute_program_.Empty() &&
+                              ssao_resolution_ == 1;
+    const bool kComputeBlur = ssao_compute_ &&
+                              !ssao_blur_compute_program_.Empty();
+    if (kComputeSsao) {
+      render_graph_.AddPass(
+          "SSAO compute", {kNormal, kDepth, kRandom}, {kSsao}, [&]() {
+            if (profiling_) ssao_timer_.Begin();
+            ssao_compute_program_.Bind(&gl_state_);
+            glBindImageTexture(0, render_graph_.texture(kSsao), 0, GL_FALSE, 0,
+                               GL_WRITE_ONLY, GL_R8);
+            const GLuint kGroups[2] = {
+                (static_cast<GLuint>(std::ceil(width_)) +
+                 kSsaoComputeTileSize - 1) / kSsaoComputeTileSize,
+                (static_cast<GLuint>(std::ceil(height_)) +
+                 kSsaoComputeTileSize - 1) / kSsaoComputeTileSize};
+            glDispatchCompute(kGroups[0], kGroups[1], 1);
+            // The next passes sample the image.
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            if (profiling_) ssao_timer_.End();
+          }, kSsaoKey);
+    } else if (ssao_resolution_ == 1) {
+      render_graph_.AddPass("SSAO", {kNormal, kDepth, kRandom}, {kSsao}, [&]() {
+        if (profiling_) ssao_timer_.Begin();
+        gl_state_.ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glBindVertexArray(0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        step_two_program_.Bind(&gl_state_);
+
+        gl_state_.BindVertexArray(quad_VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        if (profiling_) ssao_timer_.End();
+      }, kSsaoKey);
+    } else {
+      // The estimator runs on a downsampled copy of the G-buffer, and its
+      // result is upsampled with the full resolution depth and normals.
+      render_graph_.AddPass(
+          "SSAO downsample", {kNormal, kDepth},
+          {kReducedNormal, kReducedDepth}, [&]() {
+            gl_state_.Viewport(0, 0, kReducedViewport[0], kReducedViewport[1]);
+            gl_state_.ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            // The program writes the depth of the pixel it keeps.
+            gl_state_.DepthFunc(GL_ALWAYS);
+
+            ssao_downsample_program_.Bind(&gl_state_);
+
+            gl_state_.BindVertexArray(quad_VAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            gl_state_.DepthFunc(GL_LEQUAL);
+            gl_state_.Viewport(0, 0, static_cast<GLsizei>(width_),
+                               static_cast<GLsizei>(height_));
+          }, kResampleKey);
+
+      render_graph_.AddPass(
+          "SSAO", {kReducedNormal, kReducedDepth, kRandom}, {kReducedSsao},
+          [&]() {
+            if (profiling_) ssao_timer_.Begin();
+            gl_state_.Viewport(0, 0, kReducedViewport[0], kReducedViewport[1]);
+            gl_state_.ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            reduced_step_two_program_.Bind(&gl_state_);
+
+            gl_state_.BindVertexArray(quad_VAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            gl_state_.Viewport(0, 0, static_cast<GLsizei>(width_),
+                               static_cast<GLsizei>(height_));
+            if (profiling_) ssao_timer_.End();
+          }, kSsaoKey);
+
+      render_graph_.AddPass(
+          "SSAO upsample",
+          {kNormal, kDepth, kReducedNormal, kReducedDepth, kReducedSsao},
+          {kSsao}, [&]() {
+            gl_state_.ClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            ssao_upsample_program_.Bind(&gl_state_);
+
+            gl_state_.BindVertexArray(quad_VAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+          }, kResampleKey);
+    }
+
+    if (ssao_temporal_) {
+      render_graph_.AddPass(
+          "SSAO temporal", {kDepth, kSsao, kHistory}, {kAccumulated}, [&]() {
+            ssao_temporal_program_.Bind(&gl_state_);
+
+            gl_state_.BindVertexArray(quad_VAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+          });
+    }
 
     /*************** Third render step ***************/
-    glBindFramebuffer(GL_FRAMEBUFFER, ssao_ssao_blur_FBO);
-    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    step_three_program_->bind();
-    texture_ssao_albedo_location = step_three_program_->uniformLocation("texture_ssao_albedo");
-    texture_ssao_normal_location = step_three_program_->uniformLocation("texture_ssao_normal");
-    texture_ssao_depth_location = step_three_program_->uniformLocation("texture_ssao_depth");
-    texture_ssao_ssao_location = step_three_program_->uniformLocation("texture_ssao_ssao");
-    ssao_render_mode_location = step_three_program_->uniformLocation("ssao_render_mode");
-
-    glUniform1i(texture_ssao_albedo_location, 9);
-    glUniform1i(texture_ssao_normal_location, 10);
-    glUniform1i(texture_ssao_depth_location, 11);
-    glUniform1i(texture_ssao_ssao_location, 13);
-    glUniform1i(ssao_render_mode_location,ssao_render_mode_);
-
-    glBindVertexArray(quad_VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    // Separable bilateral blur, horizontal then vertical.
+    if (kComputeBlur) {
+      render_graph_.AddPass(
+          "SSAO blur horizontal compute", {kDepth, kSsaoResult},
+          {kSsaoBlurHorizontal}, [&]() {
+            if (profiling_) ssao_blur_timer_.Begin();
+            ssao_blur_compute_program_.Bind(&gl_state_);
+            glBindImageTexture(0, render_graph_.texture(kSsaoBlurHorizontal),
+                               0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+            const GLuint kGroups[2] = {
+                (static_cast<GLuint>(std::ceil(width_)) +
+                 kSsaoBlurComputeRowSize - 1) / kSsaoBlurComputeRowSize,
+                static_cast<GLuint>(std::ceil(height_))};
+            glDispatchCompute(kGroups[0], kGroups[1], 1);
+            // The vertical pass samples the image.
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            if (profiling_) ssao_blur_timer_.End();
+          }, kBlurKey);
+    } else {
+      render_graph_.AddPass(
+          "SSAO blur horizontal", {kDepth, kSsaoResult},
+          {kSsaoBlurHorizontal}, [&]() {
+            if (profiling_) ssao_blur_timer_.Begin();
+            gl_state_.ClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            step_three_program_.Bind(&gl_state_);
+
+            gl_state_.BindVertexArray(quad_VAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            if (profiling_) ssao_blur_timer_.End();
+          }, kBlurKey);
+    }
 
-    glBindVertexArray(0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    render_graph_.AddPass(
+        "SSAO blur vertical", {kDepth, kSsaoBlurHorizontal}, {kSsaoBlur},
+        [&]() {
+          gl_state_.ClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+          glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+          vertical_step_three_program_.Bind(&gl_state_);
+
+          gl_state_.BindVertexArray(quad_VAO);
+          glDrawArrays(GL_TRIANGLES, 0, 6);
+        }, kBlurKey);
 
     /*************** Fourth render step ***************/
-    glBindFramebuffer(GL_FRAMEBUFFER, ssao_ssao_lightning_FBO);
-    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    if (shader_mode_ == 0) {
-      phong_program_->bind();
-      projection_location = phong_program_->uniformLocation("projection");
-      view_location = phong_program_->uniformLocation("view");
-      model_location = phong_program_->uniformLocation("model");
-      normal_matrix_location = phong_program_->uniformLocation("normal_matrix");
-      light_position_location = phong_program_->uniformLocation("light_position");
-      material_ambient_location = phong_program_->uniformLocation("material_ambient");
-      material_diffuse_location = phong_program_->uniformLocation("material_diffuse");
-      material_specular_location = phong_program_->uniformLocation("material_specular");
-      material_shininess_location = phong_program_->uniformLocation("material_shininess");
-
-      glUniform3f(material_ambient_location, material_ambient[0], material_ambient[1], material_ambient[2]);
-      glUniform3f(material_diffuse_location, material_diffuse[0], material_diffuse[1], material_diffuse[2]);
-      glUniform3f(material_specular_location, material_specular[0], material_specular[1], material_specular[2]);
-      glUniform1f(material_shininess_location, material_shininess);
-    } else if (shader_mode_ == 1) {
-        if (texture_mapping_mode_ == 0) {
-            texture_mapping_color_program_->bind();
-            projection_location = texture_mapping_color_program_->uniformLocation("projection");
-            view_location = texture_mapping_color_program_->uniformLocation("view");
-            model_location = texture_mapping_color_program_->uniformLocation("model");
-            normal_matrix_location = texture_mapping_color_program_->uniformLocation("normal_matrix");
-            light_position_location = texture_mapping_color_program_->uniformLocation("light_position");
-            material_ambient_location = texture_mapping_color_program_->uniformLocation("material_ambient");
-            material_diffuse_location = texture_mapping_color_program_->uniformLocation("material_diffuse");
-            material_specular_location = texture_mapping_color_program_->uniformLocation("material_specular");
-            material_shininess_location = texture_mapping_color_program_->uniformLocation("material_shininess");
-            texture_color_location = texture_mapping_color_program_->uniformLocation("texture_color");
-        } else if (texture_mapping_mode_ == 1)  {
-            texture_mapping_metalness_program_->bind();
-            projection_location = texture_mapping_metalness_program_->uniformLocation("projection");
-            view_location = texture_mapping_metalness_program_->uniformLocation("view");
-            model_location = texture_mapping_metalness_program_->uniformLocation("model");
-            normal_matrix_location = texture_mapping_metalness_program_->uniformLocation("normal_matrix");
-            light_position_location = texture_mapping_metalness_program_->uniformLocation("light_position");
-            material_ambient_location = texture_mapping_metalness_program_->uniformLocation("material_ambient");
-            material_diffuse_location = texture_mapping_metalness_program_->uniformLocation("material_diffuse");
-            material_specular_location = texture_mapping_metalness_program_->uniformLocation("material_specular");
-            material_shininess_location = texture_mapping_metalness_program_->uniformLocation("material_shininess");
-            texture_color_location = texture_mapping_metalness_program_->uniformLocation("texture_color");
-            texture_metalness_location = texture_mapping_metalness_program_->uniformLocation("texture_metalness");
-
-            glUniform1i(texture_metalness_location, 1);
-        } else if (texture_mapping_mode_ == 2){
-            texture_mapping_roughness_program_->bind();
-            projection_location = texture_mapping_roughness_program_->uniformLocation("projection");
-            view_location = texture_mapping_roughness_program_->uniformLocation("view");
-            model_location = texture_mapping_roughness_program_->uniformLocation("model");
-            normal_matrix_location = texture_mapping_roughness_program_->uniformLocation("normal_matrix");
-            light_position_location = texture_mapping_roughness_program_->uniformLocation("light_position");
-            material_ambient_location = texture_mapping_roughness_program_->uniformLocation("material_ambient");
-            material_diffuse_location = texture_mapping_roughness_program_->uniformLocation("material_diffuse");
-            material_specular_location = texture_mapping_roughness_program_->uniformLocation("material_specular");
-            material_shininess_location = texture_mapping_roughness_program_->uniformLocation("material_shininess");
-            texture_color_location = texture_mapping_roughness_program_->uniformLocation("texture_color");
-            texture_roughness_location = texture_mapping_roughness_program_->uniformLocation("texture_roughness");
-
-
-            glUniform1i(texture_roughness_location, 2);
+    // Off-screen, the forward pass keeps the depth of the G-buffer pass and
+    // only shades the fragments that passed its depth test. Otherwise it
+    // draws into a depth target of its own.
+    const bool kSharedDepth = !deferred_ && !kDirectComposite && shared_depth_;
+    std::vector<int> lighting_writes = {data_visualization::kBackbuffer};
+    if (!kDirectComposite) lighting_writes = {kLighting, kAlbedo};
+    if (!kDirectComposite && !kSharedDepth)
+      lighting_writes.push_back(kLightingDepth);
+    std::vector<int> lighting_reads;
+    if (deferred_) lighting_reads = kGBuffer;
+    if (kFusedComposite) lighting_reads.push_back(kSsaoBlur);
+    render_graph_.AddPass("lighting", lighting_reads, lighting_writes, [&]() {
+      gl_state_.ClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+      glClear(kSharedDepth ? GL_COLOR_BUFFER_BIT
+                           : GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      ShadingProgram().Bind(&gl_state_);
+
+      if (mesh_ != nullptr) {
+        if (deferred_) {
+          // Shades the G-buffer, and writes its depth into the cleared one of
+          // the pass, which the skybox tests against. The depth the program
+          // samples is never attached, so there is no feedback loop.
+          gl_state_.DepthFunc(GL_ALWAYS);
+          gl_state_.BindVertexArray(quad_VAO);
+          glDrawArrays(GL_TRIANGLES, 0, 6);
+        } else {
+          if (profiling_) shaded_fragments_.Begin();
+          if (kSharedDepth) {
+            gl_state_.DepthMask(GL_FALSE);
+            gl_state_.DepthFunc(GL_EQUAL);
+          }
+          // Implement model rendering.
+          DrawModel();
+          if (profiling_) shaded_fragments_.End();
         }
-        glUniform1i(texture_color_location, 0);
-        glUniform3f(material_ambient_location, material_ambient[0], material_ambient[1], material_ambient[2]);
-        glUniform3f(material_diffuse_location, material_diffuse[0], material_diffuse[1], material_diffuse[2]);
-        glUniform3f(material_specular_location, material_specular[0], material_specular[1], material_specular[2]);
-        glUniform1f(material_shininess_location, material_shininess);
-      } else if (shader_mode_ == 2) {
-        reflection_program_->bind();
-        projection_location = reflection_program_->uniformLocation("projection");
-        view_location = reflection_program_->uniformLocation("view");
-        inverse_view_location = reflection_program_->uniformLocation("inverse_view");
-        model_location = reflection_program_->uniformLocation("model");
-        normal_matrix_location = reflection_program_->uniformLocation("normal_matrix");
-        texture_chosen_location = reflection_program_->uniformLocation("texture_chosen");
-
-        glUniform1i(texture_chosen_location, 3);
-        glUniformMatrix4fv(inverse_view_location, 1, GL_FALSE, inverse_view.data());
-      } else {
-      brdf_program_->bind();
-      projection_location = brdf_program_->uniformLocation("projection");
-      view_location = brdf_program_->uniformLocation("view");
-      inverse_view_location = brdf_program_->uniformLocation("inverse_view");
-      model_location = brdf_program_->uniformLocation("model");
-      normal_matrix_location = brdf_program_->uniformLocation("normal_matrix");
-      specular_map_location = brdf_program_->uniformLocation("specular_map");
-      diffuse_map_location = brdf_program_->uniformLocation("diffuse_map");
-      albedo_location = brdf_program_->uniformLocation("albedo");
-      metalness_location = brdf_program_->uniformLocation("metalness");
-      roughness_location = brdf_program_->uniformLocation("roughness");
-      ao_location = brdf_program_->uniformLocation("ao");
-      light_position_location = brdf_program_->uniformLocation("light_position");
-      light_color_location = brdf_program_->uniformLocation("light_color");
-      texture_color_location = brdf_program_->uniformLocation("texture_color");
-      texture_roughness_location = brdf_program_->uniformLocation("texture_roughness");
-      texture_metalness_location = brdf_program_->uniformLocation("texture_metalness");
-      fresnel_location = brdf_program_->uniformLocation("fresnel");
-
-      glUniform1i(diffuse_map_location, 7);
-      glUniform1i(specular_map_location, 8);
-      glUniform1i(texture_metalness_location, 1);
-      glUniform1i(texture_roughness_location, 2);
-      glUniformMatrix4fv(inverse_view_location, 1, GL_FALSE, inverse_view.data());
-    }
+      }
 
-    glUniformMatrix4fv(projection_location, 1, GL_FALSE, projection.data());
-    glUniformMatrix4fv(view_location, 1, GL_FALSE, view.data());
-    glUniformMatrix4fv(model_location, 1, GL_FALSE, model.data());
-    glUniformMatrix3fv(normal_matrix_location, 1, GL_FALSE, normal.data());
+      gl_state_.DepthFunc(GL_LEQUAL);
 
-    glUniform3f(albedo_location, 0.5f, 0.0f, 0.0f);
-    glUniform1f(metalness_location, metalness_);
-    glUniform1f(roughness_location, roughness_);
-    glUniform1f(ao_location, 1.0f);
-
-    glUniform3f(light_position_location, aux_light_position[0], aux_light_position[1], aux_light_position[2]);
-    glUniform3f(light_color_location, light_color[0], light_color[1], light_color[2]);
-    glUniform3f(fresnel_location, fresnel_[0], fresnel_[1], fresnel_[2]);
-
-    if (mesh_ != nullptr) {
-
-        /*step_one_program_->bind();
-        projection_location = step_one_program_->uniformLocation("projection");
-        view_location = step_one_program_->uniformLocation("view");
-        model_location = step_one_program_->uniformLocation("model");
-        normal_matrix_location = step_one_program_->uniformLocation("normal_matrix");*/
-
-        glUniformMatrix4fv(projection_location, 1, GL_FALSE, projection.data());
-        glUniformMatrix4fv(view_location, 1, GL_FALSE, view.data());
-        glUniformMatrix4fv(model_location, 1, GL_FALSE, model.data());
-        glUniformMatrix3fv(normal_matrix_location, 1, GL_FALSE, normal.data());
-
-      // Implement model rendering.
-      // Activem l'Array a pintar
-      glBindVertexArray(model_VAO);
-      // Pintem l'escena
-      glDrawElements(GL_TRIANGLES, mesh_->faces_.size(), GL_UNSIGNED_INT, 0);
-      // Desactivem el model_VAO
-      glBindVertexArray(0);
-    }
+      if(skybox_mode_){
+          sky_program_.Bind(&gl_state_);
 
-    glDepthFunc(GL_LEQUAL);
+          gl_state_.BindVertexArray(sky_VAO);
+          // Implement the rendering of a bounding cube displaying the environment map.
+          glDrawArrays(GL_TRIANGLES, 0, 36);
+          gl_state_.DepthFunc(GL_LESS);
 
-    if(skybox_mode_){
-        sky_program_->bind();
-        projection_location = sky_program_->uniformLocation("projection");
-        view_location = sky_program_->uniformLocation("view");
-        GLint skybox_map_location = sky_program_->uniformLocation("skybox_map_");
+      }
+      gl_state_.DepthMask(GL_TRUE);
+    }, lighting_key);
+    if (kSharedDepth) render_graph_.AttachDepth(kDepth);
 
-        glUniformMatrix4fv(projection_location, 1, GL_FALSE, projection.data());
-        view(0,3) = 0.f;
-        view(1,3) = 0.f;
-        view(2,3) = 0.f;
-        view(3,3) = 0.f;
-        glUniformMatrix4fv(view_location, 1, GL_FALSE, view.data());
+    /*************** Fifth render step ***************/
+    if (!kDirectComposite) {
+      // Inputs of the modes of step_four.frag.
+      std::vector<int> composite_reads;
+      switch (ssao_render_mode_) {
+        case 0:
+          composite_reads = {kNormal};
+          break;
+        case 1:
+          composite_reads = {kAlbedo};
+          break;
+        case 2:
+          composite_reads = {kDepth};
+          break;
+        case 3:
+          composite_reads = {kSsaoResult};
+          break;
+        case 4:
+          composite_reads = {kSsaoBlur};
+          break;
+        default:
+          composite_reads = {kAlbedo, kLighting, kSsaoBlur};
+      }
+      render_graph_.AddPass(
+          "composite", composite_reads, {data_visualization::kBackbuffer},
+          [&]() {
+            gl_state_.ClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            step_four_program_.Bind(&gl_state_);
+
+            gl_state_.BindVertexArray(quad_VAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+          });
+    }
 
-        glBindVertexArray(sky_VAO);
-        glUniform1i(skybox_map_location, 3);
-        // Implement the rendering of a bounding cube displaying the environment map.
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glDepthFunc(GL_LESS);
-        glBindVertexArray(0);
+    render_graph_.Execute(data_visualization::kBackbuffer, &gl_state_);
 
+    // A culled temporal pass wrote no history, and has nothing to converge.
+    if (ssao_temporal_ && !render_graph_.used(kAccumulated)) {
+      ssao_history_valid_ = false;
+      ssao_converging_ = false;
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    /*************** Fifth render step ***************/
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    step_four_program_->bind();
-    texture_ssao_albedo_location = step_four_program_->uniformLocation("texture_ssao_albedo");
-    texture_ssao_normal_location = step_four_program_->uniformLocation("texture_ssao_normal");
-    texture_ssao_depth_location = step_four_program_->uniformLocation("texture_ssao_depth");
-    texture_ssao_ssao_location = step_four_program_->uniformLocation("texture_ssao_ssao");
-    texture_ssao_ssao_blur_location = step_four_program_->uniformLocation("texture_ssao_ssao_blur");
-    texture_ssao_lightning_location = step_four_program_->uniformLocation("texture_ssao_lightning");
-    ssao_render_mode_location = step_four_program_->uniformLocation("ssao_render_mode");
-
-    glUniform1i(texture_ssao_albedo_location, 9);
-    glUniform1i(texture_ssao_normal_location, 10);
-    glUniform1i(texture_ssao_depth_location, 11);
-    glUniform1i(texture_ssao_ssao_location, 13);
-    glUniform1i(texture_ssao_ssao_blur_location, 14);
-    glUniform1i(texture_ssao_lightning_location, 15);
-    glUniform1i(ssao_render_mode_location,ssao_render_mode_);
-
-    glBindVertexArray(quad_VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    // Code outside paintGL may bind buffers without binding a vertex array
+    // first, so none is left bound.
+    gl_state_.BindVertexArray(0);
+  }
+}
 
-    glBindVertexArray(0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+void GLWidget::SetContinuousRendering(bool set) {
+  render_thread_.Post([=] {
+    continuous_ = set;
+    framerate_frames_ = 0;
+    framerate_clock_.start();
+    if (!set) emit SetFramerate(QString("0"));
+  });
+}
 
-  }
+void GLWidget::SetProfiling(bool set) {
+  render_thread_.Post([=] {
+    profiling_ = set;
+    step_one_timer_.Reset();
+    shaded_fragments_.Reset();
+    ssao_timer_.Reset();
+    ssao_blur_timer_.Reset();
+    if (!set) {
+      emit SetGBufferTime(QString("-"));
+      emit SetShadedFragments(QString("-"));
+      emit SetSsaoTime(QString("-"));
+    }
+  });
 }
 
 void GLWidget::SetPhong(bool set) {
-  shader_mode_ = 0;
-  updateGL();
+  render_thread_.Post([=] { shader_mode_ = 0; });
 }
 
 void GLWidget::SetTextureMapping(bool set) {
-  shader_mode_ = 1;
-  updateGL();
+  render_thread_.Post([=] { shader_mode_ = 1; });
 }
 
 void GLWidget::SetReflection(bool set) {
-  shader_mode_ = 2;
-  updateGL();
+  render_thread_.Post([=] { shader_mode_ = 2; });
 }
 
 void GLWidget::SetBRDF(bool set) {
-  shader_mode_ = 3;
-  updateGL();
+  render_thread_.Post([=] { shader_mode_ = kBrdfShader; });
 }
 
 void GLWidget::SetFresnelR(double r) {
-  fresnel_[0] = r;
-  updateGL();
+  render_thread_.Post([=] { fresnel_[0] = r; });
 }
 
 void GLWidget::SetFresnelG(double g) {
-  fresnel_[1] = g;
-  updateGL();
+  render_thread_.Post([=] { fresnel_[1] = g; });
 }
 
 void GLWidget::SetFresnelB(double b) {
-  fresnel_[2] = b;
-  updateGL();
+  render_thread_.Post([=] { fresnel_[2] = b; });
 }
 
 void GLWidget::SetMetalness(int b) {
-  metalness_= b/100.f;
-  updateGL();
+  render_thread_.Post([=] { metalness_= b/100.f; });
 }
 
 void GLWidget::SetRoughness(int b) {
-  roughness_ = b/100.f;
-  updateGL();
+  render_thread_.Post([=] { roughness_ = b/100.f; });
 }
 
 void GLWidget::SetTextureMappingMode(int mode) {
-  texture_mapping_mode_ = mode;
-  updateGL();
+  render_thread_.Post([=] { texture_mapping_mode_ = mode; });
 }
 
 void GLWidget::SetSkybox(bool mode) {
-  skybox_mode_ = mode;
-  updateGL();
+  render_thread_.Post([=] { skybox_mode_ = mode; });
+}
+
+void GLWidget::SetOcclusionCulling(bool set) {
+  render_thread_.Post([=] {
+    occlusion_culling_ = set;
+    if (!set) emit SetCulledDraws(QString("0"));
+  });
+}
+
+void GLWidget::SetDeferredShading(bool set) {
+  render_thread_.Post([=] { deferred_ = set; });
 }
 
 void GLWidget::SetSSAONormal(bool mode) {
-  ssao_render_mode_ = 0;
-  updateGL();
+  render_thread_.Post([=] { ssao_render_mode_ = 0; });
 }
 
 void GLWidget::SetSSAOAlbedo(bool mode) {
-  ssao_render_mode_ = 1;
-  updateGL();
+  render_thread_.Post([=] { ssao_render_mode_ = 1; });
 }
 
 void GLWidget::SetSSAODepth(bool mode) {
-  ssao_render_mode_ = 2;
-  updateGL();
+  render_thread_.Post([=] { ssao_render_mode_ = 2; });
 }
 
 void GLWidget::SetSSAOSSAO(bool mode) {
-  ssao_render_mode_ = 3;
-  updateGL();
+  render_thread_.Post([=] { ssao_render_mode_ = 3; });
 }
 
 void GLWidget::SetSSAOSSAOBlur(bool mode) {
-  ssao_render_mode_ = 4;
-  updateGL();
+  render_thread_.Post([=] { ssao_render_mode_ = 4; });
 }
 
 void GLWidget::SetSSAOSSAOBlurLightning(bool mode) {
-  ssao_render_mode_ = 5;
-  updateGL();
+  render_thread_.Post([=] { ssao_render_mode_ = 5; });
+}
+
+void GLWidget::SetScreenSpaceAO(bool set) {
+  render_thread_.Post([=] { ao_mode_ = kScreenSpaceAO; });
+}
+
+void GLWidget::SetBakedAO(bool set) {
+  render_thread_.Post([=] { ao_mode_ = kBakedAO; });
+}
+
+void GLWidget::SetDistanceFieldAO(bool set) {
+  render_thread_.Post([=] { ao_mode_ = kDistanceFieldAO; });
+}
+
+void GLWidget::SetIrradianceMapDiffuse(bool set) {
+  render_thread_.Post([=] { diffuse_mode_ = kIrradianceMapDiffuse; });
+}
+
+void GLWidget::SetRadianceTransferDiffuse(bool set) {
+  render_thread_.Post([=] { diffuse_mode_ = kRadianceTransferDiffuse; });
+}
+
+void GLWidget::SetProbeVolumeDiffuse(bool set) {
+  render_thread_.Post([=] { diffuse_mode_ = kProbeVolumeDiffuse; });
 }
 
 void GLWidget::SetSSAONSamples(int n_samples) {
-  ssao_n_samples_ = n_samples;
-  updateGL();
+  render_thread_.Post([=] { ssao_n_samples_ = n_samples; });
 }
 
 void GLWidget::SetSSAORadius(double radius) {
-  ssao_radius_ = radius;
-  updateGL();
+  render_thread_.Post([=] { ssao_radius_ = radius; });
 }
 
 void GLWidget::SetSSAOSigma(double sigma) {
-  ssao_sigma_ = sigma;
-  updateGL();
+  render_thread_.Post([=] { ssao_sigma_ = sigma; });
 }
 
 void GLWidget::SetSSAOK(double k) {
-  ssao_k_ = k;
-  updateGL();
+  render_thread_.Post([=] { ssao_k_ = k; });
 }
 
 void GLWidget::SetSSAOBeta(double beta) {
-  ssao_beta_ = beta;
-  updateGL();
+  render_thread_.Post([=] { ssao_beta_ = beta; });
 }
 
 void GLWidget::SetSSAOEpsilon(double epsilon) {
-  ssao_epsilon_ = epsilon;
-  updateGL();
+  render_thread_.Post([=] { ssao_epsilon_ = epsilon; });
+}
+
+void GLWidget::SetSSAOResolution(int index) {
+  render_thread_.Post([=] { ssao_resolution_ = 1 << index; });
+}
+
+void GLWidget::SetSSAOBlurRadius(int radius) {
+  render_thread_.Post([=] {
+    ssao_blur_radius_ =
+        std::min(std::max(radius, 1), data_visualization::kMaxBlurRadius);
+  });
+}
+
+void GLWidget::SetSSAOCompute(bool set) {
+  render_thread_.Post([=] {
+    ssao_compute_ = set;
+    // The averages of one path are not mixed with the other.
+    ssao_timer_.Reset();
+    ssao_blur_timer_.Reset();
+  });
+}
+
+void GLWidget::SetSSAOTemporal(bool set) {
+  render_thread_.Post([=] {
+    ssao_temporal_ = set;
+    ssao_history_valid_ = false;
+  });
 }
@@ -4,16 +4,33 @@
 #define GLWIDGET_H_
 
 #include <GL/glew.h>
+#include <QElapsedTimer>
 #include <QGLWidget>
 #include <QImage>
 #include <QMouseEvent>
 #include <QOpenGLShaderProgram>
 #include <QString>
+#include <QThreadPool>
 
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include "./camera.h"
+#include "./distance_field.h"
+#include "./environment_map.h"
+#include "./gl_query.h"
+#include "./gl_state_cache.h"
+#include "./irradiance_volume.h"
+#include "./occlusion_culler.h"
+#include "./point_octree.h"
+#include "./render_graph.h"
+#include "./render_thread.h"
+#include "./shader_program.h"
 #include "./triangle_mesh.h"
+#include "./uniform_blocks.h"
 
 class GLWidget : public QGLWidget {
   Q_OBJECT
@@ -24,37 +41,40 @@ class GLWidget : public QGLWidget {
 
   /**
    * @brief LoadModel Loads a PLY model at the filename path into the mesh_ data
-   * structure.
+   * structure. The model is read and its lighting baked on a worker thread,
+   * and uploaded on the render thread; returns right away, and ModelLoaded
+   * reports the result.
    * @param filename Path to the PLY model.
-   * @return Whether it was able to load the model.
    */
-  bool LoadModel(const QString &filename);
+  void LoadModel(const QString &filename);
 
   /**
    * @brief LoadSpecularMap Will load load a cube map that will be used for the
-   * specular component.
+   * specular component. Returns right away, and MapLoaded reports the result.
    * @param filename Path to the directory containing the 6 textures (right,
    * left, top, bottom, front back) of the sube map that will be used for the
    * specular component.
-   * @return Whether it was able to load the textures.
    */
-  bool LoadSpecularMap(const QString &filename);
-  bool LoadSkyboxMap(const QString &filename);
+  void LoadSpecularMap(const QString &filename);
+  void LoadSkyboxMap(const QString &filename);
 
   /**
    * @brief LoadDiffuseMap Will load load a cube map that will be used for the
-   * specular component.
+   * specular component. Returns right away, and MapLoaded reports the result.
    * @param filename Path to the directory containing the 6 textures (right,
    * left, top, bottom, front back) of the sube map that will be used for the
    * diffuse component.
-   * @return Whether it was able to load the textures.
    */
-  bool LoadDiffuseMap(const QString &filename);
-
-  bool ComputeDiffuseIrradianceMap();
-  bool ComputeSpecularIrradianceMap();
+  void LoadDiffuseMap(const QString &filename);
 
-  bool LoadCubeMap(const QString &filename);
+  /**
+   * @brief ComputeDiffuseIrradianceMap, ComputeSpecularIrradianceMap Convolve
+   * the skybox into an irradiance map and write its faces. Return right away,
+   * and DiffuseIrradianceMapComputed / SpecularIrradianceMapComputed report
+   * the result.
+   */
+  void ComputeDiffuseIrradianceMap();
+  void ComputeSpecularIrradianceMap();
 
  protected:
   /**
@@ -70,35 +90,266 @@ class GLWidget : public QGLWidget {
    */
   void resizeGL(int w, int h);
 
+  /**
+   * @brief showEvent Starts the render thread the first time the widget is
+   * shown, once it has a native window.
+   */
+  void showEvent(QShowEvent *event);
+
+  /**
+   * @brief resizeEvent Posts the new size to the render thread, instead of
+   * resizing on the GUI thread.
+   */
+  void resizeEvent(QResizeEvent *event);
+
+  /**
+   * @brief paintEvent Requests a frame from the render thread.
+   */
+  void paintEvent(QPaintEvent *event);
+
   void mousePressEvent(QMouseEvent *event);
   void mouseMoveEvent(QMouseEvent *event);
   void mouseReleaseEvent(QMouseEvent *event);
   void keyPressEvent(QKeyEvent *event);
 
  private:
-  std::unique_ptr<QOpenGLShaderProgram> phong_program_,
-                                        texture_mapping_color_program_,
-                                        texture_mapping_metalness_program_,
-                                        texture_mapping_roughness_program_,
-                                        step_one_program_,
-                                        step_two_program_,
-                                        step_three_program_,
-                                        step_four_program_;
+  /**
+   * @brief Bake Runs bake on bake_pool_, off the GUI and render threads, and
+   * posts the change it returns to the render thread, which uploads the
+   * results.
+   */
+  void Bake(const std::function<data_visualization::RenderThread::Change()>
+                &bake);
+
+  /**
+   * @brief BakeModel Reads a model and bakes its lighting and distance field
+   * on bake_pool_, then uploads it with UploadModel.
+   * @param file Path to the PLY model.
+   * @param report Whether ModelLoaded reports the result.
+   */
+  void BakeModel(const std::string &file, bool report);
+
+  /**
+   * @brief UploadModel Replaces the model and its buffers with a baked one.
+   */
+  void UploadModel(
+      const std::shared_ptr<data_representation::TriangleMesh> &mesh,
+      data_visualization::OcclusionCuller *occlusion_culler,
+      data_representation::PointOctree *point_octree,
+      data_representation::DistanceField *distance_field,
+      const std::vector<QImage> &textures);
+
+  /**
+   * @brief BakeSkyboxMap Decodes the skybox faces and projects their lighting
+   * on bake_pool_, then uploads them and rebakes the probes.
+   * @param dir Path to the directory containing the 6 faces.
+   * @param report Whether MapLoaded reports the result.
+   */
+  void BakeSkyboxMap(const std::string &dir, bool report);
+
+  /**
+   * @brief BakeCubeMap Decodes the faces of a cube map on bake_pool_, then
+   * uploads them to a texture.
+   * @param dir Path to the directory containing the 6 faces.
+   * @param unit Texture unit the cube map is bound to.
+   * @param texture Texture name, read on the render thread.
+   * @param report Whether MapLoaded reports the result.
+   */
+  void BakeCubeMap(const std::string &dir, GLenum unit, const GLuint *texture,
+                   bool report);
+
+  /**
+   * @brief ComputeIrradianceMap Decodes the skybox on bake_pool_, convolves
+   * it on the render thread, and writes the faces on bake_pool_.
+   */
+  void ComputeIrradianceMap(bool specular);
+
+  /**
+   * @brief ConvolveDiffuseIrradianceMap, ConvolveSpecularIrradianceMap Render
+   * the irradiance map of the decoded skybox faces and read back its faces.
+   */
+  void ConvolveDiffuseIrradianceMap(const std::vector<QImage> &faces,
+                                    std::vector<QImage> *captures);
+  void ConvolveSpecularIrradianceMap(const std::vector<QImage> &faces,
+                                     std::vector<QImage> *captures);
+
+  /**
+   * @brief BakeProbeVolume Bakes the irradiance probes on bake_pool_ once both
+   * the model and the skybox are loaded, and uploads them.
+   */
+  void BakeProbeVolume();
+
+  /**
+   * @brief UploadProbeVolume Uploads probe_volume_ to its textures.
+   */
+  void UploadProbeVolume();
+
+  /**
+   * @brief UploadDistanceField Uploads distance_field_ to its texture.
+   */
+  void UploadDistanceField();
+
+  /**
+   * @brief CreateMeshBuffers Uploads the vertex attributes and the faces of a
+   * triangle mesh to the bound vertex array.
+   */
+  void CreateMeshBuffers();
+
+  /**
+   * @brief CreatePointBuffers Uploads the points of the octree nodes to the
+   * bound vertex array.
+   */
+  void CreatePointBuffers();
+
+  /**
+   * @brief DrawModel Draws the model: the selected octree nodes of a point
+   * cloud, or the triangles restricted to the clusters that passed the last
+   * occlusion test when culling is enabled.
+   */
+  void DrawModel();
+
+  /**
+   * @brief LoadPrograms Compiles and links all the shader programs, keeping
+   * the previous version of those that fail, and sends their constant
+   * uniforms.
+   * @return Whether all of them were loaded.
+   */
+  bool LoadPrograms();
+
+  /**
+   * @brief SetConstantUniforms Sends the uniforms that never change after
+   * linking: the sampler units.
+   */
+  void SetConstantUniforms();
+
+  /**
+   * @brief ShadingProgram The lighting program of the selected shader and
+   * texture mapping modes, deferred or not.
+   */
+  const data_visualization::ShaderProgram<data_visualization::ShadingUniforms>
+      &ShadingProgram() const;
+
+  /**
+   * @brief SetSceneUniforms Updates the Scene block, which only changes with
+   * the model or the skybox: the environment lighting, the probe volume and
+   * the distance field bounds.
+   */
+  void SetSceneUniforms();
+
+  data_visualization::ShaderProgram<data_visualization::ShadingUniforms>
+      phong_program_, texture_mapping_color_program_,
+      texture_mapping_metalness_program_, texture_mapping_roughness_program_;
+
+  /**
+   * @brief step_one_program_ ... step_four_program_ The SSAO passes: G-buffer,
+   * estimator, horizontal blur and composite.
+   */
+  data_visualization::ShaderProgram<data_visualization::GeometryUniforms>
+      step_one_program_;
+  data_visualization::ShaderProgram<data_visualization::SsaoUniforms>
+      step_two_program_, step_three_program_, step_four_program_;
+
+  /**
+   * @brief vertical_step_three_program_ The vertical pass of the blur,
+   * reading the output of the horizontal one.
+   */
+  data_visualization::ShaderProgram<data_visualization::SsaoUniforms>
+      vertical_step_three_program_;
+
+  /**
+   * @brief ssao_compute_program_ The SSAO estimator in a compute shader, with
+   * shared memory depth tiles. Empty when compute shaders are not available.
+   */
+  data_visualization::ShaderProgram<data_visualization::SsaoUniforms>
+      ssao_compute_program_;
+
+  /**
+   * @brief ssao_blur_compute_program_ The horizontal pass of the blur in a
+   * compute shader, with the taps of a row in shared memory. Empty when
+   * compute shaders are not available.
+   */
+  data_visualization::ShaderProgram<data_visualization::SsaoUniforms>
+      ssao_blur_compute_program_;
+
+  /**
+   * @brief ssao_downsample_program_ ... ssao_upsample_program_ The SSAO
+   * estimator at reduced resolution: the downsampling of the G-buffer, the
+   * estimator reading the reduced targets, and the joint bilateral
+   * upsampling of its result.
+   */
+  data_visualization::ShaderProgram<data_visualization::SsaoUniforms>
+      ssao_downsample_program_, reduced_step_two_program_,
+      ssao_upsample_program_;
+
+  /**
+   * @brief ssao_temporal_program_ Blends the SSAO estimate with the
+   * reprojected history in the temporal mode.
+   */
+  data_visualization::ShaderProgram<data_visualization::SsaoUniforms>
+      ssao_temporal_program_;
+
   /**
    * @brief program_ The reflection shader program.
    */
-  std::unique_ptr<QOpenGLShaderProgram> reflection_program_;
+  data_visualization::ShaderProgram<data_visualization::ShadingUniforms>
+      reflection_program_;
 
   /**
    * @brief program_ The brdf shader program.
    */
-  std::unique_ptr<QOpenGLShaderProgram> brdf_program_;
+  data_visualization::ShaderProgram<data_visualization::ShadingUniforms>
+      brdf_program_;
+
+  /**
+   * @brief deferred_step_one_program_ ... deferred_brdf_program_ Programs of
+   * the deferred mode, built from the same sources with DEFERRED defined: the
+   * G-buffer pass also writes the texture coordinates and the baked lighting,
+   * and the lighting programs run as full screen passes that read it.
+   */
+  data_visualization::ShaderProgram<data_visualization::GeometryUniforms>
+      deferred_step_one_program_;
+  data_visualization::ShaderProgram<data_visualization::ShadingUniforms>
+      deferred_phong_program_, deferred_texture_mapping_color_program_,
+      deferred_texture_mapping_metalness_program_,
+      deferred_texture_mapping_roughness_program_,
+      deferred_reflection_program_, deferred_brdf_program_;
+
+  /**
+   * @brief deferred_ Whether the model is rasterized once, into the G-buffer,
+   * and shaded from it.
+   */
+  bool deferred_;
 
 
   /**
    * @brief program_ The skybox shader program.
    */
-  std::unique_ptr<QOpenGLShaderProgram> sky_program_;
+  data_visualization::ShaderProgram<data_visualization::SkyUniforms>
+      sky_program_;
+
+  /**
+   * @brief frame_block_ ... ssao_block_ Uniform buffers shared by all the
+   * programs that declare the corresponding block.
+   */
+  data_visualization::UniformBuffer<data_visualization::FrameBlock>
+      frame_block_;
+  data_visualization::UniformBuffer<data_visualization::MaterialBlock>
+      material_block_;
+  data_visualization::UniformBuffer<data_visualization::SceneBlock>
+      scene_block_;
+  data_visualization::UniformBuffer<data_visualization::SsaoBlock>
+      ssao_block_;
+
+  /**
+   * @brief gl_state_ Filters the redundant state changes of paintGL.
+   */
+  data_visualization::GLStateCache gl_state_;
+
+  /**
+   * @brief render_graph_ Passes of the frame, rebuilt by paintGL, and the
+   * pool of their render targets.
+   */
+  data_visualization::RenderGraph render_graph_;
 
   std::unique_ptr<QOpenGLShaderProgram> diffuse_irradiance_program_;
   std::unique_ptr<QOpenGLShaderProgram> specular_irradiance_program_;
@@ -109,9 +360,10 @@ class GLWidget : public QGLWidget {
   data_visualization::Camera camera_;
 
   /**
-   * @brief mesh_ Data structure representing a triangle mesh.
+   * @brief mesh_ Data structure representing a triangle mesh. Shared with the
+   * bakes still reading it when it is replaced.
    */
-  std::unique_ptr<data_representation::TriangleMesh> mesh_;
+  std::shared_ptr<data_representation::TriangleMesh> mesh_;
 
   /**
    * @brief diffuse_map_ Diffuse cubemap texture.
@@ -138,10 +390,73 @@ class GLWidget : public QGLWidget {
    */
   float height_;
 
+  /**
+   * @brief target_width_, target_height_ Size of the off-screen targets, at
+   * least the viewport size. It grows in steps and only shrinks when the
+   * viewport gets much smaller, so that dragging the window does not
+   * reallocate the targets on every resize.
+   */
+  int target_width_, target_height_;
+
   /**
    * @brief reflection_ Whether to use the reflection shader or the brdf shader.
    */
   unsigned int shader_mode_,texture_mapping_mode_, ssao_render_mode_, skybox_mode_;
+
+  /**
+   * @brief ao_mode_ Whether ambient occlusion comes from the SSAO passes, from
+   * the per-vertex values baked when loading the model or from the distance
+   * field.
+   */
+  unsigned int ao_mode_;
+
+  /**
+   * @brief diffuse_mode_ Whether the diffuse image based lighting comes from
+   * the irradiance map or from the baked radiance transfer.
+   */
+  unsigned int diffuse_mode_;
+
+  /**
+   * @brief occlusion_culler_ Clusters of the model and their visibility,
+   * updated at the start of every frame when occlusion_culling_ is set.
+   */
+  data_visualization::OcclusionCuller occlusion_culler_;
+  bool occlusion_culling_;
+
+  /**
+   * @brief point_octree_ Level of detail hierarchy of point clouds, empty for
+   * triangle meshes. point_nodes_ are the nodes selected for the current
+   * frame and point_scale_ converts splat radii to point sizes.
+   */
+  data_representation::PointOctree point_octree_;
+  std::vector<int> point_nodes_;
+  float point_scale_;
+
+  /**
+   * @brief environment_sh_ Spherical harmonics projection of the skybox, dotted
+   * with the per-vertex radiance transfer.
+   */
+  std::vector<Eigen::Vector3f> environment_sh_;
+
+  /**
+   * @brief environment_ CPU copy of the skybox, lighting the probe bake.
+   */
+  data_visualization::EnvironmentMap environment_;
+
+  /**
+   * @brief probe_volume_ Irradiance probes around the model, uploaded to the
+   * probe_volume_maps_ 3D textures (one per color channel).
+   */
+  data_visualization::IrradianceVolume probe_volume_;
+  GLuint probe_volume_maps_[3];
+
+  /**
+   * @brief distance_field_ Signed distance field of the model, uploaded to
+   * distance_field_map_ and cone traced by the BRDF shader for ambient
+   * occlusion and soft shadows.
+   */
+  data_representation::DistanceField distance_field_;
+  GLuint distance_field_map_;
   std::string cubemap_path;
 
   /**
@@ -151,18 +466,198 @@ class GLWidget : public QGLWidget {
   float metalness_, roughness_;
 
   GLuint sky_VAO, model_VAO, quad_VAO;
-  GLuint skybox_map_, tex_map_albedo_, tex_map_metalness_, tex_map_roughness_, env_cubemap_, diffuse_irradiance_map_, specular_irradiance_map_, tex_ssao_map_color_,tex_ssao_map_normal_, tex_ssao_map_depth_, tex_ssao_map_random_, tex_ssao_map_ssao_, tex_ssao_map_ssao_blur_, tex_ssao_map_lightning_;
-  GLuint captureDiffuseFBO, captureDiffuseRBO, captureSpecularFBO, captureSpecularRBO, ssao_normal_FBO, ssao_depth_RBO, ssao_ssao_FBO, ssao_ssao_blur_FBO, ssao_ssao_lightning_FBO;
+
+  /**
+   * @brief ModelBuffer Buffers of the model vertex array (model_buffers_).
+   * Point clouds only use the position and normal buffers.
+   */
+  enum ModelBuffer {
+    kPositionBuffer,
+    kIndexBuffer,
+    kNormalBuffer,
+    kTextureBuffer,
+    kAmbientOcclusionBuffer,
+    kRadianceTransferBuffer,
+    kModelBufferCount
+  };
+
+  /**
+   * @brief sky_buffer_, model_buffers_ Buffers of sky_VAO and model_VAO,
+   * deleted with them when a new cube map or model replaces them.
+   */
+  GLuint sky_buffer_;
+  GLuint model_buffers_[kModelBufferCount];
+  GLuint skybox_map_, tex_map_albedo_, tex_map_metalness_, tex_map_roughness_, env_cubemap_, diffuse_irradiance_map_, specular_irradiance_map_, tex_ssao_map_random_;
+  GLuint captureDiffuseFBO, captureDiffuseRBO, captureSpecularFBO, captureSpecularRBO;
+
+  /**
+   * @brief ResourcesChanged Called by the entry points that change GL objects
+   * or state outside paintGL: invalidates the state cache and the results of
+   * the cached passes.
+   */
+  void ResourcesChanged();
+
+  /**
+   * @brief resources_version_ Incremented by ResourcesChanged, and part of
+   * the cache keys of the passes.
+   */
+  uint64_t resources_version_;
+
+  /**
+   * @brief render_thread_ Thread that owns the context and renders the
+   * frames. Every member read by paintGL is changed on it: the slots and
+   * input events post their changes, and the loaders their uploads.
+   */
+  data_visualization::RenderThread render_thread_;
+
+  /**
+   * @brief bake_pool_ Runs the bakes of the loaders off the GUI and render
+   * threads. A single thread, so that they finish in the order they start.
+   */
+  QThreadPool bake_pool_;
+
+  /**
+   * @brief baked_ Uploads of the finished bakes, which the GUI thread posts
+   * to the render thread (PostBaked), guarded by baked_mutex_.
+   */
+  std::vector<data_visualization::RenderThread::Change> baked_;
+  std::mutex baked_mutex_;
+
+  /**
+   * @brief ReleaseGL Deletes the GL objects, on the render thread when it
+   * stops.
+   */
+  void ReleaseGL();
+
+  /**
+   * @brief continuous_ Whether frames are rendered back to back, for
+   * benchmarking, instead of on demand.
+   */
+  bool continuous_;
+
+  /**
+   * @brief framerate_clock_ framerate_frames_ Frames rendered since the
+   * framerate was last reported in continuous mode.
+   */
+  QElapsedTimer framerate_clock_;
+  int framerate_frames_;
+
+  /**
+   * @brief profiling_ Whether the GPU queries of the profiling labels are
+   * issued. Toggled with P.
+   */
+  bool profiling_;
+
+  /**
+   * @brief step_one_timer_ GPU time of the first SSAO step (G-buffer), in
+   * nanoseconds.
+   */
+  data_visualization::QueryAverager step_one_timer_;
+
+  /**
+   * @brief shared_depth_ Whether the forward lighting pass tests against the
+   * depth of the G-buffer pass with GL_EQUAL, shading each pixel once.
+   */
+  bool shared_depth_;
+
+  /**
+   * @brief fused_composite_ Whether the lighting pass composites the blurred
+   * screen space ambient occlusion into the default framebuffer itself, in
+   * the default render mode, instead of leaving it to step_four.
+   */
+  bool fused_composite_;
+
+  /**
+   * @brief shaded_fragments_ Fragments shaded by the model in the forward
+   * lighting pass, while profiling.
+   */
+  data_visualization::QueryAverager shaded_fragments_;
+
+  /**
+   * @brief ssao_timer_, ssao_blur_timer_ GPU time of the SSAO estimator and
+   * of the horizontal blur, in nanoseconds, in either path.
+   */
+  data_visualization::QueryAverager ssao_timer_;
+  data_visualization::QueryAverager ssao_blur_timer_;
 
   int ssao_n_samples_;
   float ssao_radius_,ssao_sigma_,ssao_k_,ssao_beta_,ssao_epsilon_;
 
+  /**
+   * @brief ssao_resolution_ Full resolution pixels per side of the pixels the
+   * SSAO estimator runs at: 1, 2 or 4.
+   */
+  int ssao_resolution_;
+
+  /**
+   * @brief ssao_temporal_ Whether the SSAO estimate is accumulated over
+   * frames, with the kernel rotated every frame and the history reprojected.
+   */
+  bool ssao_temporal_;
+
+  /**
+   * @brief ssao_blur_radius_ Taps on each side of the pixel in both passes of
+   * the SSAO blur.
+   */
+  int ssao_blur_radius_;
+
+  /**
+   * @brief ssao_compute_ Whether the SSAO estimator and the horizontal blur
+   * run in ssao_compute_program_ and ssao_blur_compute_program_. The
+   * estimator only at full resolution; the fragment passes are used
+   * otherwise, or when the programs are empty.
+   */
+  bool ssao_compute_;
+
+  /**
+   * @brief compute_available_ Whether the context supports compute shaders
+   * (OpenGL 4.3).
+   */
+  bool compute_available_;
+
+  /**
+   * @brief ssao_history_maps_ Accumulated obscurance and eye space depth
+   * (RG16F) of the last two frames, written alternately.
+   * ssao_history_index_ is the one the next frame writes.
+   */
+  GLuint ssao_history_maps_[2];
+  int ssao_history_index_;
+  int ssao_history_width_, ssao_history_height_;
+
+  /**
+   * @brief ssao_history_valid_ Whether the history read by the next frame
+   * belongs to the current model and viewport.
+   */
+  bool ssao_history_valid_;
+
+  /**
+   * @brief previous_transform_ Projection, view and model transform of the
+   * previous frame, which the history is reprojected with (column major).
+   */
+  float previous_transform_[16];
+
+  /**
+   * @brief ssao_frame_ Frames accumulated so far, which rotate the kernel.
+   * ssao_still_frames_ counts those with a still camera, and
+   * ssao_converging_ asks for another frame until there are
+   * kTemporalFrames of them.
+   */
+  unsigned int ssao_frame_;
+  int ssao_still_frames_;
+  bool ssao_converging_;
+
  protected slots:
   /**
    * @brief paintGL Function that handles rendering the scene.
    */
   void paintGL();
 
+  /**
+   * @brief PostBaked Posts the uploads of the finished bakes to the render
+   * thread. Queued from Baked, as only the GUI thread posts changes.
+   */
+  void PostBaked();
+
   /**
    * @brief SetReflection Enables the reflection shader.
    */
@@ -195,6 +690,18 @@ class GLWidget : public QGLWidget {
   void SetTextureMappingMode(int);
   void SetSkybox(bool);
 
+  /**
+   * @brief SetOcclusionCulling Enables the software occlusion culling of the
+   * model clusters in both geometry passes.
+   */
+  void SetOcclusionCulling(bool);
+
+  /**
+   * @brief SetDeferredShading Rasterizes the model once into the G-buffer and
+   * runs the lighting programs as full screen passes over it.
+   */
+  void SetDeferredShading(bool);
+
   void SetSSAONormal(bool);
   void SetSSAOAlbedo(bool);
   void SetSSAODepth(bool);
@@ -202,6 +709,42 @@ class GLWidget : public QGLWidget {
   void SetSSAOSSAOBlur(bool);
   void SetSSAOSSAOBlurLightning(bool);
 
+  /**
+   * @brief SetScreenSpaceAO Uses the SSAO passes for ambient occlusion.
+   */
+  void SetScreenSpaceAO(bool);
+
+  /**
+   * @brief SetBakedAO Uses the baked per-vertex ambient occlusion and skips
+   * the SSAO passes.
+   */
+  void SetBakedAO(bool);
+
+  /**
+   * @brief SetDistanceFieldAO Traces the signed distance field of the model
+   * for ambient occlusion and soft shadows in the BRDF shader, skipping the
+   * SSAO passes.
+   */
+  void SetDistanceFieldAO(bool);
+
+  /**
+   * @brief SetIrradianceMapDiffuse Uses the irradiance map for the diffuse
+   * image based lighting.
+   */
+  void SetIrradianceMapDiffuse(bool);
+
+  /**
+   * @brief SetRadianceTransferDiffuse Uses the baked radiance transfer, which
+   * includes self shadowing, for the diffuse image based lighting.
+   */
+  void SetRadianceTransferDiffuse(bool);
+
+  /**
+   * @brief SetProbeVolumeDiffuse Uses the irradiance probe volume, which
+   * includes interreflections, for the diffuse image based lighting.
+   */
+  void SetProbeVolumeDiffuse(bool);
+
   void SetSSAONSamples(int);
   void SetSSAORadius(double);
   void SetSSAOSigma(double);
@@ -209,6 +752,41 @@ class GLWidget : public QGLWidget {
   void SetSSAOBeta(double);
   void SetSSAOEpsilon(double);
 
+  /**
+   * @brief SetSSAOResolution Runs the SSAO estimator at full (0), half (1) or
+   * quarter (2) resolution, upsampling its result.
+   */
+  void SetSSAOResolution(int);
+
+  /**
+   * @brief SetSSAOTemporal Accumulates the SSAO estimate over frames.
+   */
+  void SetSSAOTemporal(bool);
+
+  /**
+   * @brief SetSSAOBlurRadius Sets the taps on each side of the pixel in both
+   * passes of the SSAO blur, from 1 to kMaxBlurRadius.
+   */
+  void SetSSAOBlurRadius(int);
+
+  /**
+   * @brief SetSSAOCompute Runs the SSAO estimator and the horizontal blur in
+   * a compute shader when the context supports it.
+   */
+  void SetSSAOCompute(bool);
+
+  /**
+   * @brief SetContinuousRendering Renders frames back to back and reports the
+   * framerate, instead of only when something changes. Toggled with C.
+   */
+  void SetContinuousRendering(bool);
+
+  /**
+   * @brief SetProfiling Issues GPU queries every frame and reports their
+   * averages in the profiling labels. Toggled with P.
+   */
+  void SetProfiling(bool);
+
  signals:
   /**
    * @brief SetFaces Signal that updates the interface label "Faces".
@@ -224,6 +802,75 @@ class GLWidget : public QGLWidget {
    * @brief SetFaces Signal that updates the interface label "Framerate".
    */
   void SetFramerate(QString);
+
+  /**
+   * @brief SetCulledDraws Signal that updates the interface label "Culled"
+   * with the clusters culled in the last frame.
+   */
+  void SetCulledDraws(QString);
+
+  /**
+   * @brief SetStateCalls Signal that updates the interface label "GL calls"
+   * with the state calls issued and filtered in the last frame.
+   */
+  void SetStateCalls(QString);
+
+  /**
+   * @brief SetLatency Signal that updates the interface label "Latency" with
+   * the mean and maximum milliseconds from an input to its frame.
+   */
+  void SetLatency(QString);
+
+  /**
+   * @brief SetGBufferTime Signal that updates the interface label "G-buffer"
+   * with the GPU time of the first SSAO step, while profiling.
+   */
+  void SetGBufferTime(QString);
+
+  /**
+   * @brief SetShadedFragments Signal that updates the interface label
+   * "Shaded" with the fragments shaded by the forward lighting pass, while
+   * profiling.
+   */
+  void SetShadedFragments(QString);
+
+  /**
+   * @brief SetSsaoTime Signal that updates the interface label "SSAO" with
+   * the GPU times of the SSAO estimator and of the horizontal blur, while
+   * profiling.
+   */
+  void SetSsaoTime(QString);
+
+  /**
+   * @brief SetComputeAvailable Signal that enables the interface checkbox
+   * "Compute shader" when the context supports compute shaders.
+   */
+  void SetComputeAvailable(bool);
+
+  /**
+   * @brief Baked Signal emitted by bake_pool_ when a bake finishes.
+   */
+  void Baked();
+
+  /**
+   * @brief ModelLoaded Signal emitted once a model requested with LoadModel
+   * is uploaded, or could not be read.
+   */
+  void ModelLoaded(bool);
+
+  /**
+   * @brief MapLoaded Signal emitted once a cube map requested with a public
+   * loader is uploaded, or could not be read.
+   */
+  void MapLoaded(bool);
+
+  /**
+   * @brief DiffuseIrradianceMapComputed, SpecularIrradianceMapComputed Signals
+   * emitted once an irradiance map is written, or the skybox could not be
+   * read.
+   */
+  void DiffuseIrradianceMapComputed(bool);
+  void SpecularIrradianceMapComputed(bool);
 };
 
 #endif  //  GLWIDGET_H_
@@ -0,0 +1,294 @@
+#include <headless.h>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QImage>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "./camera.h"
+#include "./environment_map.h"
+#include "./mesh_io.h"
+#include "./parallel_for.h"
+#include "./path_tracer.h"
+#include "./rasterizer.h"
+#include "./ssao.h"
+#include "./triangle_mesh.h"
+
+namespace headless {
+
+namespace {
+
+const char *const kCommands[] = {"--reference", "--gbuffer"};
+
+const char kDefaultModel[] = "../../NewModels/PLY/dragon_vrip.ply";
+const char kDefaultEnvironment[] = "../../ViewerPBS/textures/desert_specular/";
+const char kDefaultAlbedo[] =
+    "../../ViewerPBS/textures/metal_spotty_discoloration/color.jpg";
+const char kDefaultNoise[] =
+    "../../ViewerPBS/textures/random_texture/noiseTexture.png";
+
+bool LoadMesh(const std::string &file,
+              data_representation::TriangleMesh *mesh) {
+  const std::string kType = file.substr(file.find_last_of('.') + 1);
+  if (kType == "ply") return data_representation::ReadFromPly(file, mesh);
+  if (kType == "obj") return data_representation::ReadFromObj(file, mesh);
+  return false;
+}
+
+bool ParseSize(const QString &text, int *width, int *height) {
+  const std::string kText = text.toStdString();
+  const size_t kSeparator = kText.find('x');
+  if (kSeparator == std::string::npos) return false;
+  *width = std::atoi(kText.substr(0, kSeparator).c_str());
+  *height = std::atoi(kText.substr(kSeparator + 1).c_str());
+  return *width > 0 && *height > 0;
+}
+
+bool SaveRgb(const std::string &filename, int width, int height,
+             const std::vector<unsigned char> &pixels) {
+  const QImage kImage(pixels.data(), width, height, width * 3,
+                      QImage::Format_RGB888);
+  return kImage.save(filename.c_str());
+}
+
+/**
+ * @brief SaveGBuffer Stores the normal target as the GL_RGB8 texture holds it
+ * (clamped to [0, 1]) and the depth target as grayscale, top row first.
+ */
+bool SaveGBuffer(const std::string &prefix,
+                 const data_visualization::GBuffer &gbuffer) {
+  const int kWidth = gbuffer.width, kHeight = gbuffer.height;
+  std::vector<unsigned char> normal(static_cast<size_t>(kWidth * kHeight * 3));
+  std::vector<unsigned char> depth(normal.size());
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      const size_t kSource = static_cast<size_t>(y * kWidth + x);
+      const size_t kTarget =
+          static_cast<size_t>((kHeight - 1 - y) * kWidth + x) * 3;
+      for (int c = 0; c < 3; ++c) {
+        const float kValue =
+            std::min(std::max(gbuffer.normal[kSource * 3 + c], 0.0f), 1.0f);
+        normal[kTarget + c] = static_cast<unsigned char>(kValue * 255.0f + 0.5f);
+        depth[kTarget + c] =
+            static_cast<unsigned char>(gbuffer.depth[kSource] * 255.0f + 0.5f);
+      }
+    }
+  }
+  return SaveRgb(prefix + "_normal.png", kWidth, kHeight, normal) &&
+         SaveRgb(prefix + "_depth.png", kWidth, kHeight, depth);
+}
+
+/**
+ * @brief SaveGray Stores a single channel image in [0, 1], top row first.
+ */
+bool SaveGray(const std::string &filename, int width, int height,
+              const std::vector<float> &values) {
+  std::vector<unsigned char> pixels(static_cast<size_t>(width * height * 3));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x)
+      for (int c = 0; c < 3; ++c)
+        pixels[static_cast<size_t>(((height - 1 - y) * width + x) * 3 + c)] =
+            static_cast<unsigned char>(
+                values[static_cast<size_t>(y * width + x)] * 255.0f + 0.5f);
+  return SaveRgb(filename, width, height, pixels);
+}
+
+}  // namespace
+
+bool Requested(int argc, char *argv[]) {
+  for (int i = 1; i < argc; ++i)
+    for (const char *command : kCommands)
+      if (std::strcmp(argv[i], command) == 0) return true;
+  return false;
+}
+
+int Run(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("ViewerPBS offline renderer.");
+  parser.addHelpOption();
+
+  QCommandLineOption reference(
+      "reference", "Path traces a reference image and saves it to <file>.",
+      "file");
+  QCommandLineOption gbuffer(
+      "gbuffer",
+      "Rasterizes the SSAO G-buffer and saves <prefix>_normal.png and "
+      "<prefix>_depth.png.",
+      "prefix");
+  QCommandLineOption repeat("repeat",
+                            "Times the G-buffer is rasterized for timing.", "n",
+                            "1");
+  QCommandLineOption ssao(
+      "ssao",
+      "With --gbuffer, also computes and saves <prefix>_ssao.png and "
+      "<prefix>_ssao_blur.png.");
+  QCommandLineOption noise("noise", "SSAO rotation texture.", "file",
+                           kDefaultNoise);
+  QCommandLineOption model("model", "Mesh to render.", "file", kDefaultModel);
+  QCommandLineOption environment(
+      "environment", "Directory with the six environment cube map faces.",
+      "directory", kDefaultEnvironment);
+  QCommandLineOption albedo("albedo", "Albedo texture.", "file",
+                            kDefaultAlbedo);
+  QCommandLineOption size("size", "Image size.", "WxH", "600x600");
+  QCommandLineOption spp("spp", "Samples per pixel.", "n", "64");
+  QCommandLineOption depth("depth", "Maximum number of bounces.", "n", "5");
+  QCommandLineOption metalness("metalness", "Material metalness.", "value",
+                               "1.0");
+  QCommandLineOption roughness("roughness", "Material roughness.", "value",
+                               "0.10");
+  QCommandLineOption yaw("yaw", "Camera rotation around the Y axis.",
+                         "radians", "0");
+  parser.addOption(reference);
+  parser.addOption(gbuffer);
+  parser.addOption(repeat);
+  parser.addOption(ssao);
+  parser.addOption(noise);
+  parser.addOption(model);
+  parser.addOption(environment);
+  parser.addOption(albedo);
+  parser.addOption(size);
+  parser.addOption(spp);
+  parser.addOption(depth);
+  parser.addOption(metalness);
+  parser.addOption(roughness);
+  parser.addOption(yaw);
+  parser.process(app);
+
+  std::unique_ptr<data_representation::TriangleMesh> mesh =
+      std::make_unique<data_representation::TriangleMesh>();
+  const std::string kModelFile = parser.value(model).toStdString();
+  if (!LoadMesh(kModelFile, mesh.get())) {
+    std::cerr << "Could not load " << kModelFile << std::endl;
+    return 1;
+  }
+
+  data_visualization::PathTracerSettings settings;
+  if (!ParseSize(parser.value(size), &settings.width, &settings.height)) {
+    std::cerr << "Invalid size, expected WxH" << std::endl;
+    return 1;
+  }
+  settings.samples_per_pixel = parser.value(spp).toInt();
+  settings.max_depth = parser.value(depth).toInt();
+
+  data_visualization::Camera camera;
+  camera.UpdateModel(mesh->min_, mesh->max_);
+  camera.SetViewportSize(settings.width, settings.height);
+  camera.Rotate(parser.value(yaw).toDouble() /
+                data_visualization::AngleIncrement);
+  const Eigen::Matrix4f kProjection =
+      camera.SetProjection(data_visualization::kFieldOfView,
+                           data_visualization::kZNear,
+                           data_visualization::kZFar);
+  const Eigen::Matrix4f kView = camera.SetView();
+  const Eigen::Matrix4f kModel = camera.SetModel();
+
+  if (parser.isSet(gbuffer)) {
+    const int kRepeat = std::max(1, parser.value(repeat).toInt());
+    data_visualization::Rasterizer rasterizer;
+    data_visualization::GBuffer target;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < kRepeat; ++i)
+      rasterizer.Render(*mesh, kProjection, kView, kModel, settings.width,
+                        settings.height, &target);
+    const double kAverage =
+        static_cast<double>(timer.nsecsElapsed()) / kRepeat / 1e6;
+
+    const std::string kPrefix = parser.value(gbuffer).toStdString();
+    if (!SaveGBuffer(kPrefix, target)) {
+      std::cerr << "Could not save " << kPrefix << "_*.png" << std::endl;
+      return 1;
+    }
+    std::cout << mesh->faces_.size() / 3 << " triangles, " << settings.width
+              << "x" << settings.height << " G-buffer rasterized in "
+              << kAverage << " ms on " << concurrency::WorkerCount()
+              << " threads" << std::endl;
+    if (!parser.isSet(ssao)) return 0;
+
+    data_visualization::Ssao estimator;
+    const std::string kNoiseFile = parser.value(noise).toStdString();
+    if (!estimator.LoadNoiseTexture(kNoiseFile))
+      std::cerr << "Could not load " << kNoiseFile << ", using no rotation"
+                << std::endl;
+    const data_visualization::SsaoSettings kSsaoSettings;
+    std::vector<float> occlusion, blurred;
+    timer.restart();
+    for (int i = 0; i < kRepeat; ++i)
+      estimator.Compute(target, kSsaoSettings, &occlusion);
+    const double kSsaoAverage =
+        static_cast<double>(timer.nsecsElapsed()) / kRepeat / 1e6;
+    timer.restart();
+    for (int i = 0; i < kRepeat; ++i)
+      estimator.Blur(target, kSsaoSettings, occlusion, &blurred);
+    const double kBlurAverage =
+        static_cast<double>(timer.nsecsElapsed()) / kRepeat / 1e6;
+
+    if (!SaveGray(kPrefix + "_ssao.png", target.width, target.height,
+                  occlusion) ||
+        !SaveGray(kPrefix + "_ssao_blur.png", target.width, target.height,
+                  blurred)) {
+      std::cerr << "Could not save " << kPrefix << "_ssao*.png" << std::endl;
+      return 1;
+    }
+    std::cout << "SSAO in " << kSsaoAverage << " ms, blur in " << kBlurAverage
+              << " ms" << std::endl;
+    return 0;
+  }
+
+  data_visualization::EnvironmentMap environment_map;
+  const std::string kEnvironmentDirectory =
+      parser.value(environment).toStdString();
+  if (!environment_map.Load(kEnvironmentDirectory))
+    std::cerr << "Could not load " << kEnvironmentDirectory
+              << ", rendering without environment" << std::endl;
+
+  data_visualization::PathTracer tracer;
+  tracer.SetEnvironment(&environment_map);
+  const std::string kAlbedoFile = parser.value(albedo).toStdString();
+  if (!tracer.LoadAlbedoTexture(kAlbedoFile))
+    std::cerr << "Could not load " << kAlbedoFile << ", using white albedo"
+              << std::endl;
+
+  data_visualization::PbrMaterial material;
+  material.metalness = parser.value(metalness).toFloat();
+  material.roughness = parser.value(roughness).toFloat();
+  tracer.SetMaterial(material);
+
+  QElapsedTimer timer;
+  timer.start();
+  tracer.SetMesh(*mesh, kModel);
+  const qint64 kBuildTime = timer.restart();
+
+  std::vector<float> radiance;
+  tracer.Render(kProjection, kView, settings, &radiance);
+  const qint64 kRenderTime = timer.elapsed();
+
+  std::vector<unsigned char> pixels;
+  data_visualization::PathTracer::ToneMap(radiance, &pixels);
+  const std::string kOutput = parser.value(reference).toStdString();
+  if (!SaveRgb(kOutput, settings.width, settings.height, pixels)) {
+    std::cerr << "Could not save " << kOutput << std::endl;
+    return 1;
+  }
+
+  std::cout << mesh->faces_.size() / 3 << " triangles, BVH built in "
+            << kBuildTime << " ms" << std::endl;
+  std::cout << settings.width << "x" << settings.height << " at "
+            << settings.samples_per_pixel << " spp rendered in " << kRenderTime
+            << " ms on " << concurrency::WorkerCount() << " threads"
+            << std::endl;
+  return 0;
+}
+
+}  // namespace headless
@@ -0,0 +1,26 @@
+#ifndef HEADLESS_H_
+#define HEADLESS_H_
+
+namespace headless {
+
+/**
+ * @brief Requested Whether the command line asks for an offline render
+ * instead of opening the viewer.
+ * @param argc Number of arguments.
+ * @param argv Arguments as passed to main.
+ * @return True if one of the headless commands (e.g. --reference) is present.
+ */
+bool Requested(int argc, char *argv[]);
+
+/**
+ * @brief Run Parses the command line and renders without creating any window
+ * or GL context.
+ * @param argc Number of arguments.
+ * @param argv Arguments as passed to main.
+ * @return The process exit code.
+ */
+int Run(int argc, char *argv[]);
+
+}  // namespace headless
+
+#endif  //  HEADLESS_H_
@@ -0,0 +1,164 @@
+#include <irradiance_volume.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "./parallel_for.h"
+#include "./spherical_harmonics.h"
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+namespace data_visualization {
+
+namespace {
+
+/**
+ * @brief FibonacciDirection Direction r of a spherical Fibonacci lattice of
+ * count points, which covers the sphere almost uniformly without random
+ * numbers, so the bake is deterministic.
+ */
+Eigen::Vector3f FibonacciDirection(int r, int count) {
+  const float kGoldenAngle = static_cast<float>(M_PI * (3.0 - std::sqrt(5.0)));
+  const float kZ = 1.0f - (2.0f * r + 1.0f) / count;
+  const float kRadius = std::sqrt(std::max(0.0f, 1.0f - kZ * kZ));
+  const float kPhi = kGoldenAngle * r;
+  return Eigen::Vector3f(kRadius * std::cos(kPhi), kRadius * std::sin(kPhi),
+                         kZ);
+}
+
+}  // namespace
+
+IrradianceVolume::IrradianceVolume()
+    : size_(Eigen::Vector3i::Zero()),
+      min_(Eigen::Vector3f::Zero()),
+      max_(Eigen::Vector3f::Zero()) {}
+
+Eigen::Vector3f IrradianceVolume::ProbePosition(int x, int y, int z) const {
+  const Eigen::Vector3f kT(
+      static_cast<float>(x) / (size_[0] - 1),
+      static_cast<float>(y) / (size_[1] - 1),
+      static_cast<float>(z) / (size_[2] - 1));
+  return min_ + (max_ - min_).cwiseProduct(kT);
+}
+
+void IrradianceVolume::Bake(const data_representation::TriangleMesh &mesh,
+                            const data_representation::Bvh &bvh,
+                            const EnvironmentMap &environment,
+                            const ProbeVolumeSettings &settings) {
+  const Eigen::Vector3f kExtent = mesh.max_ - mesh.min_;
+  const float kLongest = kExtent.maxCoeff();
+  const float kMargin = kLongest * settings.margin;
+  min_ = mesh.min_ - Eigen::Vector3f::Constant(kMargin);
+  max_ = mesh.max_ + Eigen::Vector3f::Constant(kMargin);
+
+  const float kSpacing =
+      (kLongest + 2.0f * kMargin) / std::max(1, settings.resolution - 1);
+  for (int axis = 0; axis < 3; ++axis)
+    size_[axis] = std::max(
+        2, static_cast<int>(std::ceil((max_[axis] - min_[axis]) / kSpacing)) +
+               1);
+
+  const int kProbes = size_.prod();
+  const float kEpsilon = kLongest * 1e-4f;
+  const float kWeight = static_cast<float>(4.0 * M_PI) / settings.rays;
+  const bool kHasNormals = mesh.normals_.size() == mesh.vertices_.size();
+
+  coefficients_.assign(static_cast<size_t>(kProbes * kProbeCoefficients),
+                       Eigen::Vector3f::Zero());
+  std::vector<Eigen::Vector3f> baked(coefficients_.size());
+  for (int bounce = 0; bounce < std::max(1, settings.bounces); ++bounce) {
+    concurrency::ParallelFor(kProbes, 4, [&](int probe) {
+      const int kX = probe % size_[0];
+      const int kY = (probe / size_[0]) % size_[1];
+      const int kZ = probe / (size_[0] * size_[1]);
+      const Eigen::Vector3f kOrigin = ProbePosition(kX, kY, kZ);
+
+      Eigen::Vector3f sum[kProbeCoefficients];
+      for (Eigen::Vector3f &coefficient : sum) coefficient.setZero();
+      for (int r = 0; r < settings.rays; ++r) {
+        const Eigen::Vector3f kDirection = FibonacciDirection(r, settings.rays);
+        data_representation::RayHit hit;
+        Eigen::Vector3f radiance = Eigen::Vector3f::Zero();
+        if (!bvh.Intersect({kOrigin, kDirection, kEpsilon,
+                            std::numeric_limits<float>::max()},
+                           &hit)) {
+          radiance = environment.Lookup(kDirection);
+        } else if (bounce > 0 && kHasNormals) {
+          // Lambertian surface lit by the previous pass; back faces are
+          // inside the geometry and stay black.
+          const int *kFace = &mesh.faces_[static_cast<size_t>(hit.triangle * 3)];
+          const float kW[3] = {1.0f - hit.u - hit.v, hit.u, hit.v};
+          Eigen::Vector3f normal = Eigen::Vector3f::Zero();
+          for (int i = 0; i < 3; ++i)
+            normal += Eigen::Vector3f(&mesh.normals_[kFace[i] * 3]) * kW[i];
+          if (normal.dot(kDirection) < 0.0f)
+            radiance = settings.albedo.cwiseProduct(
+                Irradiance(kOrigin + kDirection * hit.t, normal.normalized()));
+        }
+
+        float sh[data_representation::kShCoefficients];
+        data_representation::EvaluateSh(kDirection, sh);
+        for (int c = 0; c < kProbeCoefficients; ++c)
+          sum[c] += radiance * (sh[c] * kWeight);
+      }
+      for (int c = 0; c < kProbeCoefficients; ++c)
+        baked[static_cast<size_t>(probe * kProbeCoefficients + c)] = sum[c];
+    });
+    coefficients_.swap(baked);
+  }
+}
+
+Eigen::Vector3f IrradianceVolume::Irradiance(
+    const Eigen::Vector3f &position, const Eigen::Vector3f &normal) const {
+  if (Empty()) return Eigen::Vector3f::Zero();
+
+  // Texel centers are the probes, as sampled with GL_LINEAR and
+  // GL_CLAMP_TO_EDGE.
+  int base[3];
+  float fraction[3];
+  for (int axis = 0; axis < 3; ++axis) {
+    const float kCoordinate = std::min(
+        std::max((position[axis] - min_[axis]) / (max_[axis] - min_[axis]) *
+                     (size_[axis] - 1),
+                 0.0f),
+        static_cast<float>(size_[axis] - 1));
+    base[axis] = std::min(static_cast<int>(kCoordinate), size_[axis] - 2);
+    fraction[axis] = kCoordinate - base[axis];
+  }
+
+  Eigen::Vector3f coefficients[kProbeCoefficients];
+  for (Eigen::Vector3f &coefficient : coefficients) coefficient.setZero();
+  for (int corner = 0; corner < 8; ++corner) {
+    float weight = 1.0f;
+    int index = 0;
+    for (int axis = 2; axis >= 0; --axis) {
+      const int kOffset = (corner >> axis) & 1;
+      weight *= kOffset ? fraction[axis] : 1.0f - fraction[axis];
+      index = index * size_[axis] + base[axis] + kOffset;
+    }
+    for (int c = 0; c < kProbeCoefficients; ++c)
+      coefficients[c] +=
+          coefficients_[static_cast<size_t>(index * kProbeCoefficients + c)] *
+          weight;
+  }
+
+  // Convolution with the clamped cosine (pi, 2 pi / 3), divided by pi.
+  float sh[data_representation::kShCoefficients];
+  data_representation::EvaluateSh(normal, sh);
+  Eigen::Vector3f irradiance = coefficients[0] * sh[0];
+  for (int c = 1; c < kProbeCoefficients; ++c)
+    irradiance += coefficients[c] * (sh[c] * 2.0f / 3.0f);
+  return irradiance.cwiseMax(0.0f);
+}
+
+void IrradianceVolume::ChannelTexels(int channel,
+                                     std::vector<float> *texels) const {
+  texels->resize(coefficients_.size());
+  for (size_t i = 0; i < coefficients_.size(); ++i)
+    (*texels)[i] = coefficients_[i][channel];
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,117 @@
+#ifndef IRRADIANCE_VOLUME_H_
+#define IRRADIANCE_VOLUME_H_
+
+#include <Eigen/Geometry>
+
+#include <vector>
+
+#include "./bvh.h"
+#include "./environment_map.h"
+#include "./triangle_mesh.h"
+
+namespace data_visualization {
+
+/**
+ * @brief kProbeCoefficients Spherical harmonics stored per probe and color
+ * channel (bands 0 and 1), one RGBA texel of each channel texture.
+ */
+const int kProbeCoefficients = 4;
+
+/**
+ * @brief ProbeVolumeSettings Parameters of the probe bake.
+ */
+struct ProbeVolumeSettings {
+  /**
+   * @brief resolution Probes along the longest side of the volume. The other
+   * sides keep the same spacing, with at least two probes.
+   */
+  int resolution = 16;
+  int rays = 256;
+
+  /**
+   * @brief bounces Number of passes; every pass after the first one lights
+   * the hit surfaces with the probes of the previous pass.
+   */
+  int bounces = 2;
+
+  /**
+   * @brief margin Padding around the mesh bounding box, relative to its
+   * longest edge.
+   */
+  float margin = 0.1f;
+
+  /**
+   * @brief albedo Diffuse reflectance assumed for the bounced light.
+   */
+  Eigen::Vector3f albedo = Eigen::Vector3f::Constant(0.5f);
+};
+
+/**
+ * @brief IrradianceVolume Regular grid of irradiance probes over the bounds
+ * of a mesh, in its object space. Every probe stores the band 0 and 1
+ * spherical harmonics of the radiance arriving at it, environment and
+ * interreflections included, so that the irradiance at any point and normal
+ * is a trilinear interpolation followed by a dot product.
+ */
+class IrradianceVolume {
+ public:
+  /**
+   * @brief IrradianceVolume Constructor of the class. The volume is empty
+   * until baked.
+   */
+  IrradianceVolume();
+
+  /**
+   * @brief Bake Casts rays from every probe, distributing probes over all
+   * cores.
+   * @param mesh The scene geometry, with per-vertex normals.
+   * @param bvh Hierarchy built over mesh with the identity transform.
+   * @param environment Distant lighting of the rays that escape.
+   * @param settings The bake parameters.
+   */
+  void Bake(const data_representation::TriangleMesh &mesh,
+            const data_representation::Bvh &bvh,
+            const EnvironmentMap &environment,
+            const ProbeVolumeSettings &settings);
+
+  /**
+   * @brief Irradiance Trilinearly interpolated irradiance divided by pi, the
+   * quantity stored by the diffuse irradiance map, as brdf.frag computes it.
+   * @param position Point in object space.
+   * @param normal Unit normal in object space.
+   */
+  Eigen::Vector3f Irradiance(const Eigen::Vector3f &position,
+                             const Eigen::Vector3f &normal) const;
+
+  /**
+   * @brief ChannelTexels The texels of the 3D texture of one color channel,
+   * x varying fastest, with the kProbeCoefficients of each probe as RGBA.
+   * @param channel 0, 1 or 2 for red, green or blue.
+   * @param texels Output size().prod() * kProbeCoefficients floats.
+   */
+  void ChannelTexels(int channel, std::vector<float> *texels) const;
+
+  /**
+   * @brief Empty Whether the volume has not been baked.
+   */
+  bool Empty() const { return coefficients_.empty(); }
+
+  const Eigen::Vector3i &size() const { return size_; }
+  const Eigen::Vector3f &min() const { return min_; }
+  const Eigen::Vector3f &max() const { return max_; }
+
+ private:
+  Eigen::Vector3f ProbePosition(int x, int y, int z) const;
+
+  Eigen::Vector3i size_;
+  Eigen::Vector3f min_, max_;
+
+  /**
+   * @brief coefficients_ kProbeCoefficients RGB coefficients per probe.
+   */
+  std::vector<Eigen::Vector3f> coefficients_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  IRRADIANCE_VOLUME_H_
@@ -2,15 +2,46 @@
 
 #include <QApplication>
 #include <QGLFormat>
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+#include "./headless.h"
 #include "./main_window.h"
 
+namespace {
+
+/**
+ * @brief SupportsOpenGL43 Whether a core profile OpenGL 4.3 context, which
+ * the compute shaders of the SSAO need, can be created.
+ */
+bool SupportsOpenGL43() {
+  QSurfaceFormat format;
+  format.setVersion(4, 3);
+  format.setProfile(QSurfaceFormat::CoreProfile);
+  QOpenGLContext context;
+  context.setFormat(format);
+  // Some platforms create a lower version than requested instead of failing.
+  return context.create() && context.format().version() >= qMakePair(4, 3);
+}
+
+}  // namespace
+
 int main(int argc, char *argv[]) {
+  if (headless::Requested(argc, argv)) return headless::Run(argc, argv);
+
+  QApplication a(argc, argv);
+
+  // OpenGL 4.3 when available, for the compute path of the SSAO, and 3.3
+  // otherwise.
   QGLFormat fmt;
-  fmt.setVersion(3, 3);
+  if (SupportsOpenGL43())
+    fmt.setVersion(4, 3);
+  else
+    fmt.setVersion(3, 3);
   fmt.setProfile(QGLFormat::CoreProfile);
+  // The render thread is paced by the display refresh.
+  fmt.setSwapInterval(1);
   QGLFormat::setDefaultFormat(fmt);
 
-  QApplication a(argc, argv);
   gui::MainWindow w;
   w.show();
 
@@ -14,6 +14,9 @@ MainWindow::MainWindow(QWidget *parent)
   ui->texture_mapping_type->addItem("Color");
   ui->texture_mapping_type->addItem("Metalness");
   ui->texture_mapping_type->addItem("Roughness");
+  ui->ssao_resolution->addItem("Full");
+  ui->ssao_resolution->addItem("Half");
+  ui->ssao_resolution->addItem("Quarter");
 }
 
 MainWindow::~MainWindow() { delete ui; }
@@ -27,53 +30,57 @@ void MainWindow::on_actionLoad_Model_triggered() {
 
   filename = QFileDialog::getOpenFileName(this, tr("Load model"), "./",
                                           tr("PLY Files ( *.ply )"));
-  if (!filename.isNull()) {
-    if (!ui->glwidget->LoadModel(filename))
-      QMessageBox::warning(this, tr("Error"),
-                           tr("The file could not be opened"));
-  }
+  if (!filename.isNull()) ui->glwidget->LoadModel(filename);
+}
+
+void MainWindow::on_glwidget_ModelLoaded(bool loaded) {
+  if (!loaded)
+    QMessageBox::warning(this, tr("Error"), tr("The file could not be opened"));
+}
+
+void MainWindow::on_glwidget_MapLoaded(bool loaded) {
+  if (!loaded)
+    QMessageBox::warning(this, tr("Error"), tr("The file could not be opened"));
 }
 
 void MainWindow::on_actionLoad_Skybox_triggered() {
   QString dir =
       QFileDialog::getExistingDirectory(this, "Skybox CubeMap folder.", "./");
-  if (!dir.isEmpty()) {
-    if (!ui->glwidget->LoadSkyboxMap(dir))
-      QMessageBox::warning(this, tr("Error"),
-                           tr("The file could not be opened"));
-  }
+  if (!dir.isEmpty()) ui->glwidget->LoadSkyboxMap(dir);
 }
 
 void MainWindow::on_actionLoad_Specular_triggered() {
   QString dir =
       QFileDialog::getExistingDirectory(this, "Specular CubeMap folder.", "./");
-  if (!dir.isEmpty()) {
-    if (!ui->glwidget->LoadSpecularMap(dir))
-      QMessageBox::warning(this, tr("Error"),
-                           tr("The file could not be opened"));
-  }
+  if (!dir.isEmpty()) ui->glwidget->LoadSpecularMap(dir);
 }
 
 void MainWindow::on_actionLoad_Diffuse_triggered() {
   QString dir =
       QFileDialog::getExistingDirectory(this, "Diffuse CubeMap folder.", "./");
-  if (!dir.isEmpty()) {
-    if (!ui->glwidget->LoadDiffuseMap(dir))
-      QMessageBox::warning(this, tr("Error"),
-                           tr("The file could not be opened"));
-  }
+  if (!dir.isEmpty()) ui->glwidget->LoadDiffuseMap(dir);
 }
 
 void MainWindow::on_actionCompute_Diffuse_Irrandiance_Map_triggered() {
-    if (!ui->glwidget->ComputeDiffuseIrradianceMap())
-      QMessageBox::warning(this, tr("Error"),
-                           tr("The Diffuse Irrandiance map could not be computed"));
+  ui->glwidget->ComputeDiffuseIrradianceMap();
 }
 
 void MainWindow::on_actionCompute_Specular_Irrandiance_Map_triggered() {
-    if (!ui->glwidget->ComputeSpecularIrradianceMap())
-      QMessageBox::warning(this, tr("Error"),
-                           tr("The Specular Irrandiance map could not be computed"));
+  ui->glwidget->ComputeSpecularIrradianceMap();
+}
+
+void MainWindow::on_glwidget_DiffuseIrradianceMapComputed(bool computed) {
+  if (!computed)
+    QMessageBox::warning(
+        this, tr("Error"),
+        tr("The Diffuse Irrandiance map could not be computed"));
+}
+
+void MainWindow::on_glwidget_SpecularIrradianceMapComputed(bool computed) {
+  if (!computed)
+    QMessageBox::warning(
+        this, tr("Error"),
+        tr("The Specular Irrandiance map could not be computed"));
 }
 
 }  //  namespace gui
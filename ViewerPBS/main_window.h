@@ -31,11 +31,31 @@ class MainWindow : public QMainWindow {
    */
   void on_actionLoad_Model_triggered();
 
+  /**
+   * @brief on_glwidget_ModelLoaded Warns when the model requested from the
+   * file dialog could not be opened, once the widget has tried.
+   */
+  void on_glwidget_ModelLoaded(bool loaded);
+
+  /**
+   * @brief on_glwidget_MapLoaded Warns when a cube map requested from a
+   * folder dialog could not be opened, once the widget has tried.
+   */
+  void on_glwidget_MapLoaded(bool loaded);
+
   void on_actionLoad_Skybox_triggered();
 
   void on_actionCompute_Diffuse_Irrandiance_Map_triggered();
   void on_actionCompute_Specular_Irrandiance_Map_triggered();
 
+  /**
+   * @brief on_glwidget_DiffuseIrradianceMapComputed,
+   * on_glwidget_SpecularIrradianceMapComputed Warn when an irradiance map
+   * requested from the menu could not be computed.
+   */
+  void on_glwidget_DiffuseIrradianceMapComputed(bool computed);
+  void on_glwidget_SpecularIrradianceMapComputed(bool computed);
+
   /**
    * @brief on_actionLoad_Specular_triggered Opens a file dialog to load a cube
    * map that will be used for the specular component.
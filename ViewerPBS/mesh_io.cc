@@ -217,8 +217,12 @@ bool ReadFromPly(const std::string &filename, TriangleMesh *mesh) {
 
       fin.close();
 
-      if(!hasNormals) ComputeVertexNormals(mesh->vertices_, mesh->faces_, &mesh->normals_);
-      ComputeTextureCoordinates(mesh->vertices_, &mesh->textures_);
+      // Point clouds (no faces) keep their normals, if any, and get no
+      // texture coordinates.
+      if (faces > 0) {
+        if(!hasNormals) ComputeVertexNormals(mesh->vertices_, mesh->faces_, &mesh->normals_);
+        ComputeTextureCoordinates(mesh->vertices_, &mesh->textures_);
+      }
       ComputeBoundingBox(mesh->vertices_, mesh);
 
       return true;
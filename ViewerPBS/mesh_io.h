@@ -16,6 +16,8 @@ static bool hasNormals = false;
  * and stores the corresponding TriangleMesh representation
  * @param filename The path to the PLY mesh.
  * @param mesh The resulting representation with computed per-vertex normals.
+ * Files without faces are read as point clouds: only the positions and the
+ * stored normals, if any.
  * @return Whether it was able to read the file.
  */
 bool ReadFromPly(const std::string &filename, TriangleMesh *mesh);
@@ -0,0 +1,258 @@
+#include <occlusion_culler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#include "./parallel_for.h"
+#include "./simd.h"
+
+namespace data_visualization {
+
+namespace {
+
+// Clip space w below which a corner is considered behind the eye.
+const float kMinimumW = 1e-5f;
+
+/**
+ * @brief SpreadBits Inserts two zero bits after each of the 10 low bits.
+ */
+uint32_t SpreadBits(uint32_t v) {
+  v &= 0x3ff;
+  v = (v | (v << 16)) & 0x030000ff;
+  v = (v | (v << 8)) & 0x0300f00f;
+  v = (v | (v << 4)) & 0x030c30c3;
+  v = (v | (v << 2)) & 0x09249249;
+  return v;
+}
+
+}  // namespace
+
+OcclusionCuller::OcclusionCuller() : culled_(0) {}
+
+void OcclusionCuller::Build(const data_representation::TriangleMesh &mesh) {
+  const int kFaces = static_cast<int>(mesh.faces_.size() / 3);
+  const Eigen::Vector3f kScale =
+      (mesh.max_ - mesh.min_).cwiseMax(1e-20f).cwiseInverse() * 1023.0f;
+
+  std::vector<std::pair<uint32_t, int>> keys(static_cast<size_t>(kFaces));
+  concurrency::ParallelFor(kFaces, 4096, [&](int f) {
+    Eigen::Vector3f centroid = Eigen::Vector3f::Zero();
+    for (int j = 0; j < 3; ++j)
+      centroid += Eigen::Vector3f(&mesh.vertices_[mesh.faces_[f * 3 + j] * 3]);
+    const Eigen::Vector3f kCell =
+        ((centroid / 3.0f - mesh.min_).cwiseProduct(kScale))
+            .cwiseMax(0.0f)
+            .cwiseMin(1023.0f);
+    keys[f] = {SpreadBits(static_cast<uint32_t>(kCell[0])) |
+                   SpreadBits(static_cast<uint32_t>(kCell[1])) << 1 |
+                   SpreadBits(static_cast<uint32_t>(kCell[2])) << 2,
+               f};
+  });
+  std::sort(keys.begin(), keys.end());
+
+  indices_.resize(mesh.faces_.size());
+  for (int f = 0; f < kFaces; ++f)
+    for (int j = 0; j < 3; ++j)
+      indices_[f * 3 + j] =
+          static_cast<unsigned int>(mesh.faces_[keys[f].second * 3 + j]);
+
+  const int kClusters = (kFaces + kClusterFaces - 1) / kClusterFaces;
+  const int kPadded =
+      (kClusters + simd::kWidth - 1) / simd::kWidth * simd::kWidth;
+  first_face_.resize(static_cast<size_t>(kClusters));
+  for (std::vector<float> &bound : bounds_)
+    bound.assign(static_cast<size_t>(kPadded), 0.0f);
+  for (int c = 0; c < kPadded; ++c) {
+    // Padding lanes repeat the last cluster; their result is ignored.
+    const int kCluster = std::min(c, kClusters - 1);
+    const int kFirst = kCluster * kClusterFaces;
+    const int kEnd = std::min(kFirst + kClusterFaces, kFaces);
+    if (c < kClusters) first_face_[c] = kFirst;
+
+    Eigen::Vector3f min =
+        Eigen::Vector3f::Constant(std::numeric_limits<float>::max());
+    Eigen::Vector3f max = -min;
+    for (size_t i = kFirst * 3; i < static_cast<size_t>(kEnd * 3); ++i) {
+      const Eigen::Vector3f kVertex(&mesh.vertices_[indices_[i] * 3]);
+      min = min.cwiseMin(kVertex);
+      max = max.cwiseMax(kVertex);
+    }
+    for (int j = 0; j < 3; ++j) {
+      bounds_[j][c] = min[j];
+      bounds_[3 + j][c] = max[j];
+    }
+  }
+
+  visible_.assign(static_cast<size_t>(kClusters), 1);
+  draws_.assign(1, {0, static_cast<int>(indices_.size())});
+  culled_ = 0;
+}
+
+void OcclusionCuller::BuildHierarchy() {
+  const int kWidth = gbuffer_.width, kHeight = gbuffer_.height;
+  levels_.resize(1);
+  level_width_.assign(1, kWidth);
+  level_height_.assign(1, kHeight);
+
+  // Level 0: 3x3 maximum, since a pixel center covered by an occluder does
+  // not mean that the whole pixel is.
+  levels_[0].resize(static_cast<size_t>(kWidth * kHeight));
+  concurrency::ParallelFor(kHeight, 8, [&](int y) {
+    for (int x = 0; x < kWidth; ++x) {
+      float depth = 0.0f;
+      for (int v = std::max(y - 1, 0); v <= std::min(y + 1, kHeight - 1); ++v)
+        for (int u = std::max(x - 1, 0); u <= std::min(x + 1, kWidth - 1);
+             ++u)
+          depth = std::max(depth, gbuffer_.depth[v * kWidth + u]);
+      levels_[0][y * kWidth + x] = depth;
+    }
+  });
+
+  while (level_width_.back() > 1 || level_height_.back() > 1) {
+    const int kSourceWidth = level_width_.back();
+    const int kSourceHeight = level_height_.back();
+    const int kLevelWidth = (kSourceWidth + 1) / 2;
+    const int kLevelHeight = (kSourceHeight + 1) / 2;
+    std::vector<float> level(static_cast<size_t>(kLevelWidth * kLevelHeight));
+    const std::vector<float> &kSource = levels_.back();
+    for (int y = 0; y < kLevelHeight; ++y) {
+      const int kY0 = 2 * y, kY1 = std::min(2 * y + 1, kSourceHeight - 1);
+      for (int x = 0; x < kLevelWidth; ++x) {
+        const int kX0 = 2 * x, kX1 = std::min(2 * x + 1, kSourceWidth - 1);
+        level[y * kLevelWidth + x] =
+            std::max(std::max(kSource[kY0 * kSourceWidth + kX0],
+                              kSource[kY0 * kSourceWidth + kX1]),
+                     std::max(kSource[kY1 * kSourceWidth + kX0],
+                              kSource[kY1 * kSourceWidth + kX1]));
+      }
+    }
+    levels_.push_back(std::move(level));
+    level_width_.push_back(kLevelWidth);
+    level_height_.push_back(kLevelHeight);
+  }
+}
+
+bool OcclusionCuller::Occluded(float min_x, float min_y, float max_x,
+                               float max_y, float min_z) const {
+  const int kWidth = level_width_[0], kHeight = level_height_[0];
+  const int kX0 = std::max(static_cast<int>(std::floor(min_x)), 0);
+  const int kY0 = std::max(static_cast<int>(std::floor(min_y)), 0);
+  const int kX1 = std::min(static_cast<int>(std::floor(max_x)), kWidth - 1);
+  const int kY1 = std::min(static_cast<int>(std::floor(max_y)), kHeight - 1);
+  if (kX0 > kX1 || kY0 > kY1) return false;
+
+  // Coarsest level where the rectangle spans at most 2x2 texels.
+  size_t level = 0;
+  while (level + 1 < levels_.size() &&
+         ((kX1 >> level) - (kX0 >> level) > 1 ||
+          (kY1 >> level) - (kY0 >> level) > 1))
+    ++level;
+
+  const std::vector<float> &kDepth = levels_[level];
+  const int kLevelWidth = level_width_[level];
+  for (int y = kY0 >> level; y <= kY1 >> level; ++y)
+    for (int x = kX0 >> level; x <= kX1 >> level; ++x)
+      if (kDepth[y * kLevelWidth + x] >= min_z) return false;
+  return true;
+}
+
+void OcclusionCuller::Cull(const data_representation::TriangleMesh &mesh,
+                           const Eigen::Matrix4f &projection,
+                           const Eigen::Matrix4f &view,
+                           const Eigen::Matrix4f &model, int width,
+                           int height) {
+  if (first_face_.empty()) return;
+
+  const int kHeight =
+      std::max(1, kOcclusionWidth * height / std::max(1, width));
+  rasterizer_.Render(mesh, projection, view, model, kOcclusionWidth, kHeight,
+                     &gbuffer_);
+  BuildHierarchy();
+
+  const Eigen::Matrix4f kTransform = projection * view * model;
+  simd::Float m[4][4];
+  for (int i = 0; i < 4; ++i)
+    for (int j = 0; j < 4; ++j) m[i][j] = simd::Float(kTransform(i, j));
+
+  const int kClusters = clusters();
+  const int kGroups = (kClusters + simd::kWidth - 1) / simd::kWidth;
+  concurrency::ParallelFor(kGroups, 16, [&](int group) {
+    const int kBase = group * simd::kWidth;
+    simd::Float bound[6];
+    for (int j = 0; j < 6; ++j) bound[j] = simd::Load(&bounds_[j][kBase]);
+
+    const simd::Float kMinimumW4(kMinimumW);
+    simd::Float min_x(std::numeric_limits<float>::max()), min_y = min_x,
+        min_z = min_x;
+    simd::Float max_x(std::numeric_limits<float>::lowest()), max_y = max_x;
+    simd::Mask behind = kMinimumW4 < kMinimumW4;
+    for (int corner = 0; corner < 8; ++corner) {
+      const simd::Float kX = bound[(corner & 1) ? 3 : 0];
+      const simd::Float kY = bound[(corner & 2) ? 4 : 1];
+      const simd::Float kZ = bound[(corner & 4) ? 5 : 2];
+      simd::Float clip[4];
+      for (int i = 0; i < 4; ++i)
+        clip[i] = m[i][0] * kX + m[i][1] * kY + m[i][2] * kZ + m[i][3];
+      behind = behind | (clip[3] < kMinimumW4);
+      const simd::Float kInverseW =
+          simd::Float(1.0f) / simd::Max(clip[3], kMinimumW4);
+      const simd::Float kNdcX = clip[0] * kInverseW;
+      const simd::Float kNdcY = clip[1] * kInverseW;
+      min_x = simd::Min(min_x, kNdcX);
+      max_x = simd::Max(max_x, kNdcX);
+      min_y = simd::Min(min_y, kNdcY);
+      max_y = simd::Max(max_y, kNdcY);
+      min_z = simd::Min(min_z, clip[2] * kInverseW);
+    }
+
+    float lanes[5][simd::kWidth];
+    simd::Store(lanes[0], min_x);
+    simd::Store(lanes[1], min_y);
+    simd::Store(lanes[2], max_x);
+    simd::Store(lanes[3], max_y);
+    simd::Store(lanes[4], min_z);
+    const int kBehind = simd::MoveMask(behind);
+    for (int lane = 0; lane < simd::kWidth && kBase + lane < kClusters;
+         ++lane) {
+      bool visible = true;
+      if (!((kBehind >> lane) & 1)) {
+        if (lanes[2][lane] < -1.0f || lanes[0][lane] > 1.0f ||
+            lanes[3][lane] < -1.0f || lanes[1][lane] > 1.0f ||
+            lanes[4][lane] > 1.0f) {
+          visible = false;
+        } else {
+          const float kScaleX = 0.5f * level_width_[0];
+          const float kScaleY = 0.5f * level_height_[0];
+          visible = !Occluded((lanes[0][lane] + 1.0f) * kScaleX,
+                              (lanes[1][lane] + 1.0f) * kScaleY,
+                              (lanes[2][lane] + 1.0f) * kScaleX,
+                              (lanes[3][lane] + 1.0f) * kScaleY,
+                              lanes[4][lane] * 0.5f + 0.5f);
+        }
+      }
+      visible_[kBase + lane] = visible ? 1 : 0;
+    }
+  });
+
+  const int kIndices = static_cast<int>(indices_.size());
+  draws_.clear();
+  culled_ = 0;
+  for (int c = 0; c < kClusters; ++c) {
+    if (!visible_[c]) {
+      ++culled_;
+      continue;
+    }
+    const int kFirst = first_face_[c] * 3;
+    const int kEnd = std::min(kFirst + kClusterFaces * 3, kIndices);
+    if (!draws_.empty() &&
+        draws_.back().first + draws_.back().count == kFirst)
+      draws_.back().count += kEnd - kFirst;
+    else
+      draws_.push_back({kFirst, kEnd - kFirst});
+  }
+}
+
+}  // namespace data_visualization
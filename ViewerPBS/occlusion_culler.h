@@ -0,0 +1,135 @@
+#ifndef OCCLUSION_CULLER_H_
+#define OCCLUSION_CULLER_H_
+
+#include <Eigen/Geometry>
+
+#include <vector>
+
+#include "./rasterizer.h"
+#include "./triangle_mesh.h"
+
+namespace data_visualization {
+
+/**
+ * @brief kClusterFaces Faces per cluster, the unit of culling and drawing.
+ */
+const int kClusterFaces = 256;
+
+/**
+ * @brief kOcclusionWidth Width of the software depth buffer. Its height
+ * follows the aspect ratio of the viewport.
+ */
+const int kOcclusionWidth = 256;
+
+/**
+ * @brief DrawRange A run of consecutive visible clusters, as the first index
+ * and the number of indices of a glDrawElements call.
+ */
+struct DrawRange {
+  int first;
+  int count;
+};
+
+/**
+ * @brief OcclusionCuller Splits a mesh into spatially coherent clusters of
+ * faces and culls them every frame against a low resolution depth buffer of
+ * the mesh rendered by the software Rasterizer. The depth buffer is turned
+ * into a max depth hierarchy, and the bounding box of every cluster, projected
+ * simd::kWidth clusters at a time, is compared against the few texels of the
+ * level that covers it. Clusters outside the view frustum are culled as well.
+ */
+class OcclusionCuller {
+ public:
+  /**
+   * @brief OcclusionCuller Constructor of the class.
+   */
+  OcclusionCuller();
+
+  /**
+   * @brief Build Sorts the faces of the mesh along a Morton curve of their
+   * centroids and groups them in clusters of kClusterFaces.
+   * @param mesh The triangle mesh.
+   */
+  void Build(const data_representation::TriangleMesh &mesh);
+
+  /**
+   * @brief Cull Renders the depth buffer and tests every cluster.
+   * @param mesh The mesh given to Build, with per-vertex normals.
+   * @param projection Projection matrix.
+   * @param view Viewing matrix.
+   * @param model Modeling matrix.
+   * @param width Viewport width.
+   * @param height Viewport height.
+   */
+  void Cull(const data_representation::TriangleMesh &mesh,
+            const Eigen::Matrix4f &projection, const Eigen::Matrix4f &view,
+            const Eigen::Matrix4f &model, int width, int height);
+
+  /**
+   * @brief indices The faces of the mesh in cluster order, to be uploaded as
+   * the element buffer that the draw ranges refer to.
+   */
+  const std::vector<unsigned int> &indices() const { return indices_; }
+
+  /**
+   * @brief draws The visible clusters after the last Cull, merged into as
+   * few ranges as possible. Before any Cull, the whole mesh.
+   */
+  const std::vector<DrawRange> &draws() const { return draws_; }
+
+  /**
+   * @brief clusters Number of clusters.
+   */
+  int clusters() const { return static_cast<int>(first_face_.size()); }
+
+  /**
+   * @brief culled Number of clusters culled by the last Cull.
+   */
+  int culled() const { return culled_; }
+
+ private:
+  /**
+   * @brief BuildHierarchy Fills levels_ from the rendered depth buffer.
+   */
+  void BuildHierarchy();
+
+  /**
+   * @brief Occluded Whether a window space rectangle at a minimum depth is
+   * behind the depth hierarchy.
+   */
+  bool Occluded(float min_x, float min_y, float max_x, float max_y,
+                float min_z) const;
+
+  std::vector<unsigned int> indices_;
+
+  /**
+   * @brief first_face_ First face of every cluster; the last cluster may be
+   * shorter than kClusterFaces.
+   */
+  std::vector<int> first_face_;
+
+  /**
+   * @brief bounds_ Cluster bounding boxes in object space, as structure of
+   * arrays (min x, y, z, max x, y, z) padded to a multiple of simd::kWidth.
+   */
+  std::vector<float> bounds_[6];
+
+  Rasterizer rasterizer_;
+  GBuffer gbuffer_;
+
+  /**
+   * @brief levels_, level_width_, level_height_ Max depth hierarchy, rows
+   * bottom to top. Level 0 is the depth buffer dilated by one pixel, so that
+   * silhouettes sampled at pixel centers stay conservative.
+   */
+  std::vector<std::vector<float>> levels_;
+  std::vector<int> level_width_, level_height_;
+
+  std::vector<unsigned char> visible_;
+  std::vector<DrawRange> draws_;
+  int culled_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  OCCLUSION_CULLER_H_
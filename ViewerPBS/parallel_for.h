@@ -0,0 +1,63 @@
+#ifndef PARALLEL_FOR_H_
+#define PARALLEL_FOR_H_
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace concurrency {
+
+/**
+ * @brief WorkerCount Number of threads used by ParallelFor, one per core.
+ * @return The number of hardware threads, at least one.
+ */
+inline int WorkerCount() {
+  const unsigned int kCores = std::thread::hardware_concurrency();
+  return kCores == 0 ? 1 : static_cast<int>(kCores);
+}
+
+/**
+ * @brief ParallelFor Calls task(i) for every i in [0, count) on all cores and
+ * blocks until every call has returned. Work is handed out dynamically in
+ * chunks of grain iterations so that uneven items (image tiles, vertices
+ * with deep BVH traversals) balance themselves. The calling thread takes
+ * part in the work.
+ * @param count Number of iterations.
+ * @param grain Number of consecutive iterations claimed at once.
+ * @param task Callable invoked as task(int).
+ */
+template <typename Task>
+void ParallelFor(int count, int grain, const Task &task) {
+  if (count <= 0) return;
+  grain = std::max(grain, 1);
+
+  const int kChunks = (count + grain - 1) / grain;
+  const int kWorkers = std::min(WorkerCount(), kChunks);
+
+  std::atomic<int> next_chunk(0);
+  auto worker = [&]() {
+    for (int chunk = next_chunk++; chunk < kChunks; chunk = next_chunk++) {
+      const int kEnd = std::min(count, (chunk + 1) * grain);
+      for (int i = chunk * grain; i < kEnd; ++i) task(i);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(static_cast<size_t>(kWorkers - 1));
+  for (int i = 1; i < kWorkers; ++i) threads.emplace_back(worker);
+  worker();
+  for (std::thread &thread : threads) thread.join();
+}
+
+/**
+ * @brief ParallelFor Same as above with one iteration per claim.
+ */
+template <typename Task>
+void ParallelFor(int count, const Task &task) {
+  ParallelFor(count, 1, task);
+}
+
+}  // namespace concurrency
+
+#endif  //  PARALLEL_FOR_H_
@@ -0,0 +1,446 @@
+#include <path_tracer.h>
+
+#include <QImage>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "./parallel_for.h"
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+namespace data_visualization {
+
+namespace {
+
+const float kPi = static_cast<float>(M_PI);
+const float kMinRoughness = 0.02f;
+const int kRussianRouletteDepth = 3;
+
+// The following functions mirror the ones in brdf.frag.
+float DistributionGGX(float n_dot_h, float roughness) {
+  const float kA = roughness * roughness;
+  const float kA2 = kA * kA;
+  const float kDenominator = n_dot_h * n_dot_h * (kA2 - 1.0f) + 1.0f;
+  return kA2 / (kPi * kDenominator * kDenominator);
+}
+
+float GeometrySchlickGGX(float n_dot_v, float roughness) {
+  const float kR = roughness + 1.0f;
+  const float kK = kR * kR / 8.0f;
+  return n_dot_v / (n_dot_v * (1.0f - kK) + kK);
+}
+
+float GeometrySmith(float n_dot_v, float n_dot_l, float roughness) {
+  return GeometrySchlickGGX(n_dot_v, roughness) *
+         GeometrySchlickGGX(n_dot_l, roughness);
+}
+
+// Schlick approximation, as fresnelSchlick in brdf.frag with
+// cos_theta = dot(L, H).
+Eigen::Vector3f FresnelSchlick(const Eigen::Vector3f &f0, float cos_theta) {
+  const float kFactor = std::pow(std::max(1.0f - cos_theta, 0.0f), 5.0f);
+  return f0 + (Eigen::Vector3f::Ones() - f0) * kFactor;
+}
+
+void OrthonormalBasis(const Eigen::Vector3f &n, Eigen::Vector3f *t,
+                      Eigen::Vector3f *b) {
+  const float kSign = std::copysign(1.0f, n[2]);
+  const float kA = -1.0f / (kSign + n[2]);
+  const float kB = n[0] * n[1] * kA;
+  *t = Eigen::Vector3f(1.0f + kSign * n[0] * n[0] * kA, kSign * kB,
+                       -kSign * n[0]);
+  *b = Eigen::Vector3f(kB, kSign + n[1] * n[1] * kA, -n[1]);
+}
+
+float PowerHeuristic(float pdf_a, float pdf_b) {
+  const float kA2 = pdf_a * pdf_a;
+  const float kB2 = pdf_b * pdf_b;
+  return kA2 + kB2 > 0.0f ? kA2 / (kA2 + kB2) : 0.0f;
+}
+
+float MaxComponent(const Eigen::Vector3f &v) {
+  return std::max(v[0], std::max(v[1], v[2]));
+}
+
+}  // namespace
+
+class PathTracer::Random {
+ public:
+  explicit Random(uint64_t seed)
+      : state_(0), increment_((seed << 1u) | 1u) {
+    Next();
+    state_ += 0x853c49e6748fea9bULL;
+    Next();
+  }
+
+  /**
+   * @brief Uniform Uniform float in [0, 1).
+   */
+  float Uniform() {
+    return std::min((Next() >> 8) * (1.0f / 16777216.0f), 0.99999994f);
+  }
+
+ private:
+  // PCG32 (O'Neill 2014).
+  uint32_t Next() {
+    const uint64_t kOld = state_;
+    state_ = kOld * 6364136223846793005ULL + increment_;
+    const uint32_t kShifted =
+        static_cast<uint32_t>(((kOld >> 18u) ^ kOld) >> 27u);
+    const uint32_t kRotation = static_cast<uint32_t>(kOld >> 59u);
+    return (kShifted >> kRotation) | (kShifted << ((32 - kRotation) & 31));
+  }
+
+  uint64_t state_;
+  uint64_t increment_;
+};
+
+struct PathTracer::SurfacePoint {
+  Eigen::Vector3f position;
+  Eigen::Vector3f geometric_normal;
+  Eigen::Vector3f shading_normal;
+  Eigen::Vector3f albedo;
+};
+
+namespace {
+
+/**
+ * @brief Lobes Evaluation and sampling of the brdf.frag model at one shading
+ * point, in world space.
+ */
+struct Lobes {
+  Eigen::Vector3f n, t, b;
+  Eigen::Vector3f albedo;
+  const PbrMaterial *material;
+  float roughness;
+  float specular_probability;
+
+  Eigen::Vector3f Evaluate(const Eigen::Vector3f &wo,
+                           const Eigen::Vector3f &wi) const {
+    const float kNdotV = std::max(n.dot(wo), 0.0f);
+    const float kNdotL = std::max(n.dot(wi), 0.0f);
+    if (kNdotL <= 0.0f || kNdotV <= 0.0f) return Eigen::Vector3f::Zero();
+
+    const Eigen::Vector3f kH = (wo + wi).normalized();
+    const Eigen::Vector3f kF =
+        FresnelSchlick(material->fresnel, std::max(kH.dot(wi), 0.0f));
+    const float kD = DistributionGGX(std::max(n.dot(kH), 0.0f), roughness);
+    const float kG = GeometrySmith(kNdotV, kNdotL, roughness);
+    const Eigen::Vector3f kSpecular =
+        kD * kG * kF / (4.0f * kNdotV * kNdotL + 0.0001f);
+    const Eigen::Vector3f kKd =
+        (Eigen::Vector3f::Ones() - kF) * (1.0f - material->metalness);
+    return kKd.cwiseProduct(albedo) / kPi + kSpecular;
+  }
+
+  float Pdf(const Eigen::Vector3f &wo, const Eigen::Vector3f &wi) const {
+    const float kNdotL = n.dot(wi);
+    if (kNdotL <= 0.0f) return 0.0f;
+    const Eigen::Vector3f kH = (wo + wi).normalized();
+    const float kVdotH = std::max(wo.dot(kH), 1e-6f);
+    const float kSpecularPdf =
+        DistributionGGX(std::max(n.dot(kH), 0.0f), roughness) *
+        std::max(n.dot(kH), 0.0f) / (4.0f * kVdotH);
+    const float kDiffusePdf = kNdotL / kPi;
+    return specular_probability * kSpecularPdf +
+           (1.0f - specular_probability) * kDiffusePdf;
+  }
+
+  bool Sample(const Eigen::Vector3f &wo, float u1, float u2, float u3,
+              Eigen::Vector3f *wi) const {
+    if (u3 < specular_probability) {
+      // GGX normal distribution sampling, alpha = roughness^2 as in D.
+      const float kA = roughness * roughness;
+      const float kCosTheta =
+          std::sqrt((1.0f - u1) / (1.0f + (kA * kA - 1.0f) * u1));
+      const float kSinTheta =
+          std::sqrt(std::max(0.0f, 1.0f - kCosTheta * kCosTheta));
+      const float kPhi = 2.0f * kPi * u2;
+      const Eigen::Vector3f kH = (t * (kSinTheta * std::cos(kPhi)) +
+                                  b * (kSinTheta * std::sin(kPhi)) +
+                                  n * kCosTheta)
+                                     .normalized();
+      *wi = 2.0f * wo.dot(kH) * kH - wo;
+    } else {
+      const float kR = std::sqrt(u1);
+      const float kPhi = 2.0f * kPi * u2;
+      *wi = (t * (kR * std::cos(kPhi)) + b * (kR * std::sin(kPhi)) +
+             n * std::sqrt(std::max(0.0f, 1.0f - u1)))
+                .normalized();
+    }
+    return n.dot(*wi) > 0.0f;
+  }
+};
+
+}  // namespace
+
+PathTracer::PathTracer()
+    : mesh_(nullptr),
+      model_(Eigen::Matrix4f::Identity()),
+      normal_matrix_(Eigen::Matrix3f::Identity()),
+      environment_(nullptr),
+      ray_epsilon_(1e-4f),
+      albedo_width_(0),
+      albedo_height_(0) {}
+
+void PathTracer::SetMesh(const data_representation::TriangleMesh &mesh,
+                         const Eigen::Matrix4f &model) {
+  mesh_ = &mesh;
+  model_ = model;
+  normal_matrix_ = model.topLeftCorner<3, 3>().inverse().transpose();
+  bvh_.Build(mesh, model);
+  ray_epsilon_ = std::max((bvh_.max() - bvh_.min()).norm() * 1e-5f, 1e-7f);
+}
+
+void PathTracer::SetEnvironment(const EnvironmentMap *environment) {
+  environment_ = environment;
+}
+
+bool PathTracer::LoadAlbedoTexture(const std::string &filename) {
+  QImage image;
+  if (!image.load(filename.c_str())) return false;
+  image = image.convertToFormat(QImage::Format_RGB888);
+
+  albedo_width_ = image.width();
+  albedo_height_ = image.height();
+  albedo_.resize(static_cast<size_t>(albedo_width_ * albedo_height_ * 3));
+  for (int y = 0; y < albedo_height_; ++y) {
+    const unsigned char *row = image.constScanLine(y);
+    for (int x = 0; x < albedo_width_ * 3; ++x)
+      albedo_[static_cast<size_t>(y * albedo_width_ * 3 + x)] = row[x] / 255.0f;
+  }
+  return true;
+}
+
+Eigen::Vector3f PathTracer::Albedo(float u, float v) const {
+  if (albedo_.empty()) return Eigen::Vector3f::Ones();
+
+  // GL_REPEAT with bilinear filtering; row 0 is t = 0 as uploaded by
+  // UploadImage.
+  const float kX = u * albedo_width_ - 0.5f;
+  const float kY = v * albedo_height_ - 0.5f;
+  const float kFloorX = std::floor(kX), kFloorY = std::floor(kY);
+  const float kFx = kX - kFloorX, kFy = kY - kFloorY;
+  auto wrap = [](int i, int n) { return ((i % n) + n) % n; };
+  const int kX0 = wrap(static_cast<int>(kFloorX), albedo_width_);
+  const int kY0 = wrap(static_cast<int>(kFloorY), albedo_height_);
+  const int kX1 = (kX0 + 1) % albedo_width_;
+  const int kY1 = (kY0 + 1) % albedo_height_;
+  auto texel = [this](int x, int y) {
+    const float *p = &albedo_[static_cast<size_t>((y * albedo_width_ + x) * 3)];
+    return Eigen::Vector3f(p[0], p[1], p[2]);
+  };
+  return (texel(kX0, kY0) * (1.0f - kFx) + texel(kX1, kY0) * kFx) *
+             (1.0f - kFy) +
+         (texel(kX0, kY1) * (1.0f - kFx) + texel(kX1, kY1) * kFx) * kFy;
+}
+
+void PathTracer::Surface(const data_representation::Ray &ray,
+                         const data_representation::RayHit &hit,
+                         SurfacePoint *point) const {
+  const std::vector<int> &faces = mesh_->faces_;
+  const int kV[3] = {faces[hit.triangle * 3], faces[hit.triangle * 3 + 1],
+                     faces[hit.triangle * 3 + 2]};
+  const float kW[3] = {1.0f - hit.u - hit.v, hit.u, hit.v};
+
+  Eigen::Vector3f p[3];
+  for (int i = 0; i < 3; ++i) {
+    const Eigen::Vector4f kP =
+        model_ * Eigen::Vector4f(mesh_->vertices_[kV[i] * 3],
+                                 mesh_->vertices_[kV[i] * 3 + 1],
+                                 mesh_->vertices_[kV[i] * 3 + 2], 1.0f);
+    p[i] = kP.head<3>();
+  }
+  point->position = ray.origin + ray.direction * hit.t;
+
+  Eigen::Vector3f geometric = (p[1] - p[0]).cross(p[2] - p[0]);
+  geometric = geometric.squaredNorm() > 0.0f ? geometric.normalized()
+                                             : Eigen::Vector3f(0, 0, 1);
+  if (geometric.dot(ray.direction) > 0.0f) geometric = -geometric;
+  point->geometric_normal = geometric;
+
+  Eigen::Vector3f shading = Eigen::Vector3f::Zero();
+  if (mesh_->normals_.size() == mesh_->vertices_.size()) {
+    for (int i = 0; i < 3; ++i)
+      shading += kW[i] * Eigen::Vector3f(mesh_->normals_[kV[i] * 3],
+                                         mesh_->normals_[kV[i] * 3 + 1],
+                                         mesh_->normals_[kV[i] * 3 + 2]);
+    shading = normal_matrix_ * shading;
+  }
+  if (shading.squaredNorm() <= 0.0f) {
+    shading = geometric;
+  } else {
+    shading.normalize();
+    if (shading.dot(geometric) < 0.0f) shading = -shading;
+  }
+  point->shading_normal = shading;
+
+  float u = 0.0f, v = 0.0f;
+  if (mesh_->textures_.size() / 2 == mesh_->vertices_.size() / 3) {
+    for (int i = 0; i < 3; ++i) {
+      u += kW[i] * mesh_->textures_[kV[i] * 2];
+      v += kW[i] * mesh_->textures_[kV[i] * 2 + 1];
+    }
+  }
+  point->albedo = Albedo(u, v);
+}
+
+Eigen::Vector3f PathTracer::TracePath(data_representation::Ray ray,
+                                      int max_depth, Random *random) const {
+  Eigen::Vector3f radiance = Eigen::Vector3f::Zero();
+  Eigen::Vector3f throughput = Eigen::Vector3f::Ones();
+  float previous_pdf = 0.0f;
+
+  const Eigen::Vector4f kLight =
+      model_ * Eigen::Vector4f(light_.position[0], light_.position[1],
+                               light_.position[2], 1.0f);
+  const Eigen::Vector3f kLightPosition = kLight.head<3>();
+  const bool kEnvironment = environment_ != nullptr && !environment_->Empty();
+
+  for (int depth = 0; depth <= max_depth; ++depth) {
+    data_representation::RayHit hit;
+    if (!bvh_.Intersect(ray, &hit)) {
+      if (kEnvironment) {
+        const float kWeight =
+            depth == 0 ? 1.0f
+                       : PowerHeuristic(previous_pdf,
+                                        environment_->Pdf(ray.direction));
+        radiance += kWeight *
+                    throughput.cwiseProduct(environment_->Lookup(ray.direction));
+      }
+      break;
+    }
+
+    SurfacePoint point;
+    Surface(ray, hit, &point);
+    const Eigen::Vector3f kWo = -ray.direction;
+    const Eigen::Vector3f kOrigin =
+        point.position + point.geometric_normal * ray_epsilon_;
+
+    Lobes lobes;
+    lobes.n = point.shading_normal;
+    OrthonormalBasis(lobes.n, &lobes.t, &lobes.b);
+    lobes.albedo = point.albedo;
+    lobes.material = &material_;
+    lobes.roughness = std::max(material_.roughness, kMinRoughness);
+    lobes.specular_probability =
+        material_.metalness >= 1.0f ? 1.0f : 0.5f + 0.5f * material_.metalness;
+
+    // Point light, a delta distribution so no MIS.
+    {
+      Eigen::Vector3f to_light = kLightPosition - point.position;
+      const float kDistance2 = to_light.squaredNorm();
+      const float kDistance = std::sqrt(kDistance2);
+      to_light /= kDistance;
+      const float kCosine = lobes.n.dot(to_light);
+      if (kCosine > 0.0f &&
+          !bvh_.Occluded({kOrigin, to_light, 0.0f, kDistance})) {
+        radiance += throughput.cwiseProduct(
+            lobes.Evaluate(kWo, to_light).cwiseProduct(light_.color) *
+            (kCosine / kDistance2));
+      }
+    }
+
+    // Environment light sample.
+    if (kEnvironment) {
+      Eigen::Vector3f wi;
+      float light_pdf;
+      const Eigen::Vector3f kLe = environment_->Sample(
+          random->Uniform(), random->Uniform(), &wi, &light_pdf);
+      const float kCosine = lobes.n.dot(wi);
+      if (light_pdf > 0.0f && kCosine > 0.0f &&
+          !bvh_.Occluded({kOrigin, wi, 0.0f,
+                          std::numeric_limits<float>::max()})) {
+        const float kWeight = PowerHeuristic(light_pdf, lobes.Pdf(kWo, wi));
+        radiance += throughput.cwiseProduct(
+            lobes.Evaluate(kWo, wi).cwiseProduct(kLe) *
+            (kCosine * kWeight / light_pdf));
+      }
+    }
+
+    // Continue the path by sampling the BSDF.
+    Eigen::Vector3f wi;
+    const float kU1 = random->Uniform(), kU2 = random->Uniform(),
+                kU3 = random->Uniform();
+    if (!lobes.Sample(kWo, kU1, kU2, kU3, &wi)) break;
+    const float kPdf = lobes.Pdf(kWo, wi);
+    if (kPdf <= 0.0f) break;
+    throughput = throughput.cwiseProduct(lobes.Evaluate(kWo, wi) *
+                                         (lobes.n.dot(wi) / kPdf));
+    previous_pdf = kPdf;
+
+    if (depth >= kRussianRouletteDepth) {
+      const float kSurvival = std::min(MaxComponent(throughput), 0.95f);
+      if (random->Uniform() >= kSurvival) break;
+      throughput /= kSurvival;
+    }
+
+    ray = {kOrigin, wi, 0.0f, std::numeric_limits<float>::max()};
+  }
+
+  return radiance;
+}
+
+void PathTracer::Render(const Eigen::Matrix4f &projection,
+                        const Eigen::Matrix4f &view,
+                        const PathTracerSettings &settings,
+                        std::vector<float> *radiance) const {
+  const int kWidth = settings.width, kHeight = settings.height;
+  radiance->assign(static_cast<size_t>(kWidth * kHeight * 3), 0.0f);
+  if (mesh_ == nullptr) return;
+
+  const Eigen::Matrix4f kInverse = (projection * view).inverse();
+  const int kTile = std::max(settings.tile_size, 1);
+  const int kTilesX = (kWidth + kTile - 1) / kTile;
+  const int kTilesY = (kHeight + kTile - 1) / kTile;
+  const int kSamples = std::max(settings.samples_per_pixel, 1);
+
+  concurrency::ParallelFor(kTilesX * kTilesY, [&](int tile) {
+    const int kX0 = (tile % kTilesX) * kTile;
+    const int kY0 = (tile / kTilesX) * kTile;
+    for (int y = kY0; y < std::min(kY0 + kTile, kHeight); ++y) {
+      for (int x = kX0; x < std::min(kX0 + kTile, kWidth); ++x) {
+        const uint64_t kPixel = static_cast<uint64_t>(y) * kWidth + x;
+        Random random(kPixel * 0x9E3779B97F4A7C15ULL + 1);
+
+        Eigen::Vector3f sum = Eigen::Vector3f::Zero();
+        for (int s = 0; s < kSamples; ++s) {
+          const float kNdcX = 2.0f * (x + random.Uniform()) / kWidth - 1.0f;
+          const float kNdcY = 1.0f - 2.0f * (y + random.Uniform()) / kHeight;
+          Eigen::Vector4f near = kInverse * Eigen::Vector4f(kNdcX, kNdcY, -1, 1);
+          Eigen::Vector4f far = kInverse * Eigen::Vector4f(kNdcX, kNdcY, 1, 1);
+          const Eigen::Vector3f kNear = near.head<3>() / near[3];
+          const Eigen::Vector3f kFar = far.head<3>() / far[3];
+
+          data_representation::Ray ray = {kNear, (kFar - kNear).normalized(),
+                                          0.0f,
+                                          std::numeric_limits<float>::max()};
+          const Eigen::Vector3f kL = TracePath(ray, settings.max_depth, &random);
+          if (kL.allFinite()) sum += kL;
+        }
+
+        const Eigen::Vector3f kAverage = sum / static_cast<float>(kSamples);
+        for (int c = 0; c < 3; ++c)
+          (*radiance)[static_cast<size_t>(kPixel * 3 + c)] = kAverage[c];
+      }
+    }
+  });
+}
+
+void PathTracer::ToneMap(const std::vector<float> &radiance,
+                         std::vector<unsigned char> *pixels) {
+  pixels->resize(radiance.size());
+  for (size_t i = 0; i < radiance.size(); ++i) {
+    const float kC = std::max(radiance[i], 0.0f);
+    const float kMapped = std::pow(kC / (kC + 1.0f), 1.0f / 2.2f);
+    (*pixels)[i] = static_cast<unsigned char>(
+        std::min(std::max(kMapped * 255.0f + 0.5f, 0.0f), 255.0f));
+  }
+}
+
+}  // namespace data_visualization
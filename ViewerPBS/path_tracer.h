@@ -0,0 +1,140 @@
+#ifndef PATH_TRACER_H_
+#define PATH_TRACER_H_
+
+#include <Eigen/Geometry>
+
+#include <string>
+#include <vector>
+
+#include "./bvh.h"
+#include "./environment_map.h"
+#include "./triangle_mesh.h"
+
+namespace data_visualization {
+
+/**
+ * @brief PbrMaterial Parameters of the metallic/roughness model of brdf.frag.
+ * Defaults match the initial GLWidget state.
+ */
+struct PbrMaterial {
+  Eigen::Vector3f fresnel = Eigen::Vector3f(0.972f, 0.960f, 0.915f);
+  float metalness = 1.0f;
+  float roughness = 0.10f;
+};
+
+/**
+ * @brief PointLight The point light of the viewer. The position is given in
+ * the object space of the mesh, as light_position in GLWidget.
+ */
+struct PointLight {
+  Eigen::Vector3f position = Eigen::Vector3f(-5.0f, 5.0f, 5.0f);
+  Eigen::Vector3f color = Eigen::Vector3f(300.0f, 300.0f, 300.0f);
+};
+
+/**
+ * @brief PathTracerSettings Image size and sampling parameters.
+ */
+struct PathTracerSettings {
+  int width = 600;
+  int height = 600;
+  int samples_per_pixel = 64;
+  int max_depth = 5;
+  int tile_size = 16;
+};
+
+/**
+ * @brief PathTracer Tile-parallel CPU path tracer used as ground truth for the
+ * GL shaders. It evaluates the GGX / Schlick / Smith model of brdf.frag with
+ * next event estimation towards the point light and towards the environment
+ * cube map (importance sampled, combined with BSDF sampling through multiple
+ * importance sampling), and uses the camera matrices computed by Camera.
+ */
+class PathTracer {
+ public:
+  /**
+   * @brief PathTracer Constructor of the class.
+   */
+  PathTracer();
+
+  /**
+   * @brief SetMesh Builds the acceleration structure for a mesh.
+   * @param mesh The mesh, which must outlive the path tracer.
+   * @param model Modeling transform, as returned by Camera::SetModel.
+   */
+  void SetMesh(const data_representation::TriangleMesh &mesh,
+               const Eigen::Matrix4f &model);
+
+  /**
+   * @brief SetEnvironment Sets the environment radiance. It must outlive the
+   * path tracer.
+   */
+  void SetEnvironment(const EnvironmentMap *environment);
+
+  /**
+   * @brief LoadAlbedoTexture Loads the texture bound as texture_color in
+   * brdf.frag. Without it the albedo is white.
+   * @param filename Path to the image.
+   * @return Whether it was able to load the image.
+   */
+  bool LoadAlbedoTexture(const std::string &filename);
+
+  /**
+   * @brief SetMaterial Sets the material parameters.
+   */
+  void SetMaterial(const PbrMaterial &material) { material_ = material; }
+
+  /**
+   * @brief SetLight Sets the point light. Its position is given in the object
+   * space of the mesh, as light_position in GLWidget.
+   */
+  void SetLight(const PointLight &light) { light_ = light; }
+
+  /**
+   * @brief Render Renders the mesh seen through the given camera matrices.
+   * Tiles are distributed over all cores and every pixel uses its own random
+   * sequence, so the result does not depend on the number of threads.
+   * @param projection Projection matrix.
+   * @param view Viewing matrix.
+   * @param settings Image size and sampling parameters.
+   * @param radiance Output linear RGB radiance, top row first.
+   */
+  void Render(const Eigen::Matrix4f &projection, const Eigen::Matrix4f &view,
+              const PathTracerSettings &settings,
+              std::vector<float> *radiance) const;
+
+  /**
+   * @brief ToneMap Applies the Reinhard tonemapping and gamma correction of
+   * brdf.frag and quantizes to 8 bits.
+   * @param radiance Linear RGB values.
+   * @param pixels Output 8 bit RGB values.
+   */
+  static void ToneMap(const std::vector<float> &radiance,
+                      std::vector<unsigned char> *pixels);
+
+ private:
+  struct SurfacePoint;
+  class Random;
+
+  Eigen::Vector3f TracePath(data_representation::Ray ray, int max_depth,
+                            Random *random) const;
+  void Surface(const data_representation::Ray &ray,
+               const data_representation::RayHit &hit,
+               SurfacePoint *point) const;
+  Eigen::Vector3f Albedo(float u, float v) const;
+
+  const data_representation::TriangleMesh *mesh_;
+  data_representation::Bvh bvh_;
+  Eigen::Matrix4f model_;
+  Eigen::Matrix3f normal_matrix_;
+  const EnvironmentMap *environment_;
+  float ray_epsilon_;
+  PbrMaterial material_;
+  PointLight light_;
+
+  int albedo_width_, albedo_height_;
+  std::vector<float> albedo_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  PATH_TRACER_H_
@@ -0,0 +1,274 @@
+#include <point_octree.h>
+
+#include <Eigen/Eigenvalues>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+// Bits of the Morton code per axis, which bounds the depth of the octree.
+const int kMaxDepth = 21;
+
+// Sorted neighbors on each side used to fit a missing normal.
+const int kNormalNeighbors = 8;
+
+// Splat radius relative to the mean spacing of the node points.
+const float kSplatScale = 0.75f;
+
+// Clip space w below which a corner is considered behind the eye.
+const float kMinimumW = 1e-5f;
+
+/**
+ * @brief SpreadBits Inserts two zero bits after each of the kMaxDepth low
+ * bits.
+ */
+uint64_t SpreadBits(uint64_t v) {
+  v &= 0x1fffff;
+  v = (v | (v << 32)) & 0x1f00000000ffffULL;
+  v = (v | (v << 16)) & 0x1f0000ff0000ffULL;
+  v = (v | (v << 8)) & 0x100f00f00f00f00fULL;
+  v = (v | (v << 4)) & 0x10c30c30c30c30c3ULL;
+  v = (v | (v << 2)) & 0x1249249249249249ULL;
+  return v;
+}
+
+/**
+ * @brief ParallelSort Sorts one chunk per worker and merges them pairwise.
+ */
+template <typename T>
+void ParallelSort(std::vector<T> *values) {
+  const int kSize = static_cast<int>(values->size());
+  const int kChunks = std::max(1, std::min(concurrency::WorkerCount(),
+                                           kSize / 65536));
+  std::vector<int> bounds(static_cast<size_t>(kChunks + 1));
+  for (int c = 0; c <= kChunks; ++c)
+    bounds[c] = static_cast<int>(static_cast<int64_t>(kSize) * c / kChunks);
+
+  concurrency::ParallelFor(kChunks, 1, [&](int c) {
+    std::sort(values->begin() + bounds[c], values->begin() + bounds[c + 1]);
+  });
+  for (int width = 1; width < kChunks; width *= 2) {
+    const int kPairs = (kChunks + 2 * width - 1) / (2 * width);
+    concurrency::ParallelFor(kPairs, 1, [&](int pair) {
+      const int kBegin = pair * 2 * width;
+      const int kMiddle = std::min(kBegin + width, kChunks);
+      const int kEnd = std::min(kBegin + 2 * width, kChunks);
+      std::inplace_merge(values->begin() + bounds[kBegin],
+                         values->begin() + bounds[kMiddle],
+                         values->begin() + bounds[kEnd]);
+    });
+  }
+}
+
+}  // namespace
+
+PointOctree::PointOctree() {}
+
+void PointOctree::Build(const TriangleMesh &cloud) {
+  nodes_.clear();
+  points_.clear();
+  normals_.clear();
+
+  const int kPoints = static_cast<int>(cloud.vertices_.size() / 3);
+  if (kPoints == 0) return;
+  const bool kHasNormals = cloud.normals_.size() == cloud.vertices_.size();
+
+  // Cubic root cell, slightly enlarged so that the maximum maps inside.
+  const Eigen::Vector3f kMin = cloud.min_;
+  const float kSize =
+      std::max((cloud.max_ - cloud.min_).maxCoeff(), 1e-20f) * 1.0001f;
+  const float kScale = (1 << kMaxDepth) / kSize;
+
+  std::vector<std::pair<uint64_t, int>> keys(static_cast<size_t>(kPoints));
+  concurrency::ParallelFor(kPoints, 4096, [&](int i) {
+    uint64_t code = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+      const float kCell = std::min(
+          std::max((cloud.vertices_[i * 3 + axis] - kMin[axis]) * kScale,
+                   0.0f),
+          static_cast<float>((1 << kMaxDepth) - 1));
+      code |= SpreadBits(static_cast<uint64_t>(kCell)) << axis;
+    }
+    keys[i] = {code, i};
+  });
+  ParallelSort(&keys);
+
+  // Missing normals: plane fitted to the neighbors along the curve.
+  std::vector<float> fitted;
+  if (!kHasNormals) {
+    const Eigen::Vector3f kCenter = (cloud.min_ + cloud.max_) * 0.5f;
+    fitted.resize(cloud.vertices_.size());
+    concurrency::ParallelFor(kPoints, 1024, [&](int i) {
+      const int kBegin = std::max(0, i - kNormalNeighbors);
+      const int kEnd = std::min(kPoints, i + kNormalNeighbors + 1);
+      Eigen::Vector3f mean = Eigen::Vector3f::Zero();
+      for (int j = kBegin; j < kEnd; ++j)
+        mean += Eigen::Vector3f(&cloud.vertices_[keys[j].second * 3]);
+      mean /= static_cast<float>(kEnd - kBegin);
+      Eigen::Matrix3f covariance = Eigen::Matrix3f::Zero();
+      for (int j = kBegin; j < kEnd; ++j) {
+        const Eigen::Vector3f kD =
+            Eigen::Vector3f(&cloud.vertices_[keys[j].second * 3]) - mean;
+        covariance += kD * kD.transpose();
+      }
+      Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> solver;
+      solver.computeDirect(covariance);
+      Eigen::Vector3f normal = solver.eigenvectors().col(0);
+      const int kPoint = keys[i].second;
+      const Eigen::Vector3f kPosition(&cloud.vertices_[kPoint * 3]);
+      if (normal.dot(kPosition - kCenter) < 0.0f) normal = -normal;
+      for (int axis = 0; axis < 3; ++axis)
+        fitted[kPoint * 3 + axis] = normal[axis];
+    });
+  }
+  const std::vector<float> &kNormals = kHasNormals ? cloud.normals_ : fitted;
+
+  std::vector<std::pair<int, int>> ranges;
+  BuildRecursive(keys, 0, kPoints, 0, kMin, kSize, &ranges);
+
+  int total = 0;
+  for (Node &node : nodes_) {
+    node.first = total;
+    total += node.count;
+  }
+  points_.resize(static_cast<size_t>(total) * 4);
+  normals_.resize(static_cast<size_t>(total) * 3);
+
+  // Every node keeps an evenly strided subsample of its range.
+  concurrency::ParallelFor(static_cast<int>(nodes_.size()), 1, [&](int n) {
+    const Node &kNode = nodes_[n];
+    const int kBegin = ranges[n].first;
+    const double kStride =
+        static_cast<double>(ranges[n].second - kBegin) / kNode.count;
+    for (int k = 0; k < kNode.count; ++k) {
+      const int kPoint = keys[kBegin + static_cast<int>(k * kStride)].second;
+      float *point = &points_[static_cast<size_t>(kNode.first + k) * 4];
+      float *normal = &normals_[static_cast<size_t>(kNode.first + k) * 3];
+      for (int axis = 0; axis < 3; ++axis) {
+        point[axis] = cloud.vertices_[kPoint * 3 + axis];
+        normal[axis] = kNormals[kPoint * 3 + axis];
+      }
+      point[3] = kNode.radius;
+    }
+  });
+}
+
+int PointOctree::BuildRecursive(
+    const std::vector<std::pair<uint64_t, int>> &keys, int begin, int end,
+    int depth, const Eigen::Vector3f &min, float size,
+    std::vector<std::pair<int, int>> *ranges) {
+  const int kIndex = static_cast<int>(nodes_.size());
+  Node node;
+  node.min = min;
+  node.size = size;
+  node.first = 0;
+  node.count = std::min(end - begin, kOctreeNodePoints);
+  // Points of a surface crossing the cell are about size / sqrt(count)
+  // apart.
+  node.radius = kSplatScale * size / std::sqrt(static_cast<float>(node.count));
+  std::fill_n(node.children, 8, -1);
+  nodes_.push_back(node);
+  ranges->push_back({begin, end});
+
+  if (end - begin <= kOctreeNodePoints || depth == kMaxDepth) return kIndex;
+
+  // The octant is given by the next three bits of the code, x first.
+  const int kShift = 3 * (kMaxDepth - 1 - depth);
+  int child_begin = begin;
+  for (int octant = 0; octant < 8; ++octant) {
+    const int kChildEnd = static_cast<int>(
+        std::partition_point(keys.begin() + child_begin, keys.begin() + end,
+                             [&](const std::pair<uint64_t, int> &key) {
+                               return static_cast<int>((key.first >> kShift) &
+                                                       7) <= octant;
+                             }) -
+        keys.begin());
+    if (kChildEnd > child_begin) {
+      const float kHalf = size * 0.5f;
+      const Eigen::Vector3f kChildMin =
+          min + Eigen::Vector3f((octant & 1) ? kHalf : 0.0f,
+                                (octant & 2) ? kHalf : 0.0f,
+                                (octant & 4) ? kHalf : 0.0f);
+      const int kChild = BuildRecursive(keys, child_begin, kChildEnd,
+                                        depth + 1, kChildMin, kHalf, ranges);
+      nodes_[kIndex].children[octant] = kChild;
+    }
+    child_begin = kChildEnd;
+  }
+  return kIndex;
+}
+
+int PointOctree::Select(const Eigen::Matrix4f &transform, float pixel_scale,
+                        int budget, std::vector<int> *nodes) const {
+  nodes->clear();
+  if (nodes_.empty()) return 0;
+
+  // Projected splat size of a visible node, negative when it is culled.
+  auto splat_size = [&](const Node &node) {
+    bool outside[6] = {true, true, true, true, true, true};
+    for (int corner = 0; corner < 8; ++corner) {
+      const Eigen::Vector3f kCorner =
+          node.min + Eigen::Vector3f((corner & 1) ? node.size : 0.0f,
+                                     (corner & 2) ? node.size : 0.0f,
+                                     (corner & 4) ? node.size : 0.0f);
+      const Eigen::Vector4f kClip = transform * kCorner.homogeneous();
+      for (int axis = 0; axis < 3; ++axis) {
+        outside[axis * 2] = outside[axis * 2] && kClip[axis] < -kClip[3];
+        outside[axis * 2 + 1] =
+            outside[axis * 2 + 1] && kClip[axis] > kClip[3];
+      }
+    }
+    for (bool plane : outside)
+      if (plane) return -1.0f;
+
+    const Eigen::Vector3f kCenter =
+        node.min + Eigen::Vector3f::Constant(node.size * 0.5f);
+    const float kW = (transform.row(3) * kCenter.homogeneous())(0);
+    // Nodes around the eye are refined first.
+    if (kW <= kMinimumW) return std::numeric_limits<float>::max();
+    return node.radius * pixel_scale / kW;
+  };
+
+  std::priority_queue<std::pair<float, int>> queue;
+  const float kRootSize = splat_size(nodes_[0]);
+  if (kRootSize < 0.0f) return 0;
+  queue.push({kRootSize, 0});
+  int points = nodes_[0].count;
+
+  while (!queue.empty()) {
+    const int kIndex = queue.top().second;
+    const float kSize = queue.top().first;
+    queue.pop();
+    const Node &kNode = nodes_[kIndex];
+
+    // Refine while the splats are larger than a pixel and the children fit.
+    std::pair<float, int> children[8];
+    int visible = 0, child_points = 0;
+    bool leaf = true;
+    for (int child : kNode.children) {
+      if (child < 0) continue;
+      leaf = false;
+      const float kChildSize = splat_size(nodes_[child]);
+      if (kChildSize < 0.0f) continue;
+      children[visible++] = {kChildSize, child};
+      child_points += nodes_[child].count;
+    }
+    if (leaf || kSize <= 1.0f ||
+        points - kNode.count + child_points > budget) {
+      nodes->push_back(kIndex);
+      continue;
+    }
+    points += child_points - kNode.count;
+    for (int c = 0; c < visible; ++c) queue.push(children[c]);
+  }
+  return points;
+}
+
+}  // namespace data_representation
@@ -0,0 +1,123 @@
+#ifndef POINT_OCTREE_H_
+#define POINT_OCTREE_H_
+
+#include <Eigen/Geometry>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "./triangle_mesh.h"
+
+namespace data_representation {
+
+/**
+ * @brief kOctreeNodePoints Maximum number of points stored per node. Leaves
+ * keep all their points, inner nodes a regular subsample of them.
+ */
+const int kOctreeNodePoints = 8192;
+
+/**
+ * @brief kPointBudget Default maximum number of points drawn per frame.
+ */
+const int kPointBudget = 4000000;
+
+/**
+ * @brief PointOctree Level of detail hierarchy over a point cloud (a mesh
+ * without faces). Points are sorted along a Morton curve, so every node is a
+ * contiguous range of them, and every node stores up to kOctreeNodePoints
+ * representative points together with the radius of the splat that covers
+ * the gaps between them. Drawing a cut of the tree (a node or its children,
+ * never both) shows the whole cloud at a varying density.
+ */
+class PointOctree {
+ public:
+  /**
+   * @brief Node An octree cell and the range of its points in points().
+   */
+  struct Node {
+    Eigen::Vector3f min;
+    float size;
+    int first;
+    int count;
+
+    /**
+     * @brief radius Splat radius of the node points in object space.
+     */
+    float radius;
+
+    /**
+     * @brief children Indices of the child nodes, -1 for empty octants. All
+     * of them are -1 for leaves.
+     */
+    int children[8];
+  };
+
+  /**
+   * @brief PointOctree Constructor of the class. The octree is empty until
+   * built.
+   */
+  PointOctree();
+
+  /**
+   * @brief Build Sorts the points, creates the nodes and gathers their
+   * points, distributing the work over all cores. Clouds without normals get
+   * normals fitted to their Morton neighbors, oriented away from the center
+   * of the bounding box.
+   * @param cloud The points, as the vertices (and optionally normals) of a
+   * mesh without faces.
+   */
+  void Build(const TriangleMesh &cloud);
+
+  /**
+   * @brief Select Chooses the nodes to draw, refining first the nodes whose
+   * splats are largest on screen until the splats are below one pixel or the
+   * point budget is spent. Nodes outside the view frustum are skipped.
+   * @param transform Product of the projection, view and model matrices.
+   * @param pixel_scale Factor from an object space length divided by the
+   * clip w to a size in pixels (projection(1, 1) times the viewport height
+   * over two).
+   * @param budget Maximum number of points.
+   * @param nodes The selected node indices.
+   * @return The number of selected points.
+   */
+  int Select(const Eigen::Matrix4f &transform, float pixel_scale, int budget,
+             std::vector<int> *nodes) const;
+
+  /**
+   * @brief points Node points, four floats each: position and splat radius.
+   */
+  const std::vector<float> &points() const { return points_; }
+
+  /**
+   * @brief normals Node point normals, three floats each.
+   */
+  const std::vector<float> &normals() const { return normals_; }
+
+  const std::vector<Node> &nodes() const { return nodes_; }
+
+  /**
+   * @brief Empty Whether the octree has not been built.
+   */
+  bool Empty() const { return nodes_.empty(); }
+
+ private:
+  /**
+   * @brief BuildRecursive Creates the node of the sorted points [begin, end)
+   * and its descendants.
+   * @param ranges The [begin, end) range of every created node.
+   * @return The index of the node.
+   */
+  int BuildRecursive(const std::vector<std::pair<uint64_t, int>> &keys,
+                     int begin, int end, int depth, const Eigen::Vector3f &min,
+                     float size, std::vector<std::pair<int, int>> *ranges);
+
+  std::vector<Node> nodes_;
+
+  std::vector<float> points_;
+  std::vector<float> normals_;
+};
+
+}  // namespace data_representation
+
+#endif  //  POINT_OCTREE_H_
@@ -0,0 +1,312 @@
+#include <rasterizer.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "./parallel_for.h"
+#include "./simd.h"
+
+namespace data_visualization {
+
+namespace {
+
+/**
+ * @brief kTileSize Width and height of the screen tiles, a multiple of
+ * simd::kWidth.
+ */
+const int kTileSize = 32;
+
+/**
+ * @brief kFacesPerChunk Faces transformed and binned by one task.
+ */
+const int kFacesPerChunk = 8192;
+
+/**
+ * @brief kSubpixelSteps Window coordinates are snapped to 1 / kSubpixelSteps
+ * of a pixel, as GL implementations do with 8 bits of subpixel precision.
+ */
+const float kSubpixelSteps = 256.0f;
+
+}  // namespace
+
+Rasterizer::Rasterizer()
+    : width_(0), height_(0), stride_(0), tiles_x_(0), tiles_y_(0) {}
+
+void Rasterizer::Render(const data_representation::TriangleMesh &mesh,
+                        const Eigen::Matrix4f &projection,
+                        const Eigen::Matrix4f &view,
+                        const Eigen::Matrix4f &model, int width, int height,
+                        GBuffer *gbuffer) {
+  width_ = width;
+  height_ = height;
+  tiles_x_ = (width + kTileSize - 1) / kTileSize;
+  tiles_y_ = (height + kTileSize - 1) / kTileSize;
+  stride_ = tiles_x_ * kTileSize;
+  const size_t kPadded = static_cast<size_t>(stride_ * tiles_y_ * kTileSize);
+  depth_.resize(kPadded);
+  normal_x_.resize(kPadded);
+  normal_y_.resize(kPadded);
+  normal_z_.resize(kPadded);
+
+  // step_one.vert.
+  const Eigen::Matrix4f kModelView = view * model;
+  const Eigen::Matrix4f kClip = projection * kModelView;
+  const Eigen::Matrix3f kNormalMatrix =
+      kModelView.topLeftCorner<3, 3>().inverse().transpose();
+  const bool kHasNormals = mesh.normals_.size() == mesh.vertices_.size();
+
+  const int kVertices = static_cast<int>(mesh.vertices_.size() / 3);
+  clip_.resize(static_cast<size_t>(kVertices));
+  normal_.resize(static_cast<size_t>(kVertices));
+  concurrency::ParallelFor(kVertices, 4096, [&](int i) {
+    const float *v = &mesh.vertices_[static_cast<size_t>(i * 3)];
+    clip_[i] = kClip * Eigen::Vector4f(v[0], v[1], v[2], 1.0f);
+    if (kHasNormals) {
+      const float *n = &mesh.normals_[static_cast<size_t>(i * 3)];
+      normal_[i] = (kNormalMatrix * Eigen::Vector3f(n[0], n[1], n[2]))
+                       .normalized();
+    } else {
+      normal_[i] = Eigen::Vector3f::Zero();
+    }
+  });
+
+  // Triangle setup and binning.
+  const int kFaces = static_cast<int>(mesh.faces_.size() / 3);
+  const int kChunks = (kFaces + kFacesPerChunk - 1) / kFacesPerChunk;
+  const int kTiles = tiles_x_ * tiles_y_;
+  triangles_.resize(static_cast<size_t>(kChunks));
+  bins_.resize(static_cast<size_t>(kChunks));
+  for (std::vector<std::vector<int>> &bins : bins_)
+    bins.resize(static_cast<size_t>(kTiles));
+  concurrency::ParallelFor(kChunks,
+                           [&](int chunk) { SetupTriangles(mesh, chunk); });
+
+  // step_one.frag and depth test.
+  concurrency::ParallelFor(kTiles, [&](int tile) { RasterizeTile(tile); });
+
+  gbuffer->width = width;
+  gbuffer->height = height;
+  gbuffer->normal.resize(static_cast<size_t>(width * height * 3));
+  gbuffer->depth.resize(static_cast<size_t>(width * height));
+  concurrency::ParallelFor(height, 16, [&](int y) {
+    for (int x = 0; x < width; ++x) {
+      const size_t kSource = static_cast<size_t>(y * stride_ + x);
+      const size_t kTarget = static_cast<size_t>(y * width + x);
+      gbuffer->depth[kTarget] = depth_[kSource];
+      gbuffer->normal[kTarget * 3] = normal_x_[kSource];
+      gbuffer->normal[kTarget * 3 + 1] = normal_y_[kSource];
+      gbuffer->normal[kTarget * 3 + 2] = normal_z_[kSource];
+    }
+  });
+}
+
+void Rasterizer::SetupTriangles(const data_representation::TriangleMesh &mesh,
+                                int chunk) {
+  triangles_[chunk].clear();
+  for (std::vector<int> &bin : bins_[chunk]) bin.clear();
+
+  const int kBegin = chunk * kFacesPerChunk;
+  const int kEnd = std::min(static_cast<int>(mesh.faces_.size() / 3),
+                            kBegin + kFacesPerChunk);
+  for (int f = kBegin; f < kEnd; ++f) {
+    Eigen::Vector4f clip[3];
+    Eigen::Vector3f normal[3];
+    for (int i = 0; i < 3; ++i) {
+      const int kVertex = mesh.faces_[static_cast<size_t>(f * 3 + i)];
+      clip[i] = clip_[kVertex];
+      normal[i] = normal_[kVertex];
+    }
+
+    // Trivially reject triangles outside one of the other frustum planes.
+    bool outside = false;
+    for (int axis = 0; axis < 3 && !outside; ++axis) {
+      outside = (clip[0][axis] > clip[0][3] && clip[1][axis] > clip[1][3] &&
+                 clip[2][axis] > clip[2][3]) ||
+                (axis < 2 && clip[0][axis] < -clip[0][3] &&
+                 clip[1][axis] < -clip[1][3] && clip[2][axis] < -clip[2][3]);
+    }
+    if (outside) continue;
+
+    // Near plane clipping (z >= -w), which also keeps w positive.
+    float distance[3];
+    int inside = 0;
+    for (int i = 0; i < 3; ++i) {
+      distance[i] = clip[i][2] + clip[i][3];
+      if (distance[i] >= 0.0f) ++inside;
+    }
+    if (inside == 3) {
+      AddTriangle(clip, normal, chunk);
+      continue;
+    }
+    if (inside == 0) continue;
+
+    Eigen::Vector4f polygon_clip[4];
+    Eigen::Vector3f polygon_normal[4];
+    int count = 0;
+    for (int i = 0; i < 3; ++i) {
+      const int kNext = (i + 1) % 3;
+      if (distance[i] >= 0.0f) {
+        polygon_clip[count] = clip[i];
+        polygon_normal[count++] = normal[i];
+      }
+      if ((distance[i] >= 0.0f) != (distance[kNext] >= 0.0f)) {
+        const float kT = distance[i] / (distance[i] - distance[kNext]);
+        polygon_clip[count] = clip[i] + (clip[kNext] - clip[i]) * kT;
+        polygon_normal[count++] = normal[i] + (normal[kNext] - normal[i]) * kT;
+      }
+    }
+    for (int i = 1; i + 1 < count; ++i) {
+      const Eigen::Vector4f kFanClip[3] = {polygon_clip[0], polygon_clip[i],
+                                           polygon_clip[i + 1]};
+      const Eigen::Vector3f kFanNormal[3] = {
+          polygon_normal[0], polygon_normal[i], polygon_normal[i + 1]};
+      AddTriangle(kFanClip, kFanNormal, chunk);
+    }
+  }
+}
+
+void Rasterizer::AddTriangle(const Eigen::Vector4f clip[3],
+                             const Eigen::Vector3f normal[3], int chunk) {
+  float x[3], y[3], z[3], inverse_w[3];
+  for (int i = 0; i < 3; ++i) {
+    inverse_w[i] = 1.0f / clip[i][3];
+    x[i] = (clip[i][0] * inverse_w[i] * 0.5f + 0.5f) * width_;
+    y[i] = (clip[i][1] * inverse_w[i] * 0.5f + 0.5f) * height_;
+    z[i] = clip[i][2] * inverse_w[i] * 0.5f + 0.5f;
+    x[i] = std::round(x[i] * kSubpixelSteps) / kSubpixelSteps;
+    y[i] = std::round(y[i] * kSubpixelSteps) / kSubpixelSteps;
+  }
+
+  // Counter clockwise triangles are front facing; back faces are culled.
+  const float kArea = (x[1] - x[0]) * (y[2] - y[0]) -
+                      (x[2] - x[0]) * (y[1] - y[0]);
+  if (!(kArea > 0.0f)) return;
+
+  Triangle triangle;
+  triangle.min_x = std::max(
+      0, static_cast<int>(std::ceil(std::min({x[0], x[1], x[2]}) - 0.5f)));
+  triangle.max_x = std::min(
+      width_ - 1,
+      static_cast<int>(std::floor(std::max({x[0], x[1], x[2]}) - 0.5f)));
+  triangle.min_y = std::max(
+      0, static_cast<int>(std::ceil(std::min({y[0], y[1], y[2]}) - 0.5f)));
+  triangle.max_y = std::min(
+      height_ - 1,
+      static_cast<int>(std::floor(std::max({y[0], y[1], y[2]}) - 0.5f)));
+  // Most triangles of dense meshes cover no pixel center at all.
+  if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y)
+    return;
+
+  triangle.x0 = x[0];
+  triangle.y0 = y[0];
+  const float kInverseArea = 1.0f / kArea;
+  for (int i = 0; i < 3; ++i) {
+    const int kJ = (i + 1) % 3, kK = (i + 2) % 3;
+    const float kDx = -(y[kK] - y[kJ]) * kInverseArea;
+    const float kDy = (x[kK] - x[kJ]) * kInverseArea;
+    triangle.edge[i][0] = kDx * (x[0] - x[kJ]) + kDy * (y[0] - y[kJ]);
+    triangle.edge[i][1] = kDx;
+    triangle.edge[i][2] = kDy;
+    triangle.top_left[i] = y[kK] < y[kJ] || (y[kK] == y[kJ] && x[kK] < x[kJ]);
+  }
+
+  auto plane = [&triangle](float f0, float f1, float f2, float *out) {
+    out[0] = f0;
+    out[1] = (f1 - f0) * triangle.edge[1][1] + (f2 - f0) * triangle.edge[2][1];
+    out[2] = (f1 - f0) * triangle.edge[1][2] + (f2 - f0) * triangle.edge[2][2];
+  };
+  plane(z[0], z[1], z[2], triangle.depth);
+  plane(inverse_w[0], inverse_w[1], inverse_w[2], triangle.inverse_w);
+  for (int c = 0; c < 3; ++c)
+    plane(normal[0][c] * inverse_w[0], normal[1][c] * inverse_w[1],
+          normal[2][c] * inverse_w[2], triangle.normal[c]);
+
+  std::vector<Triangle> &triangles = triangles_[chunk];
+  const int kIndex = static_cast<int>(triangles.size());
+  triangles.push_back(triangle);
+  for (int ty = triangle.min_y / kTileSize; ty <= triangle.max_y / kTileSize;
+       ++ty)
+    for (int tx = triangle.min_x / kTileSize;
+         tx <= triangle.max_x / kTileSize; ++tx)
+      bins_[chunk][static_cast<size_t>(ty * tiles_x_ + tx)].push_back(kIndex);
+}
+
+void Rasterizer::RasterizeTile(int tile) {
+  const int kTileX = (tile % tiles_x_) * kTileSize;
+  const int kTileY = (tile / tiles_x_) * kTileSize;
+
+  for (int y = kTileY; y < kTileY + kTileSize; ++y) {
+    const size_t kRow = static_cast<size_t>(y * stride_ + kTileX);
+    std::fill_n(&depth_[kRow], kTileSize, 1.0f);
+    std::fill_n(&normal_x_[kRow], kTileSize, 0.0f);
+    std::fill_n(&normal_y_[kRow], kTileSize, 0.0f);
+    std::fill_n(&normal_z_[kRow], kTileSize, 0.0f);
+  }
+
+  const simd::Float kZero(0.0f), kOne(1.0f), kTiny(1e-30f);
+  for (size_t chunk = 0; chunk < bins_.size(); ++chunk) {
+    for (int index : bins_[chunk][static_cast<size_t>(tile)]) {
+      const Triangle &t = triangles_[chunk][static_cast<size_t>(index)];
+      const int kMinX = std::max(t.min_x, kTileX);
+      const int kMaxX = std::min(t.max_x, kTileX + kTileSize - 1);
+      const int kMinY = std::max(t.min_y, kTileY);
+      const int kMaxY = std::min(t.max_y, kTileY + kTileSize - 1);
+      // Aligned to the SIMD width so that no store leaves the tile.
+      const int kStartX =
+          kTileX + (kMinX - kTileX) / simd::kWidth * simd::kWidth;
+      const simd::Float kMinXLanes(static_cast<float>(kMinX));
+      const simd::Float kMaxXLanes(static_cast<float>(kMaxX));
+
+      for (int y = kMinY; y <= kMaxY; ++y) {
+        const simd::Float kPy(y + 0.5f - t.y0);
+        for (int x = kStartX; x <= kMaxX; x += simd::kWidth) {
+          const simd::Float kColumn = simd::Iota(static_cast<float>(x));
+          const simd::Float kPx = kColumn + simd::Float(0.5f - t.x0);
+
+          simd::Mask covered = (kColumn >= kMinXLanes) & (kColumn <= kMaxXLanes);
+          for (int e = 0; e < 3; ++e) {
+            const simd::Float kValue = simd::Float(t.edge[e][0]) +
+                                       simd::Float(t.edge[e][1]) * kPx +
+                                       simd::Float(t.edge[e][2]) * kPy;
+            covered = covered &
+                      (t.top_left[e] ? kValue >= kZero : kValue > kZero);
+          }
+          if (!simd::Any(covered)) continue;
+
+          float *depth = &depth_[static_cast<size_t>(y * stride_ + x)];
+          const simd::Float kDepth = simd::Float(t.depth[0]) +
+                                     simd::Float(t.depth[1]) * kPx +
+                                     simd::Float(t.depth[2]) * kPy;
+          const simd::Float kOldDepth = simd::Load(depth);
+          covered = covered & (kDepth < kOldDepth) & (kDepth >= kZero) &
+                    (kDepth <= kOne);
+          if (!simd::Any(covered)) continue;
+
+          const simd::Float kInverseW = simd::Float(t.inverse_w[0]) +
+                                        simd::Float(t.inverse_w[1]) * kPx +
+                                        simd::Float(t.inverse_w[2]) * kPy;
+          simd::Float n[3];
+          for (int c = 0; c < 3; ++c)
+            n[c] = (simd::Float(t.normal[c][0]) +
+                    simd::Float(t.normal[c][1]) * kPx +
+                    simd::Float(t.normal[c][2]) * kPy) /
+                   kInverseW;
+          // normalize(eye_normal) in step_one.frag.
+          const simd::Float kLength =
+              simd::Max(simd::Sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]),
+                        kTiny);
+
+          const size_t kPixel = static_cast<size_t>(y * stride_ + x);
+          simd::Store(depth, simd::Select(covered, kDepth, kOldDepth));
+          float *targets[3] = {&normal_x_[kPixel], &normal_y_[kPixel],
+                               &normal_z_[kPixel]};
+          for (int c = 0; c < 3; ++c)
+            simd::Store(targets[c], simd::Select(covered, n[c] / kLength,
+                                                 simd::Load(targets[c])));
+        }
+      }
+    }
+  }
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,136 @@
+#ifndef RASTERIZER_H_
+#define RASTERIZER_H_
+
+#include <Eigen/Geometry>
+
+#include <vector>
+
+#include "./triangle_mesh.h"
+
+namespace data_visualization {
+
+/**
+ * @brief GBuffer CPU copy of the render targets written by the first SSAO
+ * step. Rows are stored bottom to top, as in the GL textures.
+ */
+struct GBuffer {
+  int width = 0;
+  int height = 0;
+
+  /**
+   * @brief normal Eye space normal written by step_one.frag, 3 floats per
+   * pixel. Empty pixels keep the clear color (0, 0, 0). The values are not
+   * quantized: the GL_RG16 target stores them octahedral encoded.
+   */
+  std::vector<float> normal;
+
+  /**
+   * @brief depth Window space depth, cleared to 1.
+   */
+  std::vector<float> depth;
+};
+
+/**
+ * @brief Rasterizer Tile based software rasterizer that reproduces the first
+ * SSAO pass (step_one.vert / step_one.frag) without a GL context. It follows
+ * the GL pipeline: near plane clipping, back face culling (GL_CULL_FACE with
+ * counter clockwise front faces), pixel center sampling with a top-left fill
+ * rule, perspective correct normal interpolation and a GL_LESS depth test.
+ * Vertices and triangle setup are processed in parallel chunks, and each
+ * screen tile is then shaded by a single thread walking its bins in
+ * submission order, kWidth pixels at a time, so the output is deterministic
+ * regardless of the number of threads.
+ */
+class Rasterizer {
+ public:
+  /**
+   * @brief Rasterizer Constructor of the class.
+   */
+  Rasterizer();
+
+  /**
+   * @brief Render Rasterizes the mesh into the G-buffer. Intermediate buffers
+   * are kept between calls, so rendering repeatedly does not allocate.
+   * @param mesh The triangle mesh, with per-vertex normals.
+   * @param projection Projection matrix.
+   * @param view Viewing matrix.
+   * @param model Modeling matrix.
+   * @param width Target width.
+   * @param height Target height.
+   * @param gbuffer The resulting normal and depth buffers.
+   */
+  void Render(const data_representation::TriangleMesh &mesh,
+              const Eigen::Matrix4f &projection, const Eigen::Matrix4f &view,
+              const Eigen::Matrix4f &model, int width, int height,
+              GBuffer *gbuffer);
+
+ private:
+  /**
+   * @brief Triangle A clipped, culled and set up triangle. Every attribute is
+   * stored as a plane a + dx * (x - x0) + dy * (y - y0) over window
+   * coordinates, where (x0, y0) is its first vertex.
+   */
+  struct Triangle {
+    float x0, y0;
+
+    /**
+     * @brief edge Planes of the barycentric coordinates of the three vertices.
+     */
+    float edge[3][3];
+
+    /**
+     * @brief top_left Whether pixels lying exactly on each edge are covered.
+     */
+    bool top_left[3];
+
+    float depth[3];
+    float inverse_w[3];
+
+    /**
+     * @brief normal Planes of normal / w for perspective correct interpolation.
+     */
+    float normal[3][3];
+
+    /**
+     * @brief min_x, min_y, max_x, max_y Inclusive range of covered pixels.
+     */
+    int min_x, min_y, max_x, max_y;
+  };
+
+  void SetupTriangles(const data_representation::TriangleMesh &mesh,
+                      int chunk);
+  void AddTriangle(const Eigen::Vector4f clip[3],
+                   const Eigen::Vector3f normal[3], int chunk);
+  void RasterizeTile(int tile);
+
+  int width_, height_, stride_;
+  int tiles_x_, tiles_y_;
+
+  /**
+   * @brief clip_, normal_ Per-vertex outputs of step_one.vert.
+   */
+  std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f>>
+      clip_;
+  std::vector<Eigen::Vector3f> normal_;
+
+  /**
+   * @brief triangles_ Set up triangles of every chunk of faces.
+   */
+  std::vector<std::vector<Triangle>> triangles_;
+
+  /**
+   * @brief bins_ For every chunk and tile, the triangles of triangles_[chunk]
+   * that overlap the tile.
+   */
+  std::vector<std::vector<std::vector<int>>> bins_;
+
+  /**
+   * @brief depth_, normal_x_, normal_y_, normal_z_ Render targets with rows
+   * padded to a whole number of tiles.
+   */
+  std::vector<float> depth_, normal_x_, normal_y_, normal_z_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  RASTERIZER_H_
@@ -0,0 +1,341 @@
+#include <render_graph.h>
+
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+
+namespace data_visualization {
+
+namespace {
+
+/**
+ * @brief kPoolRetainFrames Executes a pooled description survives without
+ * being used, so that switching between outputs does not recreate textures
+ * while the storage of old viewport sizes is eventually released.
+ */
+const uint64_t kPoolRetainFrames = 60;
+
+/**
+ * @brief CreateTexture Creates the texture of a render target, bound to unit.
+ */
+GLuint CreateTexture(const RenderTargetDesc &desc, int unit,
+                     GLStateCache *state) {
+  GLuint texture;
+  glGenTextures(1, &texture);
+  state->BindTexture(unit, GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, desc.internal_format, desc.width,
+               desc.height, 0, desc.format, desc.type, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  return texture;
+}
+
+}  // namespace
+
+uint64_t HashBytes(const void *data, size_t size, uint64_t hash) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool RenderTargetDesc::operator<(const RenderTargetDesc &other) const {
+  return std::tie(internal_format, format, type, width, height) <
+         std::tie(other.internal_format, other.format, other.type,
+                  other.width, other.height);
+}
+
+RenderGraph::RenderGraph() : frame_(0), executed_(0), cached_(0) {}
+
+void RenderGraph::Reset() {
+  resources_.clear();
+  passes_.clear();
+}
+
+int RenderGraph::CreateTarget(const std::string &name,
+                              const RenderTargetDesc &desc, int unit) {
+  Resource resource;
+  resource.name = name;
+  resource.desc = desc;
+  resource.unit = unit;
+  resource.texture = 0;
+  resource.imported = false;
+  resource.cached = false;
+  resource.fresh = false;
+  resource.version = 0;
+  resource.first = -1;
+  resource.last = -1;
+  resources_.push_back(resource);
+  return static_cast<int>(resources_.size()) - 1;
+}
+
+int RenderGraph::ImportTexture(const std::string &name, GLuint texture,
+                               int unit) {
+  Resource resource;
+  resource.name = name;
+  resource.desc = RenderTargetDesc();
+  resource.unit = unit;
+  resource.texture = texture;
+  resource.imported = true;
+  resource.cached = false;
+  resource.fresh = false;
+  resource.version = HashValue(texture);
+  resource.first = -1;
+  resource.last = -1;
+  resources_.push_back(resource);
+  return static_cast<int>(resources_.size()) - 1;
+}
+
+void RenderGraph::AddPass(const std::string &name,
+                          const std::vector<int> &reads,
+                          const std::vector<int> &writes,
+                          const std::function<void()> &execute,
+                          uint64_t key) {
+  const bool kBackbufferPass =
+      std::find(writes.begin(), writes.end(), kBackbuffer) != writes.end();
+  passes_.push_back({name, reads, writes, execute,
+                     kBackbufferPass ? kUncachedPass : key, false,
+                     kNoResource});
+  if (key == kUncachedPass || kBackbufferPass) return;
+  for (int write : writes) resources_[write].cached = true;
+}
+
+void RenderGraph::AttachDepth(int resource) {
+  passes_.back().depth = resource;
+}
+
+void RenderGraph::Execute(int output, GLStateCache *state) {
+  ++frame_;
+  Cull(output);
+  Allocate(state);
+
+  executed_ = 0;
+  cached_ = 0;
+  for (const Pass &kPass : passes_) {
+    if (!kPass.live) continue;
+
+    // The results depend on the key and on the versions of the reads.
+    uint64_t version = kPass.key == kUncachedPass ? HashValue(frame_)
+                                                  : HashValue(kPass.key);
+    for (int read : kPass.reads)
+      version = HashValue(resources_[read].version, version);
+    if (kPass.depth != kNoResource)
+      version = HashValue(resources_[kPass.depth].version, version);
+    bool fresh = false;
+    for (int write : kPass.writes)
+      if (write != kBackbuffer) {
+        resources_[write].version = version;
+        fresh = fresh || resources_[write].fresh;
+        // Another pass overwrote the result since this one last ran.
+        auto target = cached_targets_.find(resources_[write].name);
+        if (resources_[write].cached && target != cached_targets_.end() &&
+            target->second.writer != kPass.name)
+          fresh = true;
+      }
+    if (kPass.key != kUncachedPass) {
+      auto result = results_.find(kPass.name);
+      if (!fresh && result != results_.end() && result->second == version) {
+        ++cached_;
+        continue;
+      }
+      results_[kPass.name] = version;
+    }
+
+    for (int write : kPass.writes)
+      if (write != kBackbuffer && resources_[write].cached)
+        cached_targets_[resources_[write].name].writer = kPass.name;
+
+    const bool kBackbufferPass =
+        std::find(kPass.writes.begin(), kPass.writes.end(), kBackbuffer) !=
+        kPass.writes.end();
+    state->BindFramebuffer(kBackbufferPass ? 0 : Framebuffer(kPass, state));
+    for (int read : kPass.reads) {
+      const Resource &kResource = resources_[read];
+      if (kResource.unit >= 0)
+        state->BindTexture(kResource.unit, GL_TEXTURE_2D, kResource.texture);
+    }
+    kPass.execute();
+    ++executed_;
+  }
+}
+
+void RenderGraph::Release() {
+  for (auto &textures : pool_)
+    glDeleteTextures(static_cast<GLsizei>(textures.second.size()),
+                     textures.second.data());
+  for (auto &target : cached_targets_)
+    glDeleteTextures(1, &target.second.texture);
+  for (auto &framebuffer : framebuffers_)
+    glDeleteFramebuffers(1, &framebuffer.second);
+  pool_.clear();
+  pool_used_.clear();
+  cached_targets_.clear();
+  framebuffers_.clear();
+  results_.clear();
+}
+
+void RenderGraph::Cull(int output) {
+  std::vector<bool> needed(resources_.size(), false);
+  if (output != kBackbuffer) needed[output] = true;
+
+  for (int p = static_cast<int>(passes_.size()) - 1; p >= 0; --p) {
+    Pass &pass = passes_[p];
+    pass.live = false;
+    for (int write : pass.writes)
+      if (write == kBackbuffer ? output == kBackbuffer : needed[write])
+        pass.live = true;
+    if (!pass.live) continue;
+    for (int read : pass.reads) needed[read] = true;
+    if (pass.depth != kNoResource) needed[pass.depth] = true;
+  }
+}
+
+void RenderGraph::Allocate(GLStateCache *state) {
+  for (Resource &resource : resources_) {
+    resource.first = -1;
+    resource.last = -1;
+  }
+  for (int p = 0; p < static_cast<int>(passes_.size()); ++p) {
+    const Pass &kPass = passes_[p];
+    if (!kPass.live) continue;
+    const std::vector<int> kDepth = {kPass.depth};
+    for (const std::vector<int> *kUses :
+         {&kPass.reads, &kPass.writes, &kDepth}) {
+      for (int use : *kUses) {
+        if (use == kBackbuffer || use == kNoResource) continue;
+        Resource &resource = resources_[use];
+        if (resource.first < 0) resource.first = p;
+        resource.last = p;
+      }
+    }
+  }
+
+  std::vector<int> order;
+  for (int r = 0; r < static_cast<int>(resources_.size()); ++r) {
+    Resource &resource = resources_[r];
+    resource.fresh = false;
+    if (resource.imported || resource.first < 0) continue;
+    if (!resource.cached) {
+      order.push_back(r);
+      continue;
+    }
+    // Targets of cached passes keep their texture while its storage fits.
+    auto target = cached_targets_.find(resource.name);
+    if (target != cached_targets_.end() &&
+        (target->second.desc < resource.desc ||
+         resource.desc < target->second.desc)) {
+      DeleteTexture(target->second.texture, state);
+      cached_targets_.erase(target);
+      target = cached_targets_.end();
+    }
+    if (target == cached_targets_.end()) {
+      const CachedTarget kTarget = {
+          resource.desc,
+          CreateTexture(resource.desc, std::max(resource.unit, 0), state)};
+      target = cached_targets_.emplace(resource.name, kTarget).first;
+      resource.fresh = true;
+    }
+    resource.texture = target->second.texture;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return resources_[a].first < resources_[b].first;
+  });
+
+  // Greedy assignment in order of first use: a texture is free for a target
+  // once the last pass of its previous target has run.
+  std::map<RenderTargetDesc, std::vector<int>> busy_until;
+  for (int r : order) {
+    Resource &resource = resources_[r];
+    std::vector<GLuint> &textures = pool_[resource.desc];
+    std::vector<int> &busy = busy_until[resource.desc];
+    busy.resize(textures.size(), -1);
+
+    size_t k = 0;
+    while (k < textures.size() && busy[k] >= resource.first) ++k;
+    if (k == textures.size()) {
+      textures.push_back(
+          CreateTexture(resource.desc, std::max(resource.unit, 0), state));
+      busy.push_back(-1);
+    }
+    resource.texture = textures[k];
+    busy[k] = resource.last;
+    pool_used_[resource.desc] = frame_;
+  }
+
+  // Textures of descriptions no target has used for a while, such as the
+  // sizes left behind by a resize, are released.
+  for (auto textures = pool_.begin(); textures != pool_.end();) {
+    if (frame_ - pool_used_[textures->first] <= kPoolRetainFrames) {
+      ++textures;
+      continue;
+    }
+    for (GLuint texture : textures->second) DeleteTexture(texture, state);
+    pool_used_.erase(textures->first);
+    textures = pool_.erase(textures);
+  }
+}
+
+GLuint RenderGraph::Framebuffer(const Pass &pass, GLStateCache *state) {
+  std::vector<GLuint> attachments;
+  for (int write : pass.writes) attachments.push_back(resources_[write].texture);
+  if (pass.depth != kNoResource)
+    attachments.push_back(resources_[pass.depth].texture);
+  auto found = framebuffers_.find(attachments);
+  if (found != framebuffers_.end()) return found->second;
+
+  GLuint framebuffer;
+  glGenFramebuffers(1, &framebuffer);
+  state->BindFramebuffer(framebuffer);
+  std::vector<GLenum> draw_buffers;
+  std::vector<int> attached = pass.writes;
+  if (pass.depth != kNoResource) attached.push_back(pass.depth);
+  for (int write : attached) {
+    const Resource &kResource = resources_[write];
+    if (kResource.desc.format == GL_DEPTH_COMPONENT) {
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                             GL_TEXTURE_2D, kResource.texture, 0);
+    } else {
+      const GLenum kAttachment =
+          GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(draw_buffers.size());
+      glFramebufferTexture2D(GL_FRAMEBUFFER, kAttachment, GL_TEXTURE_2D,
+                             kResource.texture, 0);
+      draw_buffers.push_back(kAttachment);
+    }
+  }
+  if (draw_buffers.empty())
+    glDrawBuffer(GL_NONE);
+  else
+    glDrawBuffers(static_cast<GLsizei>(draw_buffers.size()),
+                  draw_buffers.data());
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    std::cerr << "Framebuffer of pass " << pass.name << " is not complete"
+              << std::endl;
+
+  framebuffers_[attachments] = framebuffer;
+  return framebuffer;
+}
+
+void RenderGraph::DeleteTexture(GLuint texture, GLStateCache *state) {
+  for (auto framebuffer = framebuffers_.begin();
+       framebuffer != framebuffers_.end();) {
+    const std::vector<GLuint> &kAttachments = framebuffer->first;
+    if (std::find(kAttachments.begin(), kAttachments.end(), texture) !=
+        kAttachments.end()) {
+      glDeleteFramebuffers(1, &framebuffer->second);
+      framebuffer = framebuffers_.erase(framebuffer);
+    } else {
+      ++framebuffer;
+    }
+  }
+  glDeleteTextures(1, &texture);
+  // Deleting reverts the bindings of the texture and its framebuffers to 0,
+  // and the names may be given to new objects.
+  state->Invalidate();
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,312 @@
+#ifndef RENDER_GRAPH_H_
+#define RENDER_GRAPH_H_
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "./gl_state_cache.h"
+
+namespace data_visualization {
+
+/**
+ * @brief kBackbuffer Resource of the default framebuffer.
+ */
+const int kBackbuffer = -1;
+
+/**
+ * @brief kNoResource Depth attachment of the passes without a shared one.
+ */
+const int kNoResource = -2;
+
+/**
+ * @brief kUncachedPass Cache key of the passes that run every frame.
+ */
+const uint64_t kUncachedPass = 0;
+
+/**
+ * @brief kHashSeed Initial value of the hashes below (FNV-1a offset basis).
+ */
+const uint64_t kHashSeed = 14695981039346656037ULL;
+
+/**
+ * @brief HashBytes Chains a block of memory into a FNV-1a hash.
+ */
+uint64_t HashBytes(const void *data, size_t size, uint64_t hash = kHashSeed);
+
+/**
+ * @brief HashValue Chains the bytes of a value into a FNV-1a hash. Structures
+ * must be zero initialized, so that their padding does not change the hash.
+ */
+template <typename T>
+uint64_t HashValue(const T &value, uint64_t hash = kHashSeed) {
+  return HashBytes(&value, sizeof(T), hash);
+}
+
+/**
+ * @brief RenderTargetDesc Storage of a transient render target, as given to
+ * glTexImage2D. Targets with equal descriptions can share a texture.
+ */
+struct RenderTargetDesc {
+  GLint internal_format;
+  GLenum format;
+  GLenum type;
+  int width;
+  int height;
+
+  bool operator<(const RenderTargetDesc &other) const;
+};
+
+/**
+ * @brief RenderGraph Frame built from passes that declare the resources they
+ * read and write. Execute only runs the passes the requested output depends
+ * on, and assigns textures to the transient targets from a pool kept across
+ * frames, so that targets whose lifetimes do not overlap share one texture.
+ * The pool is keyed by the storage of the targets, so a resize allocates new
+ * textures and the ones of the old size are released once unused.
+ *
+ * A pass can be given a cache key hashing the inputs it depends on besides
+ * the resources it reads. Its targets then keep their own textures, and the
+ * pass is skipped while its key and the results of the passes it reads from
+ * are the same as when it last ran.
+ *
+ * Every transient target is written by a single pass. Before running a pass
+ * the graph binds a framebuffer with its writes attached, color targets in
+ * order and a depth target to the depth attachment, and binds its reads to
+ * their texture units. A pass can also test against the depth written by an
+ * earlier one (AttachDepth). Programs must only sample the resources their pass
+ * reads, since other units may hold a texture the pass is writing.
+ */
+class RenderGraph {
+ public:
+  /**
+   * @brief RenderGraph Constructor of the class.
+   */
+  RenderGraph();
+
+  /**
+   * @brief Reset Removes the passes and resources of the last frame. The
+   * pooled textures and framebuffers are kept.
+   */
+  void Reset();
+
+  /**
+   * @brief CreateTarget Declares a transient render target.
+   * @param name Name of the target, for messages.
+   * @param desc Storage of the target.
+   * @param unit Texture unit the target is bound to when a pass reads it.
+   * @return The resource.
+   */
+  int CreateTarget(const std::string &name, const RenderTargetDesc &desc,
+                   int unit);
+
+  /**
+   * @brief ImportTexture Declares a texture owned outside the graph. Passes
+   * read it, and an uncached pass may also write it, e.g. to keep a history
+   * across frames; the graph neither allocates nor caches it.
+   * @param name Name of the texture, for messages.
+   * @param texture Name of the GL_TEXTURE_2D texture.
+   * @param unit Texture unit the texture is bound to when a pass reads it.
+   * @return The resource.
+   */
+  int ImportTexture(const std::string &name, GLuint texture, int unit);
+
+  /**
+   * @brief AddPass Declares a pass. Passes run in the order they are added.
+   * @param name Name of the pass, for messages.
+   * @param reads Resources sampled by the pass.
+   * @param writes Resources rendered by the pass: transient targets and
+   * imported textures, or only kBackbuffer.
+   * @param execute Issues the draw calls, with the framebuffer and the reads
+   * bound.
+   * @param key Cache key of the pass, or kUncachedPass. Passes that write
+   * kBackbuffer are never cached.
+   */
+  void AddPass(const std::string &name, const std::vector<int> &reads,
+               const std::vector<int> &writes,
+               const std::function<void()> &execute,
+               uint64_t key = kUncachedPass);
+
+  /**
+   * @brief AttachDepth Attaches a depth target written by an earlier pass to
+   * the framebuffer of the last pass added, which tests against it without
+   * writing it. The target counts as a read of the pass, but is not bound to
+   * its texture unit.
+   * @param resource The depth target.
+   */
+  void AttachDepth(int resource);
+
+  /**
+   * @brief Execute Culls the passes output does not depend on, assigns
+   * textures to the remaining targets and runs the passes.
+   * @param output The resource to produce, usually kBackbuffer.
+   * @param state The state cache of the context.
+   */
+  void Execute(int output, GLStateCache *state);
+
+  /**
+   * @brief executed Passes run by the last Execute.
+   */
+  int executed() const { return executed_; }
+
+  /**
+   * @brief cached Passes skipped by the last Execute because their results
+   * were up to date.
+   */
+  int cached() const { return cached_; }
+
+  /**
+   * @brief texture Texture assigned to a resource, for passes that write it
+   * other than through the framebuffer, e.g. as an image. Only valid while
+   * the graph executes.
+   */
+  GLuint texture(int resource) const { return resources_[resource].texture; }
+
+  /**
+   * @brief used Whether a pass run or skipped by the last Execute uses the
+   * resource, i.e. its producer was not culled.
+   */
+  bool used(int resource) const { return resources_[resource].first >= 0; }
+
+  /**
+   * @brief Release Deletes the pooled and cached textures and the
+   * framebuffers.
+   */
+  void Release();
+
+ private:
+  struct Resource {
+    std::string name;
+    RenderTargetDesc desc;
+    int unit;
+    GLuint texture;
+    bool imported;
+
+    /**
+     * @brief cached Whether the target is written by a cached pass, and keeps
+     * its own texture.
+     */
+    bool cached;
+
+    /**
+     * @brief fresh Whether its cached texture was created by this Execute.
+     */
+    bool fresh;
+
+    /**
+     * @brief version Hash of the contents, set when the producer runs or is
+     * skipped.
+     */
+    uint64_t version;
+
+    /**
+     * @brief first, last First and last live pass that uses the resource, or
+     * -1 when no live pass does.
+     */
+    int first, last;
+  };
+
+  struct Pass {
+    std::string name;
+    std::vector<int> reads;
+    std::vector<int> writes;
+    std::function<void()> execute;
+    uint64_t key;
+    bool live;
+
+    /**
+     * @brief depth Depth target shared with an earlier pass, or kNoResource.
+     */
+    int depth;
+  };
+
+  /**
+   * @brief CachedTarget Texture of a target written by a cached pass.
+   */
+  struct CachedTarget {
+    RenderTargetDesc desc;
+    GLuint texture;
+
+    /**
+     * @brief writer Name of the pass whose result the texture holds, empty
+     * until one runs. Several passes may write the same target, e.g. the
+     * SSAO pass at full resolution and the upsampling at reduced ones.
+     */
+    std::string writer;
+  };
+
+  /**
+   * @brief Cull Marks the passes that output depends on as live, walking
+   * them backwards from the last one.
+   */
+  void Cull(int output);
+
+  /**
+   * @brief Allocate Computes the lifetimes of the targets and assigns them
+   * pooled textures, creating textures when no compatible one is free, and
+   * releases the pooled descriptions that have not been used recently.
+   * Targets of cached passes get their own texture instead.
+   */
+  void Allocate(GLStateCache *state);
+
+  /**
+   * @brief Framebuffer Returns the framebuffer with the writes of the pass
+   * attached, creating it the first time this set of textures is used.
+   */
+  GLuint Framebuffer(const Pass &pass, GLStateCache *state);
+
+  /**
+   * @brief DeleteTexture Deletes a texture of the graph and the framebuffers
+   * it is attached to, and invalidates the state cache.
+   */
+  void DeleteTexture(GLuint texture, GLStateCache *state);
+
+  std::vector<Resource> resources_;
+  std::vector<Pass> passes_;
+
+  /**
+   * @brief pool_ Textures created for each target description.
+   */
+  std::map<RenderTargetDesc, std::vector<GLuint>> pool_;
+
+  /**
+   * @brief pool_used_ Last Execute that assigned a texture of each
+   * description in pool_.
+   */
+  std::map<RenderTargetDesc, uint64_t> pool_used_;
+
+  /**
+   * @brief framebuffers_ Framebuffers by their attached textures.
+   */
+  std::map<std::vector<GLuint>, GLuint> framebuffers_;
+
+  /**
+   * @brief cached_targets_ Textures of the targets of cached passes, by name.
+   */
+  std::map<std::string, CachedTarget> cached_targets_;
+
+  /**
+   * @brief results_ Key of the results last produced by each cached pass,
+   * by name, combining its own key and the versions of its reads. They are
+   * only still held while the pass is the writer of its cached targets.
+   */
+  std::map<std::string, uint64_t> results_;
+
+  /**
+   * @brief frame_ Number of Execute calls, which versions the results of the
+   * uncached passes.
+   */
+  uint64_t frame_;
+
+  int executed_;
+  int cached_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  RENDER_GRAPH_H_
@@ -0,0 +1,94 @@
+#include <render_thread.h>
+
+#include <QCoreApplication>
+
+#include <algorithm>
+
+namespace data_visualization {
+
+RenderThread::RenderThread(QGLWidget *widget, const RenderCallbacks &callbacks)
+    : widget_(widget),
+      callbacks_(callbacks),
+      stopping_(false),
+      latency_sum_(0.0),
+      latency_max_(0.0),
+      latency_frames_(0) {}
+
+void RenderThread::Start() {
+  widget_->doneCurrent();
+  widget_->context()->moveToThread(this);
+  stopping_ = false;
+  start();
+}
+
+void RenderThread::Stop() {
+  if (!isRunning()) return;
+  stopping_ = true;
+  wake_.release();
+  wait();
+}
+
+void RenderThread::Post(Change change) {
+  if (QThread::currentThread() == this) {
+    change();
+    return;
+  }
+  Entry entry = {std::move(change), Clock::now()};
+  // The queue only fills up if the thread is stuck in a long change, such as
+  // loading a model, while the user keeps interacting.
+  while (!queue_.Push(std::move(entry))) QThread::yieldCurrentThread();
+  wake_.release();
+}
+
+void RenderThread::RequestFrame() { wake_.release(); }
+
+void RenderThread::run() {
+  widget_->makeCurrent();
+  callbacks_.initialize();
+  // Changes posted while initializing are not charged with its duration.
+  const Clock::time_point kReady = Clock::now();
+
+  bool next_frame = true;
+  while (true) {
+    if (!next_frame) wake_.acquire();
+    wake_.tryAcquire(wake_.available());
+    const Clock::time_point kPosted = Apply();
+    if (stopping_) break;
+
+    next_frame = callbacks_.render();
+    widget_->swapBuffers();
+    if (kPosted != Clock::time_point::max()) {
+      const std::chrono::duration<double, std::milli> kLatency =
+          Clock::now() - std::max(kPosted, kReady);
+      ReportLatency(kLatency.count());
+    }
+  }
+
+  callbacks_.release();
+  widget_->doneCurrent();
+  widget_->context()->moveToThread(QCoreApplication::instance()->thread());
+}
+
+RenderThread::Clock::time_point RenderThread::Apply() {
+  Clock::time_point earliest = Clock::time_point::max();
+  Entry entry;
+  while (queue_.Pop(&entry)) {
+    earliest = std::min(earliest, entry.posted);
+    entry.change();
+    entry.change = nullptr;
+  }
+  return earliest;
+}
+
+void RenderThread::ReportLatency(double milliseconds) {
+  latency_sum_ += milliseconds;
+  latency_max_ = std::max(latency_max_, milliseconds);
+  if (++latency_frames_ < kLatencyFrames) return;
+  if (callbacks_.latency)
+    callbacks_.latency(latency_sum_ / latency_frames_, latency_max_);
+  latency_sum_ = 0.0;
+  latency_max_ = 0.0;
+  latency_frames_ = 0;
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,169 @@
+#ifndef RENDER_THREAD_H_
+#define RENDER_THREAD_H_
+
+#include <QGLWidget>
+#include <QSemaphore>
+#include <QThread>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+
+#include "./spsc_queue.h"
+
+namespace data_visualization {
+
+/**
+ * @brief kLatencyFrames Frames that apply changes the input latency is
+ * averaged over before it is reported.
+ */
+const int kLatencyFrames = 30;
+
+/**
+ * @brief RenderCallbacks Work the render thread runs with the context of the
+ * widget current.
+ */
+struct RenderCallbacks {
+  /**
+   * @brief initialize Called once when the thread starts.
+   */
+  std::function<void()> initialize;
+
+  /**
+   * @brief render Renders a frame into the back buffer, and returns whether
+   * the next one has to follow right away instead of waiting for changes.
+   */
+  std::function<bool()> render;
+
+  /**
+   * @brief release Called once when the thread stops.
+   */
+  std::function<void()> release;
+
+  /**
+   * @brief latency Receives the mean and maximum milliseconds, over
+   * kLatencyFrames frames, from posting a change to the return of the
+   * swapBuffers that presents it.
+   */
+  std::function<void(double, double)> latency;
+};
+
+/**
+ * @brief RenderThread Thread that owns the GL context of a widget and renders
+ * it, so that the GUI thread never waits for the driver. The GUI thread posts
+ * changes to the state the frames are built from through a lock-free queue;
+ * the render thread wakes up when there are some, applies all of them, and
+ * presents one frame, paced by the swap interval of the context. State read
+ * by the render callback must only be changed through Post or Invoke.
+ *
+ * The widget must not make its context current on the GUI thread once the
+ * thread has started, so it has to handle resize and paint events itself.
+ */
+class RenderThread : public QThread {
+ public:
+  typedef std::function<void()> Change;
+
+  /**
+   * @brief RenderThread Constructor of the class.
+   * @param widget Widget whose context is used.
+   * @param callbacks Work run by the thread.
+   */
+  RenderThread(QGLWidget *widget, const RenderCallbacks &callbacks);
+
+  /**
+   * @brief Start Moves the context of the widget to the thread and starts
+   * it. Called on the GUI thread once the widget has a native window.
+   */
+  void Start();
+
+  /**
+   * @brief Stop Applies the pending changes, releases the resources and
+   * hands the context back to the GUI thread. Returns when the thread ends.
+   */
+  void Stop();
+
+  /**
+   * @brief Post Queues a change and wakes the thread up to present a frame
+   * with it. Changes apply in the order they are posted. Called on the GUI
+   * thread; on the render thread the change is applied right away.
+   */
+  void Post(Change change);
+
+  /**
+   * @brief OffThread Whether the thread is running and the caller is another
+   * one, which has to go through Post or Invoke.
+   */
+  bool OffThread() const {
+    return isRunning() && QThread::currentThread() != this;
+  }
+
+  /**
+   * @brief Invoke Runs call on the render thread and returns its result,
+   * blocking the caller until then. Runs it directly when called on the
+   * render thread or before it has started.
+   */
+  template <typename Result>
+  Result Invoke(const std::function<Result()> &call) {
+    if (!OffThread()) return call();
+    std::promise<Result> result;
+    std::future<Result> future = result.get_future();
+    Post([&] { result.set_value(call()); });
+    return future.get();
+  }
+
+  /**
+   * @brief RequestFrame Wakes the thread up to present a frame, e.g. after
+   * the window has been exposed.
+   */
+  void RequestFrame();
+
+ protected:
+  void run() override;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Entry {
+    Change change;
+    Clock::time_point posted;
+  };
+
+  /**
+   * @brief Apply Runs the queued changes.
+   * @return Time the earliest of them was posted, or Clock::time_point::max()
+   * when there were none.
+   */
+  Clock::time_point Apply();
+
+  /**
+   * @brief ReportLatency Accumulates the latency of a presented frame that
+   * applied changes, and reports it every kLatencyFrames of them.
+   */
+  void ReportLatency(double milliseconds);
+
+  QGLWidget *widget_;
+  RenderCallbacks callbacks_;
+
+  /**
+   * @brief queue_ Changes posted by the GUI thread.
+   */
+  concurrency::SpscQueue<Entry, 256> queue_;
+
+  /**
+   * @brief wake_ Released once per Post and RequestFrame. The thread sleeps
+   * on it between frames, and takes every pending release at once so that
+   * requests arriving during a frame are served by a single next one.
+   */
+  QSemaphore wake_;
+
+  std::atomic<bool> stopping_;
+
+  double latency_sum_;
+  double latency_max_;
+  int latency_frames_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  RENDER_THREAD_H_
@@ -0,0 +1,48 @@
+#include <shader_program.h>
+
+namespace data_visualization {
+
+void GeometryUniforms::Resolve(const QOpenGLShaderProgram &program) {
+  (void)program;
+}
+
+void SsaoUniforms::Resolve(const QOpenGLShaderProgram &program) {
+  texture_ssao_albedo = program.uniformLocation("texture_ssao_albedo");
+  texture_ssao_normal = program.uniformLocation("texture_ssao_normal");
+  texture_ssao_depth = program.uniformLocation("texture_ssao_depth");
+  texture_ssao_random = program.uniformLocation("texture_ssao_random");
+  texture_ssao_ssao = program.uniformLocation("texture_ssao_ssao");
+  texture_ssao_ssao_blur = program.uniformLocation("texture_ssao_ssao_blur");
+  texture_ssao_lightning = program.uniformLocation("texture_ssao_lightning");
+  texture_ssao_reduced_normal =
+      program.uniformLocation("texture_ssao_reduced_normal");
+  texture_ssao_reduced_depth =
+      program.uniformLocation("texture_ssao_reduced_depth");
+  texture_ssao_reduced_ssao =
+      program.uniformLocation("texture_ssao_reduced_ssao");
+  texture_ssao_history = program.uniformLocation("texture_ssao_history");
+}
+
+void ShadingUniforms::Resolve(const QOpenGLShaderProgram &program) {
+  texture_color = program.uniformLocation("texture_color");
+  texture_metalness = program.uniformLocation("texture_metalness");
+  texture_roughness = program.uniformLocation("texture_roughness");
+  texture_chosen = program.uniformLocation("texture_chosen");
+  diffuse_map = program.uniformLocation("diffuse_map");
+  specular_map = program.uniformLocation("specular_map");
+  probe_volume[0] = program.uniformLocation("probe_volume_r");
+  probe_volume[1] = program.uniformLocation("probe_volume_g");
+  probe_volume[2] = program.uniformLocation("probe_volume_b");
+  distance_field = program.uniformLocation("distance_field");
+  texture_gbuffer_normal = program.uniformLocation("texture_gbuffer_normal");
+  texture_gbuffer_depth = program.uniformLocation("texture_gbuffer_depth");
+  texture_gbuffer_uv = program.uniformLocation("texture_gbuffer_uv");
+  texture_gbuffer_surface = program.uniformLocation("texture_gbuffer_surface");
+  texture_ssao_ssao_blur = program.uniformLocation("texture_ssao_ssao_blur");
+}
+
+void SkyUniforms::Resolve(const QOpenGLShaderProgram &program) {
+  skybox_map = program.uniformLocation("skybox_map_");
+}
+
+}  // namespace data_visualization
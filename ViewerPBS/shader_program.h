@@ -0,0 +1,126 @@
+#ifndef SHADER_PROGRAM_H_
+#define SHADER_PROGRAM_H_
+
+#include <GL/glew.h>
+#include <QOpenGLShaderProgram>
+
+#include <memory>
+#include <utility>
+
+#include "./gl_state_cache.h"
+#include "./uniform_blocks.h"
+
+namespace data_visualization {
+
+/**
+ * @brief GeometryUniforms Uniforms of the first SSAO step, which fills the
+ * G-buffer. It only reads the Frame block.
+ */
+struct GeometryUniforms {
+  void Resolve(const QOpenGLShaderProgram &program);
+};
+
+/**
+ * @brief SsaoUniforms Samplers of the screen space steps: the SSAO estimator,
+ * its blur and the final composite, and the downsampling and upsampling
+ * around the estimator at reduced resolution. Their parameters are in the
+ * Ssao block. Samplers that a program does not declare are -1, which
+ * glUniform* ignores.
+ */
+struct SsaoUniforms {
+  GLint texture_ssao_albedo;
+  GLint texture_ssao_normal;
+  GLint texture_ssao_depth;
+  GLint texture_ssao_random;
+  GLint texture_ssao_ssao;
+  GLint texture_ssao_ssao_blur;
+  GLint texture_ssao_lightning;
+  GLint texture_ssao_reduced_normal;
+  GLint texture_ssao_reduced_depth;
+  GLint texture_ssao_reduced_ssao;
+  GLint texture_ssao_history;
+
+  void Resolve(const QOpenGLShaderProgram &program);
+};
+
+/**
+ * @brief ShadingUniforms Samplers of the lighting programs (Phong, texture
+ * mapping, reflection and BRDF). Each of them declares a subset, and only
+ * their deferred variants read the G-buffer. The blurred SSAO target is read
+ * when they composite it themselves.
+ */
+struct ShadingUniforms {
+  GLint texture_color;
+  GLint texture_metalness;
+  GLint texture_roughness;
+  GLint texture_chosen;
+  GLint diffuse_map;
+  GLint specular_map;
+  GLint probe_volume[3];
+  GLint distance_field;
+  GLint texture_gbuffer_normal;
+  GLint texture_gbuffer_depth;
+  GLint texture_gbuffer_uv;
+  GLint texture_gbuffer_surface;
+  GLint texture_ssao_ssao_blur;
+
+  void Resolve(const QOpenGLShaderProgram &program);
+};
+
+/**
+ * @brief SkyUniforms Samplers of the skybox program.
+ */
+struct SkyUniforms {
+  GLint skybox_map;
+
+  void Resolve(const QOpenGLShaderProgram &program);
+};
+
+/**
+ * @brief ShaderProgram A linked program together with its uniform locations,
+ * resolved once when the program is set instead of looked up by name every
+ * frame, and its uniform blocks bound to the shared binding points.
+ * @tparam Uniforms Structure of locations with a Resolve(program) method.
+ */
+template <typename Uniforms>
+class ShaderProgram {
+ public:
+  /**
+   * @brief Reset Takes a linked program, replacing the previous one, resolves
+   * its uniform locations and binds its uniform blocks.
+   * @param program The linked program.
+   */
+  void Reset(std::unique_ptr<QOpenGLShaderProgram> program) {
+    program_ = std::move(program);
+    uniforms_.Resolve(*program_);
+    BindUniformBlocks(program_->programId());
+  }
+
+  /**
+   * @brief Bind Makes the program current.
+   */
+  void Bind() const { program_->bind(); }
+
+  /**
+   * @brief Bind Makes the program current through the state cache.
+   * @param state The state cache of the context.
+   */
+  void Bind(GLStateCache *state) const {
+    state->UseProgram(program_->programId());
+  }
+
+  const Uniforms &uniforms() const { return uniforms_; }
+
+  /**
+   * @brief Empty Whether no program has been set yet.
+   */
+  bool Empty() const { return program_ == nullptr; }
+
+ private:
+  std::unique_ptr<QOpenGLShaderProgram> program_;
+  Uniforms uniforms_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  SHADER_PROGRAM_H_
@@ -1,13 +1,24 @@
 #version 330 core
 layout (location = 0) out vec4 frag_lightning;
 layout (location = 1) out vec4 frag_color;
+
+#include "frame.glsl"
+#include "material.glsl"
+#include "scene.glsl"
+#include "composite.glsl"
+
+#ifdef DEFERRED
+#include "normal.glsl"
+#include "deferred.glsl"
+#else
 in vec2 TexCoords;
 in vec3 eye_vertex;
 in vec3 eye_normal;
-
-// material parameters
-uniform float metalness;
-uniform float roughness;
+in float occlusion;
+in vec3 transfer_irradiance;
+in vec3 object_vertex;
+in vec3 object_normal;
+#endif
 
 // IBL and material textures
 uniform samplerCube diffuse_map;
@@ -16,10 +27,13 @@ uniform sampler2D texture_color;
 uniform sampler2D texture_roughness;
 uniform sampler2D texture_metalness;
 
-// light
-uniform vec3 light_position;
-uniform vec3 light_color;
-uniform vec3 fresnel;
+// irradiance probes: band 0 and 1 SH coefficients of each color channel
+uniform sampler3D probe_volume_r;
+uniform sampler3D probe_volume_g;
+uniform sampler3D probe_volume_b;
+
+// signed distance field of the model in object space, negative inside
+uniform sampler3D distance_field;
 
 const float PI = 3.14159265359;
 // ----------------------------------------------------------------------------
@@ -60,11 +74,88 @@ float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness)
 // ----------------------------------------------------------------------------
 vec3 fresnelSchlick(vec3 F0, vec3 L, vec3 H)
 {
-    return F0 + (1.0 - F0) * pow(max(dot(L, H), 0.0), 5.0);
+    return F0 + (1.0 - F0) * pow(max(1.0 - dot(L, H), 0.0), 5.0);
+}
+// ----------------------------------------------------------------------------
+// Irradiance / PI from the trilinearly interpolated probes, the quantity
+// stored by the irradiance map.
+vec3 ProbeIrradiance(vec3 p, vec3 n)
+{
+    // Probes lie at the texel centers.
+    vec3 uvw = (p - probe_volume_min) / (probe_volume_max - probe_volume_min);
+    uvw = (uvw * (probe_volume_size - 1.0) + 0.5) / probe_volume_size;
+
+    // Y00 and the band 1 basis times the clamped cosine convolution (2/3).
+    vec4 basis = vec4(0.282095, 0.325735 * n.y, 0.325735 * n.z, 0.325735 * n.x);
+    vec3 irradiance = vec3(dot(texture(probe_volume_r, uvw), basis),
+                           dot(texture(probe_volume_g, uvw), basis),
+                           dot(texture(probe_volume_b, uvw), basis));
+    return max(irradiance, vec3(0.0));
+}
+// ----------------------------------------------------------------------------
+float SceneDistance(vec3 p)
+{
+    // Samples lie at the texel centers.
+    vec3 uvw = (p - distance_field_min) / (distance_field_max - distance_field_min);
+    uvw = (uvw * (distance_field_size - 1.0) + 0.5) / distance_field_size;
+    return texture(distance_field, uvw).r;
+}
+// ----------------------------------------------------------------------------
+float VoxelSize()
+{
+    return (distance_field_max.x - distance_field_min.x) / (distance_field_size.x - 1.0);
+}
+// ----------------------------------------------------------------------------
+// Ambient occlusion from a few samples along the normal: a sample closer to
+// the geometry than to p is occluded, the nearest ones weigh the most.
+float DistanceFieldOcclusion(vec3 p, vec3 n)
+{
+    float spacing = 0.75 * VoxelSize();
+    float occlusion = 0.0;
+    float weight = 1.0;
+    float total = 0.0;
+    for (int i = 1; i <= 5; ++i)
+    {
+        float t = spacing * float(i);
+        occlusion += weight * max(t - SceneDistance(p + n * t), 0.0) / t;
+        total += weight;
+        weight *= 0.5;
+    }
+    return clamp(1.0 - occlusion / total, 0.0, 1.0);
+}
+// ----------------------------------------------------------------------------
+// Soft shadow cone traced towards the light: the narrowest opening seen from
+// p, relative to the distance travelled, gives the penumbra.
+float DistanceFieldShadow(vec3 p, vec3 n, vec3 light)
+{
+    const float kPenumbra = 8.0;
+    float voxel = VoxelSize();
+    vec3 origin = p + n * voxel;
+    vec3 to_light = light - origin;
+    float max_t = length(to_light);
+    vec3 d = to_light / max_t;
+
+    float visibility = 1.0;
+    float t = voxel;
+    for (int i = 0; i < 64 && t < max_t; ++i)
+    {
+        vec3 q = origin + d * t;
+        if (any(lessThan(q, distance_field_min)) || any(greaterThan(q, distance_field_max)))
+            break;
+        float h = SceneDistance(q);
+        visibility = min(visibility, kPenumbra * h / t);
+        if (visibility <= 0.0)
+            break;
+        t += max(h, 0.5 * voxel);
+    }
+    return clamp(visibility, 0.0, 1.0);
 }
 // ----------------------------------------------------------------------------
 void main()
-{    
+{
+#ifdef DEFERRED
+    ReadGBuffer();
+#endif
     float metalness_t = texture(texture_roughness, TexCoords).r;
     float roughness_t = texture(texture_metalness, TexCoords).r;
 
@@ -111,6 +202,8 @@ void main()
     //kD = kD * (1.0 - metalness_t);
 
     Lo += (kD * f_diff / PI + f_spec) * radiance;
+    if (composite_mode == 2)
+        Lo *= DistanceFieldShadow(object_vertex, normalize(object_normal), light_object_position);
     /************************************/
 
 
@@ -120,7 +213,13 @@ void main()
     kD = 1.0 - kS;
     kD = kD * (1.0 - metalness);
     //kD = kD * (1.0 - metalness_t);
-    vec3 diffuse_irradiance = texture(diffuse_map, N).rgb;
+    // The irradiance map, the baked transfer and the probes are all looked up
+    // with the object space normal, in the frame of the skybox.
+    vec3 diffuse_irradiance = texture(diffuse_map, normalize(object_normal)).rgb;
+    if (diffuse_mode == 1)
+        diffuse_irradiance = transfer_irradiance;
+    else if (diffuse_mode == 2)
+        diffuse_irradiance = ProbeIrradiance(object_vertex, normalize(object_normal));
     vec3 diffuse = diffuse_irradiance * texture(texture_color, TexCoords).rgb;
     vec3 specular_irradiance = texture(specular_map, N).rgb;
     vec3 specular = specular_irradiance * texture(texture_color, TexCoords).rgb;
@@ -136,4 +235,13 @@ void main()
     frag_color = vec4(color , 1.0);
 
     frag_lightning = vec4(1.f,1.f,1.f, 1.0);
+
+    // Same composite as the last step_four mode, with the baked term or the
+    // blurred screen space one.
+    if (composite_mode == 1)
+        frag_lightning = frag_color * frag_lightning * vec4(vec3(occlusion), 1.0);
+    else if (composite_mode == 2)
+        frag_lightning = frag_color * vec4(vec3(DistanceFieldOcclusion(object_vertex, normalize(object_normal))), 1.0);
+    else if (composite_mode == 3)
+        frag_lightning = frag_color * vec4(vec3(ScreenSpaceOcclusion()), 1.0);
 }
@@ -3,22 +3,39 @@
 layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texture_coords;
+layout (location = 3) in float ambient_occlusion;
+layout (location = 4) in vec3 radiance_transfer_0;
+layout (location = 5) in vec3 radiance_transfer_1;
+layout (location = 6) in vec3 radiance_transfer_2;
+layout (location = 7) in float splat_radius;
 
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
-uniform mat3 normal_matrix;
+#include "frame.glsl"
+
+// Tested with GL_EQUAL against the depth of the G-buffer pass.
+invariant gl_Position;
+#include "scene.glsl"
 
 smooth out vec3 eye_normal;
 smooth out vec3 eye_vertex;
+smooth out float occlusion;
+smooth out vec3 transfer_irradiance;
+smooth out vec3 object_vertex;
+smooth out vec3 object_normal;
 out vec2 TexCoords;
 
 void main(void)  {
   TexCoords = vec2(texture_coords.x,texture_coords.y);
   vec4 view_vertex = view * model * vec4(vertex, 1);
   eye_vertex = view_vertex.xyz;
+  occlusion = ambient_occlusion;
+  object_vertex = vertex;
+  object_normal = normal;
+
+  transfer_irradiance = TransferIrradiance(
+      radiance_transfer_0, radiance_transfer_1, radiance_transfer_2);
   eye_normal = normalize(normal_matrix * normal);
 
   gl_Position = projection * view_vertex;
+  gl_PointSize = point_scale * splat_radius / gl_Position.w;
 }
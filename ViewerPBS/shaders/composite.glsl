@@ -0,0 +1,9 @@
+// Blurred screen space ambient occlusion of the pixel, which the lighting
+// programs composite themselves when composite_mode is 3. Needs frame.glsl.
+uniform sampler2D texture_ssao_ssao_blur;
+
+float ScreenSpaceOcclusion() {
+  // The viewport only covers the bottom left corner of larger targets.
+  vec2 coords = gl_FragCoord.xy / viewport_size * target_scale;
+  return texture(texture_ssao_ssao_blur, coords).r;
+}
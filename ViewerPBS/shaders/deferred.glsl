@@ -0,0 +1,42 @@
+// Inputs of the lighting programs built with DEFERRED, which run as full
+// screen passes (deferred.vert): instead of being interpolated from the
+// vertices of the model, ReadGBuffer reads them from the G-buffer at the start
+// of main. Needs frame.glsl and normal.glsl.
+in vec2 GBufferCoords;
+flat in mat4 clip_to_eye;
+flat in mat4 eye_to_object;
+flat in mat3 eye_to_object_normal;
+
+uniform sampler2D texture_gbuffer_normal;
+uniform sampler2D texture_gbuffer_depth;
+uniform sampler2D texture_gbuffer_uv;
+uniform sampler2D texture_gbuffer_surface;
+
+vec2 TexCoords;
+vec3 eye_vertex;
+vec3 eye_normal;
+float occlusion;
+vec3 transfer_irradiance;
+vec3 object_vertex;
+vec3 object_normal;
+
+void ReadGBuffer()
+{
+    // Pixels without geometry keep the cleared depth.
+    float depth = texture(texture_gbuffer_depth, GBufferCoords).r;
+    if (depth == 1.0)
+        discard;
+    gl_FragDepth = depth;
+
+    vec4 clip = vec4(gl_FragCoord.xy / viewport_size * 2.0 - 1.0,
+                     depth * 2.0 - 1.0, 1.0);
+    vec4 eye = clip_to_eye * clip;
+    eye_vertex = eye.xyz / eye.w;
+    eye_normal = DecodeNormal(texture(texture_gbuffer_normal, GBufferCoords).rg);
+    TexCoords = texture(texture_gbuffer_uv, GBufferCoords).rg;
+    vec4 surface = texture(texture_gbuffer_surface, GBufferCoords);
+    transfer_irradiance = surface.rgb;
+    occlusion = surface.a;
+    object_vertex = (eye_to_object * vec4(eye_vertex, 1.0)).xyz;
+    object_normal = eye_to_object_normal * eye_normal;
+}
@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec2 vertex;
+layout (location = 2) in vec2 texture_coords;
+
+#include "frame.glsl"
+
+out vec2 GBufferCoords;
+// Transforms of the positions and normals read from the G-buffer, the same
+// for every pixel.
+flat out mat4 clip_to_eye;
+flat out mat4 eye_to_object;
+flat out mat3 eye_to_object_normal;
+
+void main()
+{
+    // The viewport only covers the bottom left corner of larger targets.
+    GBufferCoords = texture_coords * target_scale;
+    clip_to_eye = inverse(projection);
+    eye_to_object = inverse(view * model);
+    eye_to_object_normal = transpose(mat3(view * model));
+    gl_Position = vec4(vertex.x, vertex.y, 0.0, 1.0);
+}
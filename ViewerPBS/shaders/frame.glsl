@@ -0,0 +1,26 @@
+// Transforms and state shared by all the passes of a frame (FrameBlock).
+layout (std140) uniform Frame {
+  mat4 projection;
+  mat4 view;
+  mat4 inverse_view;
+  mat4 model;
+  mat3 normal_matrix;
+  // light position in eye space
+  vec3 light_position;
+  // converts splat radii to point sizes, for point clouds
+  float point_scale;
+  // 1 when compositing with the baked ambient occlusion, 2 when tracing the
+  // distance field for ambient occlusion and soft shadows, 3 when compositing
+  // with the blurred screen space ambient occlusion
+  int composite_mode;
+  // 1 when the diffuse lighting comes from the baked radiance transfer, 2 when
+  // it comes from the irradiance probe volume
+  int diffuse_mode;
+  // clipping planes of the projection
+  float z_near;
+  float z_far;
+  // size of the viewport in pixels
+  vec2 viewport_size;
+  // fraction of the off-screen targets covered by the viewport
+  vec2 target_scale;
+};
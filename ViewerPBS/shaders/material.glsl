@@ -0,0 +1,10 @@
+// Phong and BRDF material parameters (MaterialBlock).
+layout (std140) uniform Material {
+  vec3 material_ambient;
+  float metalness;
+  vec3 material_diffuse;
+  float roughness;
+  vec3 material_specular;
+  float material_shininess;
+  vec3 fresnel;
+};
@@ -0,0 +1,21 @@
+// Octahedral encoding of unit normals into the two channels of the RG16
+// normal target, mapped to [0, 1].
+vec2 OctahedronWrap(vec2 v) {
+  return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0,
+                                  v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 EncodeNormal(vec3 n) {
+  n /= abs(n.x) + abs(n.y) + abs(n.z);
+  vec2 e = n.z >= 0.0 ? n.xy : OctahedronWrap(n.xy);
+  return e * 0.5 + 0.5;
+}
+
+vec3 DecodeNormal(vec2 e) {
+  e = e * 2.0 - 1.0;
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
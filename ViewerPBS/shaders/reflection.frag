@@ -1,18 +1,36 @@
 #version 330
 
+uniform samplerCube texture_chosen;
+
+#include "frame.glsl"
+#include "composite.glsl"
+
+#ifdef DEFERRED
+#include "normal.glsl"
+#include "deferred.glsl"
+#else
 smooth in vec3 eye_normal;
 smooth in vec3 eye_vertex;
-
-uniform samplerCube texture_chosen;
-uniform mat4 inverse_view;
+smooth in float occlusion;
+#endif
 
 layout (location = 0) out vec4 frag_lightning;
 layout (location = 1) out vec4 frag_color;
 
 void main (void) {
+#ifdef DEFERRED
+    ReadGBuffer();
+#endif
     vec3 V = eye_vertex;
     vec3 N = normalize(eye_normal);
     vec3 R_V = vec3(inverse_view * vec4(reflect(V, N),1.0));
     frag_color = vec4(texture(texture_chosen, R_V).rgb, 1.0);
     frag_lightning = vec4(1.f,1.f,1.f,1.f);
+
+    // Same composite as the last step_four mode, with the baked term or the
+    // blurred screen space one.
+    if (composite_mode == 1)
+        frag_lightning = frag_color * frag_lightning * vec4(vec3(occlusion), 1.0);
+    else if (composite_mode == 3)
+        frag_lightning = frag_color * frag_lightning * vec4(vec3(ScreenSpaceOcclusion()), 1.0);
 }
@@ -2,19 +2,24 @@
 
 layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec3 normal;
+layout (location = 3) in float ambient_occlusion;
+layout (location = 7) in float splat_radius;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
-uniform mat3 normal_matrix;
+#include "frame.glsl"
+
+// Tested with GL_EQUAL against the depth of the G-buffer pass.
+invariant gl_Position;
 
 smooth out vec3 eye_normal;
 smooth out vec3 eye_vertex;
+smooth out float occlusion;
 
 void main(void)  {
   vec4 view_vertex = view * model * vec4(vertex, 1);
   eye_vertex = view_vertex.xyz;
+  occlusion = ambient_occlusion;
   eye_normal = normalize(normal_matrix * normal);
 
   gl_Position = projection * view_vertex;
+  gl_PointSize = point_scale * splat_radius / gl_Position.w;
 }
@@ -0,0 +1,28 @@
+// Data that only changes with the model or the environment (SceneBlock).
+layout (std140) uniform Scene {
+  // spherical harmonics projection of the environment
+  vec3 environment_sh[9];
+  // irradiance probes: band 0 and 1 SH coefficients of each color channel
+  vec3 probe_volume_size;
+  vec3 probe_volume_min;
+  vec3 probe_volume_max;
+  // signed distance field of the model in object space, negative inside
+  vec3 distance_field_size;
+  vec3 distance_field_min;
+  vec3 distance_field_max;
+  // light position in object space, where the distance field is traced
+  vec3 light_object_position;
+  vec3 light_color;
+};
+
+// Shadowed irradiance / PI of the baked radiance transfer, the quantity stored
+// by the irradiance map.
+vec3 TransferIrradiance(vec3 transfer_0, vec3 transfer_1, vec3 transfer_2) {
+  vec3 irradiance =
+      environment_sh[0] * transfer_0.x + environment_sh[1] * transfer_0.y +
+      environment_sh[2] * transfer_0.z + environment_sh[3] * transfer_1.x +
+      environment_sh[4] * transfer_1.y + environment_sh[5] * transfer_1.z +
+      environment_sh[6] * transfer_2.x + environment_sh[7] * transfer_2.y +
+      environment_sh[8] * transfer_2.z;
+  return max(irradiance, vec3(0.0)) / 3.14159265359;
+}
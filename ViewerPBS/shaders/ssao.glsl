@@ -0,0 +1,22 @@
+// SSAO kernel and parameters (SsaoBlock).
+layout (std140) uniform Ssao {
+  vec2 ssao_samples[64];
+  int ssao_n_samples;
+  float ssao_radius;
+  float ssao_sigma; //intensity_scale
+  float ssao_k; //contrast
+  float ssao_beta; //bias_distance
+  float ssao_epsilon;
+  int ssao_render_mode;
+  // 1, 2 or 4 full resolution pixels per side of the pixels of the estimator
+  int ssao_resolution;
+  // current to previous clip space, kernel rotation in turns and weight of
+  // the new estimate, in the temporal mode
+  mat4 ssao_reprojection;
+  float ssao_rotation;
+  float ssao_blend;
+  // taps on each side of the separable blur and their spatial weights, for
+  // the offsets 0 to ssao_blur_radius (step_three)
+  int ssao_blur_radius;
+  float ssao_blur_weights[9];
+};
@@ -0,0 +1,16 @@
+// Weight of a tap of the separable SSAO blur: the precomputed spatial weight
+// of its offset (SsaoBlock), a Gaussian of the obscurance difference, and a
+// depth weight that falls linearly to zero at a relative eye space depth
+// difference of kBlurDepthTolerance, so that obscurance does not leak across
+// edges. Shared by step_three.frag and ssao_blur.comp.
+const float kBlurRangeSigma = 0.12;
+const float kBlurDepthTolerance = 0.05;
+
+float BlurWeight(int offset, float difference, float z_eye,
+                 float center_z_eye) {
+  return ssao_blur_weights[offset] *
+         exp(-difference * difference /
+             (2.0 * kBlurRangeSigma * kBlurRangeSigma)) *
+         max(1.0 - abs(z_eye - center_z_eye) /
+                   (center_z_eye * kBlurDepthTolerance), 0.0);
+}
@@ -0,0 +1,35 @@
+#version 330 core
+layout (location = 0) out vec2 frag_normal;
+
+in vec2 TexCoords;
+in vec2 Vertex;
+
+uniform sampler2D texture_ssao_normal;
+uniform sampler2D texture_ssao_depth;
+
+#include "ssao.glsl"
+
+void main()
+{
+    // Each reduced pixel keeps the closest of the full resolution pixels it
+    // covers, so that silhouettes are not averaged with the background.
+    // Pixels without geometry keep the cleared depth and normal.
+    ivec2 first = ivec2(gl_FragCoord.xy) * ssao_resolution;
+    ivec2 closest = first;
+    float depth = 1.0;
+    for (int y = 0; y < ssao_resolution; ++y) {
+        for (int x = 0; x < ssao_resolution; ++x) {
+            ivec2 texel = first + ivec2(x, y);
+            float texel_depth = texelFetch(texture_ssao_depth, texel, 0).r;
+            if (texel_depth < depth) {
+                depth = texel_depth;
+                closest = texel;
+            }
+        }
+    }
+
+    if (depth >= 1.0)
+        discard;
+    frag_normal = texelFetch(texture_ssao_normal, closest, 0).rg;
+    gl_FragDepth = depth;
+}
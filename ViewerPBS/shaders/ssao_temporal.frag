@@ -0,0 +1,50 @@
+#version 330 core
+layout (location = 0) out vec2 frag_history;
+
+in vec2 TexCoords;
+in vec2 Vertex;
+
+uniform sampler2D texture_ssao_depth;
+uniform sampler2D texture_ssao_ssao;
+uniform sampler2D texture_ssao_history;
+
+#include "frame.glsl"
+#include "ssao.glsl"
+
+// Relative difference between the reprojected eye space depth and the one
+// stored in the history above which the history is rejected as disoccluded.
+const float kDisocclusionTolerance = 0.02;
+
+float EyeDepth(float depth)
+{
+    float z_ndc = 2.0 * depth - 1.0;
+    return 2.0 * z_near * z_far / (z_far + z_near - z_ndc * (z_far - z_near));
+}
+
+void main()
+{
+    // The history holds the accumulated obscurance and the eye space depth
+    // it belongs to.
+    float depth = texture(texture_ssao_depth, TexCoords).r;
+    float obscurance = texture(texture_ssao_ssao, TexCoords).r;
+    if (depth >= 1.0) {
+        frag_history = vec2(1.0, z_far);
+        return;
+    }
+
+    vec4 previous = ssao_reprojection * vec4(Vertex * 2.0 - 1.0,
+                                             depth * 2.0 - 1.0, 1.0);
+    previous /= previous.w;
+    vec2 previous_vertex = previous.xy * 0.5 + 0.5;
+    bool inside = all(greaterThanEqual(previous_vertex, vec2(0.0))) &&
+                  all(lessThanEqual(previous_vertex, vec2(1.0)));
+
+    if (ssao_blend < 1.0 && inside) {
+        vec2 history = texture(texture_ssao_history,
+                               previous_vertex * target_scale).rg;
+        float expected = EyeDepth(previous.z * 0.5 + 0.5);
+        if (abs(history.g - expected) < kDisocclusionTolerance * expected)
+            obscurance = mix(history.r, obscurance, ssao_blend);
+    }
+    frag_history = vec2(obscurance, EyeDepth(depth));
+}
@@ -0,0 +1,77 @@
+#version 330 core
+out vec4 frag_color;
+
+in vec2 TexCoords;
+in vec2 Vertex;
+
+uniform sampler2D texture_ssao_normal;
+uniform sampler2D texture_ssao_depth;
+uniform sampler2D texture_ssao_reduced_normal;
+uniform sampler2D texture_ssao_reduced_depth;
+uniform sampler2D texture_ssao_reduced_ssao;
+
+#include "frame.glsl"
+#include "normal.glsl"
+#include "ssao.glsl"
+
+// Relative difference of eye space depth that lowers the weight of a reduced
+// pixel by e, and exponent of the cosine between the normals.
+const float kDepthTolerance = 0.02;
+const float kNormalPower = 8.0;
+
+float EyeDepth(float depth)
+{
+    float z_ndc = 2.0 * depth - 1.0;
+    return 2.0 * z_near * z_far / (z_far + z_near - z_ndc * (z_far - z_near));
+}
+
+void main()
+{
+    float depth = texture(texture_ssao_depth, TexCoords).r;
+    // Pixels without geometry are not occluded, as in step_two.
+    if (depth >= 1.0) {
+        frag_color = vec4(1.0);
+        return;
+    }
+    float z_eye = EyeDepth(depth);
+    vec3 normal = DecodeNormal(texture(texture_ssao_normal, TexCoords).rg);
+
+    // Joint bilateral upsampling: the bilinear weights of the four closest
+    // reduced pixels are scaled by how well their depth and normal match the
+    // full resolution pixel, so that obscurance does not leak across edges.
+    vec2 position = gl_FragCoord.xy / float(ssao_resolution) - 0.5;
+    ivec2 first = ivec2(floor(position));
+    vec2 f = position - vec2(first);
+    ivec2 last = textureSize(texture_ssao_reduced_ssao, 0) - 1;
+
+    float obscurance_sum = 0.0;
+    float weight_sum = 0.0;
+    // Fallback when no reduced pixel matches: the closest one in depth.
+    float nearest_obscurance = 1.0;
+    float nearest_difference = 1e30;
+    for (int i = 0; i < 4; ++i) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 texel = clamp(first + offset, ivec2(0), last);
+        float obscurance = texelFetch(texture_ssao_reduced_ssao, texel, 0).r;
+        float texel_z = EyeDepth(
+            texelFetch(texture_ssao_reduced_depth, texel, 0).r);
+        vec3 texel_normal = DecodeNormal(
+            texelFetch(texture_ssao_reduced_normal, texel, 0).rg);
+
+        float difference = abs(texel_z - z_eye) / z_eye;
+        vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+        float weight = bilinear.x * bilinear.y *
+            exp(-difference / kDepthTolerance) *
+            pow(max(dot(texel_normal, normal), 0.0), kNormalPower);
+        obscurance_sum += weight * obscurance;
+        weight_sum += weight;
+        if (difference < nearest_difference) {
+            nearest_difference = difference;
+            nearest_obscurance = obscurance;
+        }
+    }
+
+    float result = weight_sum > 1e-4 ? obscurance_sum / weight_sum
+                                     : nearest_obscurance;
+    frag_color = vec4(result, result, result, 1.0);
+}
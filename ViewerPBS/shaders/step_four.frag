@@ -10,13 +10,15 @@ uniform sampler2D texture_ssao_depth;
 uniform sampler2D texture_ssao_ssao;
 uniform sampler2D texture_ssao_ssao_blur;
 uniform sampler2D texture_ssao_lightning;
-uniform int ssao_render_mode;
+
+#include "normal.glsl"
+#include "ssao.glsl"
 
 void main()
 {
 
     vec3 col = texture(texture_ssao_albedo, TexCoords).rgb;
-    vec3 normal = texture(texture_ssao_normal, TexCoords).rgb;
+    vec3 normal = DecodeNormal(texture(texture_ssao_normal, TexCoords).rg);
     float depth = texture(texture_ssao_depth, TexCoords).r;
     float ssao = texture(texture_ssao_ssao, TexCoords).r;
     float ssao_blur = texture(texture_ssao_ssao_blur, TexCoords).r;
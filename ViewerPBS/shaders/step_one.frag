@@ -3,17 +3,22 @@
 smooth in vec3 eye_normal;
 smooth in vec3 eye_vertex;
 
-uniform vec3 light_position;
-uniform vec3 material_ambient;
-uniform vec3 material_diffuse;
-uniform vec3 material_specular;
-uniform float material_shininess;
-
 vec3 light_color = vec3(1,1,1);
 
 //layout (location = 0) out vec4 frag_color;
 layout (location = 0) out vec4 frag_normal;
 
+#ifdef DEFERRED
+in vec2 TexCoords;
+smooth in float occlusion;
+smooth in vec3 transfer_irradiance;
+
+layout (location = 1) out vec4 frag_uv;
+layout (location = 2) out vec4 frag_surface;
+#endif
+
+#include "normal.glsl"
+
 void main (void) {
  vec3 N = normalize(eye_normal);
 
@@ -22,5 +27,9 @@ void main (void) {
  // write Total Color:
  //frag_color = vec4(albedo, 1.0);
 
- frag_normal = vec4(N, 1.0);
+ frag_normal = vec4(EncodeNormal(N), 0.0, 1.0);
+#ifdef DEFERRED
+ frag_uv = vec4(TexCoords, 0.0, 1.0);
+ frag_surface = vec4(transfer_irradiance, occlusion);
+#endif
 }
@@ -2,11 +2,28 @@
 
 layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec3 normal;
+layout (location = 7) in float splat_radius;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
-uniform mat3 normal_matrix;
+#include "frame.glsl"
+
+// The lighting pass tests against this depth with GL_EQUAL, so the lighting
+// programs must compute bit-identical positions.
+invariant gl_Position;
+
+// The deferred G-buffer also holds what the lighting programs read from the
+// vertices.
+#ifdef DEFERRED
+layout (location = 2) in vec2 texture_coords;
+layout (location = 3) in float ambient_occlusion;
+layout (location = 4) in vec3 radiance_transfer_0;
+layout (location = 5) in vec3 radiance_transfer_1;
+layout (location = 6) in vec3 radiance_transfer_2;
+
+#include "scene.glsl"
+
+smooth out float occlusion;
+smooth out vec3 transfer_irradiance;
+#endif
 
 smooth out vec3 eye_normal;
 smooth out vec3 eye_vertex;
@@ -16,6 +33,13 @@ void main(void)  {
   vec4 view_vertex = view * model * vec4(vertex, 1);
   eye_vertex = view_vertex.xyz;
   eye_normal = normalize(normal_matrix * normal);
+#ifdef DEFERRED
+  TexCoords = texture_coords;
+  occlusion = ambient_occlusion;
+  transfer_irradiance = TransferIrradiance(
+      radiance_transfer_0, radiance_transfer_1, radiance_transfer_2);
+#endif
 
   gl_Position = projection * view_vertex;
+  gl_PointSize = point_scale * splat_radius / gl_Position.w;
 }
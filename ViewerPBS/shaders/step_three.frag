@@ -4,61 +4,50 @@ out vec4 frag_color;
 in vec2 TexCoords;
 in vec2 Vertex;
 
-uniform sampler2D texture_ssao_albedo;
-uniform sampler2D texture_ssao_normal;
+// One pass of a separable bilateral filter: the horizontal one, or the
+// vertical one when VERTICAL is defined. texture_ssao_ssao is the obscurance
+// in the first pass and the output of the first pass in the second.
 uniform sampler2D texture_ssao_depth;
 uniform sampler2D texture_ssao_ssao;
-uniform int ssao_render_mode;
 
-float twopi = 6.28318384f;
+#include "frame.glsl"
+#include "ssao.glsl"
+#include "ssao_blur.glsl"
 
-float distance(float x, float y, float i, float j) {
-    return float(sqrt(pow(x - i, 2) + pow(y - j, 2)));
-}
+#ifdef VERTICAL
+const ivec2 kDirection = ivec2(0, 1);
+#else
+const ivec2 kDirection = ivec2(1, 0);
+#endif
 
-float gaussian(float x, float sigma) {
-    return exp(-(pow(x, 2))/(2 * pow(sigma, 2))) / (2 * twopi * pow(sigma, 2));
+float EyeDepth(float depth)
+{
+    float z_ndc = 2.0 * depth - 1.0;
+    return 2.0 * z_near * z_far / (z_far + z_near - z_ndc * (z_far - z_near));
 }
 
 void main()
 {
-    int diameter = 7;
-    float iFiltered = 0;
-    float wP = 0;
-    float neighbor_x = 0;
-    float neighbor_y = 0;
-    int halfF = diameter / 2;
-    vec2 texelSize = 1.0 / vec2(textureSize(texture_ssao_ssao, 0));
-
-    for(int i = 0; i < diameter; i++) {
-        for(int j = 0; j < diameter; j++) {
-            neighbor_x = TexCoords.x - (halfF - i)*texelSize.x;
-            neighbor_y = TexCoords.y - (halfF - j)*texelSize.y;
-            float gi = gaussian(texture(texture_ssao_ssao, vec2(neighbor_x,neighbor_y)).r - texture(texture_ssao_ssao, TexCoords).r, 0.12f);
-            float gs = gaussian(distance(TexCoords.x, TexCoords.y, neighbor_x, neighbor_y), 16.f);
-            float w = gi * gs;
-            iFiltered = iFiltered + texture(texture_ssao_ssao, vec2(neighbor_x,neighbor_y)).r * w;
-            wP = wP + w;
-        }
-    }
-    iFiltered = iFiltered / wP;
-    frag_color = vec4(iFiltered,iFiltered,iFiltered, 1.0);
-
-
-
-    /*vec2 texelSize = 1.0 / vec2(textureSize(texture_ssao_ssao, 0));
-    float result = 0.0;
-    for (int x = -2; x < 2; ++x)
-    {
-        for (int y = -2; y < 2; ++y)
-        {
-            vec2 offset = vec2(float(x), float(y)) * texelSize;
-            result += texture(texture_ssao_ssao, TexCoords + offset).r;
+    // The center is fetched once, and the taps are clamped to the viewport.
+    ivec2 center = ivec2(gl_FragCoord.xy);
+    ivec2 last = ivec2(ceil(viewport_size)) - 1;
+    float obscurance = texelFetch(texture_ssao_ssao, center, 0).r;
+    float z_eye = EyeDepth(texelFetch(texture_ssao_depth, center, 0).r);
+
+    float obscurance_sum = ssao_blur_weights[0] * obscurance;
+    float weight_sum = ssao_blur_weights[0];
+    for (int i = 1; i <= ssao_blur_radius; ++i) {
+        for (int side = -1; side <= 1; side += 2) {
+            ivec2 texel = clamp(center + side * i * kDirection, ivec2(0), last);
+            float neighbor = texelFetch(texture_ssao_ssao, texel, 0).r;
+            float neighbor_z = EyeDepth(texelFetch(texture_ssao_depth, texel, 0).r);
+
+            float weight = BlurWeight(i, neighbor - obscurance, neighbor_z, z_eye);
+            obscurance_sum += weight * neighbor;
+            weight_sum += weight;
         }
     }
-    result = result / (4.0 * 4.0);
-
-
-    frag_color = vec4(result,result,result, 1.0);*/
 
+    float result = obscurance_sum / weight_sum;
+    frag_color = vec4(result, result, result, 1.0);
 }
@@ -7,33 +7,29 @@ in vec2 Vertex;
 uniform sampler2D texture_ssao_normal;
 uniform sampler2D texture_ssao_depth;
 uniform sampler2D texture_ssao_random;
-uniform vec2 ssao_samples[64];
 
-uniform int ssao_n_samples;
-uniform float ssao_radius;
-uniform float ssao_sigma; //intensity_scale
-uniform float ssao_k; //contrast
-uniform float ssao_beta; //bias_distance
-uniform float ssao_epsilon;
-uniform int ssao_render_mode;
+#include "frame.glsl"
+#include "normal.glsl"
+#include "ssao.glsl"
 
 float twopi = 6.28318384f;
 
 void main()
 {
-    float n = 0.3f; // prob is variable
-    float f = 2; // prob is variable
-    float height = 600;
-    float width = 600;
+    float n = z_near;
+    float f = z_far;
 
-    vec3 normal = texture(texture_ssao_normal, TexCoords).rgb;
     float depth = texture(texture_ssao_depth, TexCoords).r;
-    float random = texture(texture_ssao_random, TexCoords).r;
+    // Pixels without geometry keep the cleared depth and get no normal.
+    vec3 normal = depth < 1.0
+        ? DecodeNormal(texture(texture_ssao_normal, TexCoords).rg)
+        : vec3(0.0);
+    // The temporal mode turns the kernel a bit further every frame.
+    float random = texture(texture_ssao_random, Vertex).r + ssao_rotation;
 
 
     float z_ndc = 2.0 * depth - 1.0;
     float z_eye = 2.0 * n * f / (f + n - z_ndc * (f - n));
-    float z_near = n;
 
     //AB=z_near; DE=z_eye; BCx=ssao_sample_x; EFx=BCx*DE/AB
     //AB=z_near; DE=z_eye; BCy=ssao_sample_ y; EFy=BCy*DE/AB
@@ -48,14 +44,14 @@ void main()
         /*float ssao_sample_x  = ssao_samples[i].x * ssao_radius;
         float ssao_sample_y  = ssao_samples[i].y * ssao_radius;*/
 
-        float EFx = ssao_sample_x * z_eye / z_near;
-        float EFy = ssao_sample_y * z_eye / z_near;
+        float EFx = ssao_sample_x * z_eye / n;
+        float EFy = ssao_sample_y * z_eye / n;
 
         float Fx = Vertex.x + EFx;
         float Fy = Vertex.y + EFy;
         if(Fx > 1.f || Fx < 0.f || Fy > 1.f || Fy < 0.f)
             continue;
-        float depth_2 = texture(texture_ssao_depth, vec2(Fx,Fy)).r;
+        float depth_2 = texture(texture_ssao_depth, vec2(Fx,Fy) * target_scale).r;
         float Fz = 2.0 * depth_2 - 1.0;
         Fz = 2.0 * n * f / (f + n - Fz * (f - n));
 
@@ -5,9 +5,12 @@ layout (location = 2) in vec2 texture_coords;
 out vec2 TexCoords;
 out vec2 Vertex;
 
+#include "frame.glsl"
+
 void main()
 {
-    TexCoords = texture_coords;
+    // The viewport only covers the bottom left corner of larger targets.
+    TexCoords = texture_coords * target_scale;
     Vertex = vertex/2.f+0.5f;
     gl_Position = vec4(vertex.x, vertex.y, 0.0, 1.0);
 }
@@ -1,14 +1,19 @@
 #version 330
 
+#include "frame.glsl"
+#include "material.glsl"
+#include "composite.glsl"
+
+#ifdef DEFERRED
+#include "normal.glsl"
+#include "deferred.glsl"
+#else
 in vec2 TexCoords;
 smooth in vec3 eye_normal;
 smooth in vec3 eye_vertex;
+smooth in float occlusion;
+#endif
 
-uniform vec3 light_position;
-uniform vec3 material_ambient;
-uniform vec3 material_diffuse;
-uniform vec3 material_specular;
-uniform float material_shininess;
 uniform sampler2D texture_color;
 uniform sampler2D texture_roughness;
 
@@ -18,6 +23,9 @@ layout (location = 0) out vec4 frag_lightning;
 layout (location = 1) out vec4 frag_color;
 
 void main (void) {
+#ifdef DEFERRED
+ ReadGBuffer();
+#endif
  // Light vector
  vec3 L = normalize(light_position-eye_vertex);
  // Normal vector
@@ -44,4 +52,12 @@ void main (void) {
  // Write Total Color:
  frag_lightning = vec4(Iamb + Idiff + Ispec , 1.0);
  frag_color = texture(texture_color, TexCoords);
+
+ // Same composite as the last step_four mode, with the baked term or the
+ // blurred screen space one.
+ if (composite_mode == 1)
+  frag_lightning = frag_color * frag_lightning * vec4(vec3(occlusion), 1.0);
+ else if (composite_mode == 3)
+  frag_lightning = frag_color * frag_lightning *
+                   vec4(vec3(ScreenSpaceOcclusion()), 1.0);
 }
@@ -0,0 +1,334 @@
+#ifndef SIMD_H_
+#define SIMD_H_
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2 1
+#elif (defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#endif
+
+/**
+ * Thin wrapper over the vector instruction set available at compile time
+ * (AVX2, SSE2, AArch64 NEON, or a portable scalar emulation). The CPU kernels
+ * are written once against Float, Int and Mask and process kWidth lanes at a
+ * time. Build with -mavx2 -mfma (or /arch:AVX2) to get the 8-wide path.
+ */
+namespace simd {
+
+#if SIMD_AVX2
+const int kWidth = 8;
+#else
+const int kWidth = 4;
+#endif
+
+#if SIMD_AVX2
+
+struct Mask {
+  __m256 v;
+};
+struct Int {
+  __m256i v;
+};
+struct Float {
+  __m256 v;
+  Float() {}
+  Float(__m256 x) : v(x) {}
+  Float(float x) : v(_mm256_set1_ps(x)) {}
+};
+
+inline Float Load(const float *p) { return _mm256_loadu_ps(p); }
+inline void Store(float *p, Float a) { _mm256_storeu_ps(p, a.v); }
+inline Float operator+(Float a, Float b) { return _mm256_add_ps(a.v, b.v); }
+inline Float operator-(Float a, Float b) { return _mm256_sub_ps(a.v, b.v); }
+inline Float operator*(Float a, Float b) { return _mm256_mul_ps(a.v, b.v); }
+inline Float operator/(Float a, Float b) { return _mm256_div_ps(a.v, b.v); }
+inline Float Min(Float a, Float b) { return _mm256_min_ps(a.v, b.v); }
+inline Float Max(Float a, Float b) { return _mm256_max_ps(a.v, b.v); }
+inline Float Sqrt(Float a) { return _mm256_sqrt_ps(a.v); }
+inline Float Floor(Float a) { return _mm256_floor_ps(a.v); }
+inline Mask operator<(Float a, Float b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)};
+}
+inline Mask operator>(Float a, Float b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)};
+}
+inline Mask operator<=(Float a, Float b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)};
+}
+inline Mask operator>=(Float a, Float b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)};
+}
+inline Mask operator&(Mask a, Mask b) { return {_mm256_and_ps(a.v, b.v)}; }
+inline Mask operator|(Mask a, Mask b) { return {_mm256_or_ps(a.v, b.v)}; }
+inline Mask AndNot(Mask a, Mask b) { return {_mm256_andnot_ps(b.v, a.v)}; }
+inline int MoveMask(Mask m) { return _mm256_movemask_ps(m.v); }
+inline Float Select(Mask m, Float a, Float b) {
+  return _mm256_blendv_ps(b.v, a.v, m.v);
+}
+inline Int ToInt(Float a) { return {_mm256_cvttps_epi32(a.v)}; }
+inline Float Gather(const float *base, Int index) {
+  return _mm256_i32gather_ps(base, index.v, 4);
+}
+
+#elif SIMD_SSE2
+
+struct Mask {
+  __m128 v;
+};
+struct Int {
+  __m128i v;
+};
+struct Float {
+  __m128 v;
+  Float() {}
+  Float(__m128 x) : v(x) {}
+  Float(float x) : v(_mm_set1_ps(x)) {}
+};
+
+inline Float Load(const float *p) { return _mm_loadu_ps(p); }
+inline void Store(float *p, Float a) { _mm_storeu_ps(p, a.v); }
+inline Float operator+(Float a, Float b) { return _mm_add_ps(a.v, b.v); }
+inline Float operator-(Float a, Float b) { return _mm_sub_ps(a.v, b.v); }
+inline Float operator*(Float a, Float b) { return _mm_mul_ps(a.v, b.v); }
+inline Float operator/(Float a, Float b) { return _mm_div_ps(a.v, b.v); }
+inline Float Min(Float a, Float b) { return _mm_min_ps(a.v, b.v); }
+inline Float Max(Float a, Float b) { return _mm_max_ps(a.v, b.v); }
+inline Float Sqrt(Float a) { return _mm_sqrt_ps(a.v); }
+inline Mask operator<(Float a, Float b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+inline Mask operator>(Float a, Float b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+inline Mask operator<=(Float a, Float b) { return {_mm_cmple_ps(a.v, b.v)}; }
+inline Mask operator>=(Float a, Float b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+inline Mask operator&(Mask a, Mask b) { return {_mm_and_ps(a.v, b.v)}; }
+inline Mask operator|(Mask a, Mask b) { return {_mm_or_ps(a.v, b.v)}; }
+inline Mask AndNot(Mask a, Mask b) { return {_mm_andnot_ps(b.v, a.v)}; }
+inline int MoveMask(Mask m) { return _mm_movemask_ps(m.v); }
+inline Float Select(Mask m, Float a, Float b) {
+  return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v));
+}
+inline Float Floor(Float a) {
+  // SSE2 has no round instruction: truncate and fix up negative values.
+  __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+  return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f)));
+}
+inline Int ToInt(Float a) { return {_mm_cvttps_epi32(a.v)}; }
+inline Float Gather(const float *base, Int index) {
+  alignas(16) int32_t i[4];
+  _mm_store_si128(reinterpret_cast<__m128i *>(i), index.v);
+  return _mm_setr_ps(base[i[0]], base[i[1]], base[i[2]], base[i[3]]);
+}
+
+#elif SIMD_NEON
+
+struct Mask {
+  uint32x4_t v;
+};
+struct Int {
+  int32x4_t v;
+};
+struct Float {
+  float32x4_t v;
+  Float() {}
+  Float(float32x4_t x) : v(x) {}
+  Float(float x) : v(vdupq_n_f32(x)) {}
+};
+
+inline Float Load(const float *p) { return vld1q_f32(p); }
+inline void Store(float *p, Float a) { vst1q_f32(p, a.v); }
+inline Float operator+(Float a, Float b) { return vaddq_f32(a.v, b.v); }
+inline Float operator-(Float a, Float b) { return vsubq_f32(a.v, b.v); }
+inline Float operator*(Float a, Float b) { return vmulq_f32(a.v, b.v); }
+inline Float operator/(Float a, Float b) { return vdivq_f32(a.v, b.v); }
+inline Float Min(Float a, Float b) { return vminq_f32(a.v, b.v); }
+inline Float Max(Float a, Float b) { return vmaxq_f32(a.v, b.v); }
+inline Float Sqrt(Float a) { return vsqrtq_f32(a.v); }
+inline Float Floor(Float a) { return vrndmq_f32(a.v); }
+inline Mask operator<(Float a, Float b) { return {vcltq_f32(a.v, b.v)}; }
+inline Mask operator>(Float a, Float b) { return {vcgtq_f32(a.v, b.v)}; }
+inline Mask operator<=(Float a, Float b) { return {vcleq_f32(a.v, b.v)}; }
+inline Mask operator>=(Float a, Float b) { return {vcgeq_f32(a.v, b.v)}; }
+inline Mask operator&(Mask a, Mask b) { return {vandq_u32(a.v, b.v)}; }
+inline Mask operator|(Mask a, Mask b) { return {vorrq_u32(a.v, b.v)}; }
+inline Mask AndNot(Mask a, Mask b) { return {vbicq_u32(a.v, b.v)}; }
+inline int MoveMask(Mask m) {
+  const uint32x4_t kBits = {1, 2, 4, 8};
+  return static_cast<int>(vaddvq_u32(vandq_u32(m.v, kBits)));
+}
+inline Float Select(Mask m, Float a, Float b) {
+  return vbslq_f32(m.v, a.v, b.v);
+}
+inline Int ToInt(Float a) { return {vcvtq_s32_f32(a.v)}; }
+inline Float Gather(const float *base, Int index) {
+  int32_t i[4];
+  vst1q_s32(i, index.v);
+  float g[4] = {base[i[0]], base[i[1]], base[i[2]], base[i[3]]};
+  return vld1q_f32(g);
+}
+
+#else
+
+struct Mask {
+  bool v[kWidth];
+};
+struct Int {
+  int32_t v[kWidth];
+};
+struct Float {
+  float v[kWidth];
+  Float() {}
+  Float(float x) {
+    for (int i = 0; i < kWidth; ++i) v[i] = x;
+  }
+};
+
+#define SIMD_LANEWISE(expression) \
+  for (int i = 0; i < kWidth; ++i) r.v[i] = (expression);
+
+inline Float Load(const float *p) {
+  Float r;
+  SIMD_LANEWISE(p[i]);
+  return r;
+}
+inline void Store(float *p, Float a) {
+  for (int i = 0; i < kWidth; ++i) p[i] = a.v[i];
+}
+inline Float operator+(Float a, Float b) {
+  Float r;
+  SIMD_LANEWISE(a.v[i] + b.v[i]);
+  return r;
+}
+inline Float operator-(Float a, Float b) {
+  Float r;
+  SIMD_LANEWISE(a.v[i] - b.v[i]);
+  return r;
+}
+inline Float operator*(Float a, Float b) {
+  Float r;
+  SIMD_LANEWISE(a.v[i] * b.v[i]);
+  return r;
+}
+inline Float operator/(Float a, Float b) {
+  Float r;
+  SIMD_LANEWISE(a.v[i] / b.v[i]);
+  return r;
+}
+inline Float Min(Float a, Float b) {
+  Float r;
+  SIMD_LANEWISE(a.v[i] < b.v[i] ? a.v[i] : b.v[i]);
+  return r;
+}
+inline Float Max(Float a, Float b) {
+  Float r;
+  SIMD_LANEWISE(a.v[i] > b.v[i] ? a.v[i] : b.v[i]);
+  return r;
+}
+inline Float Sqrt(Float a) {
+  Float r;
+  SIMD_LANEWISE(std::sqrt(a.v[i]));
+  return r;
+}
+inline Float Floor(Float a) {
+  Float r;
+  SIMD_LANEWISE(std::floor(a.v[i]));
+  return r;
+}
+inline Mask operator<(Float a, Float b) {
+  Mask r;
+  SIMD_LANEWISE(a.v[i] < b.v[i]);
+  return r;
+}
+inline Mask operator>(Float a, Float b) {
+  Mask r;
+  SIMD_LANEWISE(a.v[i] > b.v[i]);
+  return r;
+}
+inline Mask operator<=(Float a, Float b) {
+  Mask r;
+  SIMD_LANEWISE(a.v[i] <= b.v[i]);
+  return r;
+}
+inline Mask operator>=(Float a, Float b) {
+  Mask r;
+  SIMD_LANEWISE(a.v[i] >= b.v[i]);
+  return r;
+}
+inline Mask operator&(Mask a, Mask b) {
+  Mask r;
+  SIMD_LANEWISE(a.v[i] && b.v[i]);
+  return r;
+}
+inline Mask operator|(Mask a, Mask b) {
+  Mask r;
+  SIMD_LANEWISE(a.v[i] || b.v[i]);
+  return r;
+}
+inline Mask AndNot(Mask a, Mask b) {
+  Mask r;
+  SIMD_LANEWISE(a.v[i] && !b.v[i]);
+  return r;
+}
+inline int MoveMask(Mask m) {
+  int bits = 0;
+  for (int i = 0; i < kWidth; ++i) bits |= m.v[i] ? (1 << i) : 0;
+  return bits;
+}
+inline Float Select(Mask m, Float a, Float b) {
+  Float r;
+  SIMD_LANEWISE(m.v[i] ? a.v[i] : b.v[i]);
+  return r;
+}
+inline Int ToInt(Float a) {
+  Int r;
+  SIMD_LANEWISE(static_cast<int32_t>(a.v[i]));
+  return r;
+}
+inline Float Gather(const float *base, Int index) {
+  Float r;
+  SIMD_LANEWISE(base[index.v[i]]);
+  return r;
+}
+
+#undef SIMD_LANEWISE
+
+#endif
+
+/**
+ * @brief Clamp Clamps every lane of x to [lo, hi].
+ */
+inline Float Clamp(Float x, Float lo, Float hi) { return Min(Max(x, lo), hi); }
+
+/**
+ * @brief Any Whether at least one lane of the mask is set.
+ */
+inline bool Any(Mask m) { return MoveMask(m) != 0; }
+
+/**
+ * @brief Lane Extracts a single lane. Only meant for reductions and tails,
+ * never for the hot loop.
+ */
+inline float Lane(Float a, int i) {
+  float lanes[kWidth];
+  Store(lanes, a);
+  return lanes[i];
+}
+
+/**
+ * @brief Iota Returns (start, start + 1, ..., start + kWidth - 1).
+ */
+inline Float Iota(float start) {
+  float lanes[kWidth];
+  for (int i = 0; i < kWidth; ++i) lanes[i] = start + static_cast<float>(i);
+  return Load(lanes);
+}
+
+}  // namespace simd
+
+#endif  //  SIMD_H_
@@ -0,0 +1,34 @@
+#ifndef SPHERICAL_HARMONICS_H_
+#define SPHERICAL_HARMONICS_H_
+
+#include <Eigen/Geometry>
+
+namespace data_representation {
+
+/**
+ * @brief kShCoefficients Number of real spherical harmonics of the first three
+ * bands (l = 0, 1, 2).
+ */
+const int kShCoefficients = 9;
+
+/**
+ * @brief EvaluateSh Real spherical harmonics basis, ordered by band and then
+ * by m = -l..l, the same order used by the brdf shaders.
+ * @param d Unit direction.
+ * @param sh The kShCoefficients basis values.
+ */
+inline void EvaluateSh(const Eigen::Vector3f &d, float sh[kShCoefficients]) {
+  sh[0] = 0.282095f;
+  sh[1] = 0.488603f * d[1];
+  sh[2] = 0.488603f * d[2];
+  sh[3] = 0.488603f * d[0];
+  sh[4] = 1.092548f * d[0] * d[1];
+  sh[5] = 1.092548f * d[1] * d[2];
+  sh[6] = 0.315392f * (3.0f * d[2] * d[2] - 1.0f);
+  sh[7] = 1.092548f * d[0] * d[2];
+  sh[8] = 0.546274f * (d[0] * d[0] - d[1] * d[1]);
+}
+
+}  // namespace data_representation
+
+#endif  //  SPHERICAL_HARMONICS_H_
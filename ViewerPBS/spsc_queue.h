@@ -0,0 +1,66 @@
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace concurrency {
+
+/**
+ * @brief SpscQueue Bounded lock-free queue between one producer thread and
+ * one consumer thread. Each index is written by a single thread, and the
+ * release store that publishes it is paired with an acquire load on the other
+ * side, so an item is fully written before the consumer sees it and fully
+ * read before the producer reuses its slot.
+ * @tparam T Type of the items, default constructible and movable.
+ * @tparam kCapacity Number of slots, a power of two.
+ */
+template <typename T, size_t kCapacity>
+class SpscQueue {
+  static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0,
+                "The capacity must be a power of two");
+
+ public:
+  SpscQueue() : head_(0), tail_(0) {}
+
+  /**
+   * @brief Push Appends an item. Only called by the producer.
+   * @return False, leaving item untouched, when the queue is full.
+   */
+  bool Push(T &&item) {
+    const size_t kTail = tail_.load(std::memory_order_relaxed);
+    if (kTail - head_.load(std::memory_order_acquire) == kCapacity)
+      return false;
+    items_[kTail & (kCapacity - 1)] = std::move(item);
+    tail_.store(kTail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Pop Removes the oldest item. Only called by the consumer.
+   * @return False when the queue is empty.
+   */
+  bool Pop(T *item) {
+    const size_t kHead = head_.load(std::memory_order_relaxed);
+    if (kHead == tail_.load(std::memory_order_acquire)) return false;
+    *item = std::move(items_[kHead & (kCapacity - 1)]);
+    head_.store(kHead + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  std::array<T, kCapacity> items_;
+
+  /**
+   * @brief head_ tail_ Items popped and pushed so far, on separate cache
+   * lines so that both threads do not invalidate each other's.
+   */
+  alignas(64) std::atomic<size_t> head_;
+  alignas(64) std::atomic<size_t> tail_;
+};
+
+}  // namespace concurrency
+
+#endif  //  SPSC_QUEUE_H_
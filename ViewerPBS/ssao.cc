@@ -0,0 +1,429 @@
+#include <ssao.h>
+
+#include <QImage>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+#include "./parallel_for.h"
+#include "./simd.h"
+
+namespace data_visualization {
+
+namespace {
+
+/**
+ * @brief kTwoPi The constant used by the shaders, kept for identical results.
+ */
+const float kTwoPi = 6.28318384f;
+
+/**
+ * @brief kTileSize Width and height of the tiles processed by one task, a
+ * multiple of simd::kWidth.
+ */
+const int kTileSize = 32;
+
+/**
+ * @brief kRangeSigma Standard deviation of the obscurance difference in the
+ * range weight of the blur (ssao_blur.glsl).
+ */
+const float kRangeSigma = 0.12f;
+
+/**
+ * @brief kBlurDepthTolerance Relative difference of eye space depth at which
+ * the depth weight of the blur (ssao_blur.glsl) falls to zero.
+ */
+const float kBlurDepthTolerance = 0.05f;
+
+// Eye space depth of a depth buffer value, as EyeDepth in the shaders.
+float EyeDepth(float depth, const SsaoSettings &settings) {
+  const float kN = settings.z_near, kF = settings.z_far;
+  return 2.0f * kN * kF / (kF + kN - (2.0f * depth - 1.0f) * (kF - kN));
+}
+
+// Conversion to and from a GL_RGB8 channel.
+float Quantize(float value) {
+  return std::floor(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f) /
+         255.0f;
+}
+
+simd::Float Quantize(simd::Float value) {
+  return simd::Floor(simd::Clamp(value, simd::Float(0.0f), simd::Float(1.0f)) *
+                         simd::Float(255.0f) +
+                     simd::Float(0.5f)) /
+         simd::Float(255.0f);
+}
+
+// Conversion to and from a GL_RG16 channel.
+float Quantize16(float value) {
+  return std::floor(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f + 0.5f) /
+         65535.0f;
+}
+
+/**
+ * @brief StoredNormal The normal as read back from the RG16 target, with the
+ * octahedral encoding of normal.glsl.
+ */
+Eigen::Vector3f StoredNormal(const float *normal) {
+  Eigen::Vector3f n(normal[0], normal[1], normal[2]);
+  const float kNorm = std::abs(n.x()) + std::abs(n.y()) + std::abs(n.z());
+  if (kNorm == 0.0f) return Eigen::Vector3f::Zero();
+  n /= kNorm;
+  Eigen::Vector2f e(n.x(), n.y());
+  if (n.z() < 0.0f)
+    e = Eigen::Vector2f((1.0f - std::abs(n.y())) * (n.x() >= 0.0f ? 1 : -1),
+                        (1.0f - std::abs(n.x())) * (n.y() >= 0.0f ? 1 : -1));
+  e.x() = Quantize16(e.x() * 0.5f + 0.5f) * 2.0f - 1.0f;
+  e.y() = Quantize16(e.y() * 0.5f + 0.5f) * 2.0f - 1.0f;
+
+  n = Eigen::Vector3f(e.x(), e.y(), 1.0f - std::abs(e.x()) - std::abs(e.y()));
+  const float kT = std::max(-n.z(), 0.0f);
+  n.x() += n.x() >= 0.0f ? -kT : kT;
+  n.y() += n.y() >= 0.0f ? -kT : kT;
+  return n.normalized();
+}
+
+}  // namespace
+
+void MakeSsaoKernel(uint32_t seed, std::vector<Eigen::Vector2f> *kernel) {
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<float> random_floats(0.0f, 1.0f);
+  kernel->clear();
+  for (int i = 0; i < kSsaoKernelSize; ++i) {
+    // Uniform angle and a radius proportional to sqrt(U), U ~ U(0, 1).
+    const float kTheta = kTwoPi * random_floats(generator);
+    const float kRadius = std::sqrt(random_floats(generator));
+    kernel->emplace_back(kRadius * std::cos(kTheta),
+                         kRadius * std::sin(kTheta));
+  }
+}
+
+void MakeBlurWeights(int radius, std::vector<float> *weights) {
+  // The standard deviation keeps the outermost taps at about 10% of the
+  // center, so a larger radius blurs more instead of being cut off.
+  const float kSigma = 0.5f * (radius + 1);
+  weights->resize(static_cast<size_t>(radius + 1));
+  for (int i = 0; i <= radius; ++i)
+    (*weights)[static_cast<size_t>(i)] =
+        std::exp(-static_cast<float>(i * i) / (2.0f * kSigma * kSigma));
+}
+
+Ssao::Ssao()
+    : noise_width_(0),
+      noise_height_(0),
+      width_(0),
+      height_(0),
+      stride_(0),
+      tiles_x_(0),
+      tiles_y_(0),
+      border_stride_(0) {
+  MakeSsaoKernel(0, &kernel_);
+  range_weights_.resize(511);
+  for (int i = 0; i < 511; ++i) {
+    const float kDifference = (i - 255) / 255.0f;
+    range_weights_[static_cast<size_t>(i)] = std::exp(
+        -(kDifference * kDifference) / (2.0f * kRangeSigma * kRangeSigma));
+  }
+}
+
+void Ssao::SetKernel(const std::vector<Eigen::Vector2f> &kernel) {
+  kernel_ = kernel;
+}
+
+bool Ssao::LoadNoiseTexture(const std::string &filename) {
+  QImage image;
+  if (!image.load(filename.c_str())) return false;
+  image = image.convertToFormat(QImage::Format_RGB888);
+
+  noise_width_ = image.width();
+  noise_height_ = image.height();
+  noise_.resize(static_cast<size_t>(noise_width_ * noise_height_));
+  for (int y = 0; y < noise_height_; ++y) {
+    const unsigned char *row = image.constScanLine(y);
+    for (int x = 0; x < noise_width_; ++x)
+      noise_[static_cast<size_t>(y * noise_width_ + x)] = row[x * 3] / 255.0f;
+  }
+  return true;
+}
+
+float Ssao::Noise(float u, float v) const {
+  if (noise_.empty()) return 0.0f;
+
+  // GL_REPEAT with bilinear filtering; row 0 is t = 0 as uploaded by
+  // UploadImage. The 256x256 texture is magnified at the viewer size, so only
+  // the base level is used.
+  const float kX = u * noise_width_ - 0.5f;
+  const float kY = v * noise_height_ - 0.5f;
+  const float kFloorX = std::floor(kX), kFloorY = std::floor(kY);
+  const float kFx = kX - kFloorX, kFy = kY - kFloorY;
+  auto wrap = [](int i, int n) { return ((i % n) + n) % n; };
+  const int kX0 = wrap(static_cast<int>(kFloorX), noise_width_);
+  const int kY0 = wrap(static_cast<int>(kFloorY), noise_height_);
+  const int kX1 = (kX0 + 1) % noise_width_;
+  const int kY1 = (kY0 + 1) % noise_height_;
+  auto texel = [this](int x, int y) {
+    return noise_[static_cast<size_t>(y * noise_width_ + x)];
+  };
+  return (texel(kX0, kY0) * (1.0f - kFx) + texel(kX1, kY0) * kFx) *
+             (1.0f - kFy) +
+         (texel(kX0, kY1) * (1.0f - kFx) + texel(kX1, kY1) * kFx) * kFy;
+}
+
+void Ssao::Resize(int width, int height) {
+  width_ = width;
+  height_ = height;
+  tiles_x_ = (width + kTileSize - 1) / kTileSize;
+  tiles_y_ = (height + kTileSize - 1) / kTileSize;
+  stride_ = tiles_x_ * kTileSize;
+  const size_t kPadded = static_cast<size_t>(stride_ * tiles_y_ * kTileSize);
+  for (std::vector<float> *buffer :
+       {&depth_, &normal_x_, &normal_y_, &normal_z_, &cos_, &sin_, &ao_})
+    buffer->resize(kPadded);
+}
+
+void Ssao::Compute(const GBuffer &gbuffer, const SsaoSettings &settings,
+                   std::vector<float> *ao) {
+  Resize(gbuffer.width, gbuffer.height);
+  const float kWidth = static_cast<float>(width_);
+  const float kHeight = static_cast<float>(height_);
+
+  // Texture fetches that do not depend on the sample.
+  concurrency::ParallelFor(height_, 16, [&](int y) {
+    for (int x = 0; x < width_; ++x) {
+      const size_t kSource = static_cast<size_t>(y * width_ + x);
+      const size_t kTarget = static_cast<size_t>(y * stride_ + x);
+      depth_[kTarget] = gbuffer.depth[kSource];
+      // Pixels without geometry keep the cleared depth and get no normal.
+      const Eigen::Vector3f kNormal =
+          gbuffer.depth[kSource] < 1.0f
+              ? StoredNormal(&gbuffer.normal[kSource * 3])
+              : Eigen::Vector3f::Zero();
+      normal_x_[kTarget] = kNormal.x();
+      normal_y_[kTarget] = kNormal.y();
+      normal_z_[kTarget] = kNormal.z();
+      const float kRandom = Noise((x + 0.5f) / kWidth, (y + 0.5f) / kHeight);
+      cos_[kTarget] = std::cos(kTwoPi * kRandom);
+      sin_[kTarget] = std::sin(kTwoPi * kRandom);
+    }
+  });
+
+  const int kSamples =
+      std::min(settings.samples, static_cast<int>(kernel_.size()));
+  const float kN = settings.z_near, kF = settings.z_far;
+  const simd::Float kZero(0.0f), kOne(1.0f);
+  const simd::Float kTwoNearFar(2.0f * kN * kF), kFarPlusNear(kF + kN);
+  const simd::Float kFarMinusNear(kF - kN);
+  const simd::Float kWidths(kWidth), kHeights(kHeight);
+  const float kSigma = settings.sigma * settings.radius * kTwoPi;
+  const float kScale = 2.0f * kSigma / settings.samples;
+  const float *kDepth = gbuffer.depth.data();
+
+  concurrency::ParallelFor(tiles_x_ * tiles_y_, [&](int tile) {
+    const int kTileX = (tile % tiles_x_) * kTileSize;
+    const int kTileY = (tile / tiles_x_) * kTileSize;
+    const int kEndY = std::min(kTileY + kTileSize, height_);
+    for (int y = kTileY; y < kEndY; ++y) {
+      const simd::Float kVertexY((y + 0.5f) / kHeight);
+      for (int x = kTileX; x < kTileX + kTileSize; x += simd::kWidth) {
+        const size_t kPixel = static_cast<size_t>(y * stride_ + x);
+        const simd::Float kVertexX =
+            (simd::Iota(static_cast<float>(x)) + simd::Float(0.5f)) / kWidths;
+        const simd::Float kNormalX = simd::Load(&normal_x_[kPixel]);
+        const simd::Float kNormalY = simd::Load(&normal_y_[kPixel]);
+        const simd::Float kNormalZ = simd::Load(&normal_z_[kPixel]);
+        const simd::Float kCos = simd::Load(&cos_[kPixel]);
+        const simd::Float kSin = simd::Load(&sin_[kPixel]);
+
+        const simd::Float kZNdc =
+            simd::Float(2.0f) * simd::Load(&depth_[kPixel]) - kOne;
+        const simd::Float kZEye =
+            kTwoNearFar / (kFarPlusNear - kZNdc * kFarMinusNear);
+        const simd::Float kBias = kZEye * simd::Float(settings.beta);
+        const simd::Float kProjected =
+            kZEye / simd::Float(kN) * simd::Float(settings.radius);
+
+        simd::Float sum = kZero;
+        for (int i = 0; i < kSamples; ++i) {
+          const simd::Float kSampleX(kernel_[static_cast<size_t>(i)].x());
+          const simd::Float kSampleY(kernel_[static_cast<size_t>(i)].y());
+          // The rotation of step_two.frag, sign of the last term included.
+          const simd::Float kRotatedX = kSampleX * kCos - kSampleY * kSin;
+          const simd::Float kRotatedY = kSampleX * kSin - kSampleY * kCos;
+          const simd::Float kLength =
+              simd::Sqrt(kRotatedX * kRotatedX + kRotatedY * kRotatedY);
+          const simd::Float kEFx = kRotatedX / kLength * kProjected;
+          const simd::Float kEFy = kRotatedY / kLength * kProjected;
+
+          const simd::Float kFx = kVertexX + kEFx;
+          const simd::Float kFy = kVertexY + kEFy;
+          const simd::Mask kInside = (kFx <= kOne) & (kFx >= kZero) &
+                                     (kFy <= kOne) & (kFy >= kZero);
+          if (!simd::Any(kInside)) continue;
+
+          // Nearest texel with GL_REPEAT, where a coordinate of exactly 1
+          // wraps to the first texel.
+          simd::Float texel_x = simd::Floor(kFx * kWidths);
+          simd::Float texel_y = simd::Floor(kFy * kHeights);
+          texel_x = simd::Select(texel_x >= kWidths, texel_x - kWidths, texel_x);
+          texel_y =
+              simd::Select(texel_y >= kHeights, texel_y - kHeights, texel_y);
+          const simd::Float kIndex =
+              simd::Select(kInside, texel_y * kWidths + texel_x, kZero);
+          const simd::Float kFz =
+              simd::Float(2.0f) * simd::Gather(kDepth, simd::ToInt(kIndex)) -
+              kOne;
+          const simd::Float kFzEye =
+              kTwoNearFar / (kFarPlusNear - kFz * kFarMinusNear);
+
+          const simd::Float kVz = kZEye - kFzEye;
+          const simd::Float kDot =
+              kEFx * kNormalX + kEFy * kNormalY + kVz * kNormalZ;
+          const simd::Float kLengthSquared =
+              kEFx * kEFx + kEFy * kEFy + kVz * kVz;
+          const simd::Float kObscurance =
+              simd::Max(kZero, kDot - kBias) /
+              (kLengthSquared + simd::Float(settings.epsilon));
+          sum = sum + simd::Select(kInside, kObscurance, kZero);
+        }
+
+        float visibility[simd::kWidth];
+        simd::Store(visibility,
+                    simd::Max(kZero, kOne - simd::Float(kScale) * sum));
+        for (int lane = 0; lane < simd::kWidth; ++lane)
+          visibility[lane] = Quantize(std::pow(visibility[lane], settings.k));
+        std::copy_n(visibility, simd::kWidth, &ao_[kPixel]);
+      }
+    }
+  });
+
+  ao->resize(static_cast<size_t>(width_ * height_));
+  for (int y = 0; y < height_; ++y)
+    std::copy_n(&ao_[static_cast<size_t>(y * stride_)], width_,
+                &(*ao)[static_cast<size_t>(y * width_)]);
+}
+
+void Ssao::Blur(const GBuffer &gbuffer, const SsaoSettings &settings,
+                const std::vector<float> &ao, std::vector<float> *blurred) {
+  const int kWidth = gbuffer.width, kHeight = gbuffer.height;
+  if (kWidth != width_ || kHeight != height_) Resize(kWidth, kHeight);
+  const int kRadius = std::min(std::max(settings.blur_radius, 1),
+                               kMaxBlurRadius);
+  const int kDiameter = 2 * kRadius + 1;
+  std::vector<float> spatial;
+  MakeBlurWeights(kRadius, &spatial);
+
+  // Borders clamped to the edge, as the shader clamps its fetches, so vectors
+  // never need to clamp. Vectors of the last tile column read up to
+  // 2 * kRadius texels past it.
+  border_stride_ = stride_ + 2 * kRadius;
+  const size_t kBorderSize =
+      static_cast<size_t>(border_stride_ * (kHeight + 2 * kRadius));
+  for (std::vector<float> *buffer : {&border_, &border_depth_, &horizontal_})
+    buffer->resize(kBorderSize);
+  for (int y = 0; y < kHeight + 2 * kRadius; ++y) {
+    const int kSourceY = std::min(std::max(y - kRadius, 0), kHeight - 1);
+    for (int x = 0; x < border_stride_; ++x) {
+      const int kSourceX = std::min(std::max(x - kRadius, 0), kWidth - 1);
+      const size_t kSource = static_cast<size_t>(kSourceY * kWidth + kSourceX);
+      const size_t kTarget = static_cast<size_t>(y * border_stride_ + x);
+      border_[kTarget] = Quantize(ao[kSource]);
+      border_depth_[kTarget] = EyeDepth(gbuffer.depth[kSource], settings);
+    }
+  }
+
+  const simd::Float k255(255.0f), kRangeOffset(255.5f);
+  const simd::Float kZero(0.0f), kOne(1.0f);
+  const simd::Float kInverseTolerance(1.0f / kBlurDepthTolerance);
+  const float *kRange = range_weights_.data();
+  // Weight of a tap at offset from a center: the precomputed spatial weight,
+  // the range weight of the obscurance difference, which is a table lookup as
+  // both values are multiples of 1 / 255, and a depth weight that falls
+  // linearly to zero at kBlurDepthTolerance.
+  auto weight = [&](int offset, simd::Float neighbor, simd::Float center,
+                    simd::Float neighbor_z, simd::Float center_z) {
+    const simd::Float kRangeWeight = simd::Gather(
+        kRange,
+        simd::ToInt(simd::Floor((neighbor - center) * k255 + kRangeOffset)));
+    const simd::Float kDifference =
+        simd::Max(neighbor_z - center_z, center_z - neighbor_z) / center_z;
+    const simd::Float kDepthWeight =
+        simd::Max(kOne - kDifference * kInverseTolerance, kZero);
+    return kRangeWeight * kDepthWeight *
+           simd::Float(spatial[static_cast<size_t>(std::abs(offset))]);
+  };
+
+  // Horizontal pass, quantized to the R8 target between both passes.
+  concurrency::ParallelFor(tiles_x_ * tiles_y_, [&](int tile) {
+    const int kTileX = (tile % tiles_x_) * kTileSize;
+    const int kTileY = (tile / tiles_x_) * kTileSize;
+    const int kEndY = std::min(kTileY + kTileSize, height_);
+    for (int y = kTileY; y < kEndY; ++y) {
+      const size_t kRow = static_cast<size_t>((y + kRadius) * border_stride_);
+      for (int x = kTileX; x < kTileX + kTileSize; x += simd::kWidth) {
+        const float *row = &border_[kRow + static_cast<size_t>(x)];
+        const float *depth_row = &border_depth_[kRow + static_cast<size_t>(x)];
+        const simd::Float kCenter = simd::Load(row + kRadius);
+        const simd::Float kCenterZ = simd::Load(depth_row + kRadius);
+        simd::Float filtered(0.0f), total(0.0f);
+        for (int i = 0; i < kDiameter; ++i) {
+          const simd::Float kNeighbor = simd::Load(row + i);
+          const simd::Float kWeight = weight(
+              i - kRadius, kNeighbor, kCenter, simd::Load(depth_row + i),
+              kCenterZ);
+          filtered = filtered + kNeighbor * kWeight;
+          total = total + kWeight;
+        }
+        simd::Store(&horizontal_[kRow + static_cast<size_t>(x + kRadius)],
+                    Quantize(filtered / total));
+      }
+    }
+  });
+  for (int y = 0; y < kRadius; ++y) {
+    std::copy_n(&horizontal_[static_cast<size_t>(kRadius * border_stride_)],
+                border_stride_,
+                &horizontal_[static_cast<size_t>(y * border_stride_)]);
+    std::copy_n(&horizontal_[static_cast<size_t>((kHeight + kRadius - 1) *
+                                                 border_stride_)],
+                border_stride_,
+                &horizontal_[static_cast<size_t>((kHeight + kRadius + y) *
+                                                 border_stride_)]);
+  }
+
+  // Vertical pass.
+  concurrency::ParallelFor(tiles_x_ * tiles_y_, [&](int tile) {
+    const int kTileX = (tile % tiles_x_) * kTileSize;
+    const int kTileY = (tile / tiles_x_) * kTileSize;
+    const int kEndY = std::min(kTileY + kTileSize, height_);
+    for (int y = kTileY; y < kEndY; ++y) {
+      for (int x = kTileX; x < kTileX + kTileSize; x += simd::kWidth) {
+        const size_t kColumn = static_cast<size_t>(x + kRadius);
+        auto texel = [&](int j) {
+          return static_cast<size_t>((y + j) * border_stride_) + kColumn;
+        };
+        const simd::Float kCenter = simd::Load(&horizontal_[texel(kRadius)]);
+        const simd::Float kCenterZ =
+            simd::Load(&border_depth_[texel(kRadius)]);
+        simd::Float filtered(0.0f), total(0.0f);
+        for (int j = 0; j < kDiameter; ++j) {
+          const simd::Float kNeighbor = simd::Load(&horizontal_[texel(j)]);
+          const simd::Float kWeight =
+              weight(j - kRadius, kNeighbor, kCenter,
+                     simd::Load(&border_depth_[texel(j)]), kCenterZ);
+          filtered = filtered + kNeighbor * kWeight;
+          total = total + kWeight;
+        }
+        simd::Store(&ao_[static_cast<size_t>(y * stride_ + x)],
+                    Quantize(filtered / total));
+      }
+    }
+  });
+
+  blurred->resize(static_cast<size_t>(kWidth * kHeight));
+  for (int y = 0; y < kHeight; ++y)
+    std::copy_n(&ao_[static_cast<size_t>(y * stride_)], kWidth,
+                &(*blurred)[static_cast<size_t>(y * kWidth)]);
+}
+
+}  // namespace data_visualization
@@ -0,0 +1,162 @@
+#ifndef SSAO_H_
+#define SSAO_H_
+
+#include <Eigen/Geometry>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "./camera.h"
+#include "./rasterizer.h"
+
+namespace data_visualization {
+
+/**
+ * @brief kSsaoKernelSize Number of disk samples uploaded to step_two.frag.
+ */
+const int kSsaoKernelSize = 64;
+
+/**
+ * @brief kMaxBlurRadius Largest radius of the SSAO blur, the size of the
+ * spatial weights uploaded to step_three.frag.
+ */
+const int kMaxBlurRadius = 8;
+
+/**
+ * @brief SsaoSettings Uniforms of step_two.frag. Defaults match the initial
+ * GLWidget state, and the clipping planes the ones of the camera.
+ */
+struct SsaoSettings {
+  int samples = 64;
+  float radius = 0.001f;
+  float sigma = 1.8f;
+  float k = 2.5f;
+  float beta = 0.0001f;
+  float epsilon = 0.0001f;
+
+  /**
+   * @brief blur_radius Taps on each side of the pixel in both passes of the
+   * blur (step_three.frag), between 1 and kMaxBlurRadius.
+   */
+  int blur_radius = 3;
+  float z_near = static_cast<float>(kZNear);
+  float z_far = static_cast<float>(kZFar);
+};
+
+/**
+ * @brief MakeSsaoKernel Generates the disk samples of step_two.frag, uniformly
+ * distributed over the unit disk.
+ * @param seed Seed of the generator, so that the GL and CPU paths can share
+ * the same kernel.
+ * @param kernel The kSsaoKernelSize samples.
+ */
+void MakeSsaoKernel(uint32_t seed, std::vector<Eigen::Vector2f> *kernel);
+
+/**
+ * @brief MakeBlurWeights Computes the spatial weights of the separable blur of
+ * step_three.frag, a Gaussian over the pixel offset whose width grows with
+ * the radius.
+ * @param radius Taps on each side, between 1 and kMaxBlurRadius.
+ * @param weights radius + 1 weights, for offsets 0 to radius.
+ */
+void MakeBlurWeights(int radius, std::vector<float> *weights);
+
+/**
+ * @brief Ssao CPU implementation of the second and third SSAO steps
+ * (step_two.frag and step_three.frag) with the same math as the shaders,
+ * including the quantization of the RG16 normal and R8 obscurance targets
+ * they read and write.
+ * Pixels are processed simd::kWidth at a time and image tiles are
+ * distributed over all cores.
+ */
+class Ssao {
+ public:
+  /**
+   * @brief Ssao Constructor of the class.
+   */
+  Ssao();
+
+  /**
+   * @brief SetKernel Sets the disk samples (ssao_samples).
+   * @param kernel At least SsaoSettings::samples samples.
+   */
+  void SetKernel(const std::vector<Eigen::Vector2f> &kernel);
+
+  /**
+   * @brief LoadNoiseTexture Loads the rotation texture (texture_ssao_random).
+   * Only its red channel is used. Without it no rotation is applied.
+   * @param filename The path to the image.
+   * @return Whether it was able to load the image.
+   */
+  bool LoadNoiseTexture(const std::string &filename);
+
+  /**
+   * @brief Compute Estimates the obscurance of every pixel (step_two.frag).
+   * @param gbuffer Normal and depth buffers of the first step.
+   * @param settings The estimator parameters.
+   * @param ao Output visibility, one value per pixel, bottom row first.
+   */
+  void Compute(const GBuffer &gbuffer, const SsaoSettings &settings,
+               std::vector<float> *ao);
+
+  /**
+   * @brief Blur Applies the separable bilateral filter of step_three.frag:
+   * a horizontal pass into an R8 target, then a vertical one.
+   * @param gbuffer Depth buffer the range weights compare.
+   * @param settings The clipping planes and the blur radius.
+   * @param ao Visibility computed by Compute.
+   * @param blurred Output filtered visibility.
+   */
+  void Blur(const GBuffer &gbuffer, const SsaoSettings &settings,
+            const std::vector<float> &ao, std::vector<float> *blurred);
+
+ private:
+  /**
+   * @brief Resize Sets up the padded buffers for an image size.
+   */
+  void Resize(int width, int height);
+
+  /**
+   * @brief Noise Bilinear, repeating lookup of the rotation texture.
+   */
+  float Noise(float u, float v) const;
+
+  std::vector<Eigen::Vector2f> kernel_;
+
+  int noise_width_, noise_height_;
+  std::vector<float> noise_;
+
+  int width_, height_, stride_;
+  int tiles_x_, tiles_y_;
+
+  /**
+   * @brief depth_, normal_x_, normal_y_, normal_z_, cos_, sin_ Per-pixel
+   * inputs of step_two.frag with padded rows: the normals as decoded from the
+   * RG16 target and the rotation given by the noise texture.
+   */
+  std::vector<float> depth_, normal_x_, normal_y_, normal_z_, cos_, sin_;
+
+  /**
+   * @brief ao_ Padded output of either step.
+   */
+  std::vector<float> ao_;
+
+  /**
+   * @brief border_, border_depth_, horizontal_ Input visibility and eye space
+   * depth of the blur and output of its horizontal pass, with as many texels
+   * as the radius clamped to the edge on every side.
+   */
+  std::vector<float> border_, border_depth_, horizontal_;
+  int border_stride_;
+
+  /**
+   * @brief range_weights_ Range weight of the bilateral filter for every
+   * difference between two 8 bit values, indexed by difference + 255.
+   */
+  std::vector<float> range_weights_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  SSAO_H_
@@ -14,6 +14,8 @@ void TriangleMesh::Clear() {
   faces_.clear();
   normals_.clear();
   textures_.clear();
+  ambient_occlusion_.clear();
+  radiance_transfer_.clear();
 
   min_ = Eigen::Vector3f(std::numeric_limits<float>::max(),
                          std::numeric_limits<float>::max(),
@@ -33,6 +33,18 @@ class TriangleMesh {
   std::vector<float> textures_;
   std::string diffuseMap_;//NEW
 
+  /**
+   * @brief ambient_occlusion_ Baked per-vertex visibility, see
+   * BakeAmbientOcclusion. Empty until baked or read from the cache.
+   */
+  std::vector<float> ambient_occlusion_;
+
+  /**
+   * @brief radiance_transfer_ Baked per-vertex spherical harmonics transfer,
+   * see BakeRadianceTransfer. Empty until baked or read from the cache.
+   */
+  std::vector<float> radiance_transfer_;
+
   /**
    * @brief min The minimum point of the bounding box.
    */
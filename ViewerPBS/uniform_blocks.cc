@@ -0,0 +1,20 @@
+#include <uniform_blocks.h>
+
+namespace data_visualization {
+
+void BindUniformBlocks(GLuint program) {
+  const struct {
+    const char *name;
+    GLuint binding;
+  } kBlocks[] = {{"Frame", kFrameBlockBinding},
+                 {"Material", kMaterialBlockBinding},
+                 {"Scene", kSceneBlockBinding},
+                 {"Ssao", kSsaoBlockBinding}};
+  for (const auto &kBlock : kBlocks) {
+    const GLuint kIndex = glGetUniformBlockIndex(program, kBlock.name);
+    if (kIndex != GL_INVALID_INDEX)
+      glUniformBlockBinding(program, kIndex, kBlock.binding);
+  }
+}
+
+}  // namespace data_visualization
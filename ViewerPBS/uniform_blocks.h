@@ -0,0 +1,221 @@
+#ifndef UNIFORM_BLOCKS_H_
+#define UNIFORM_BLOCKS_H_
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstring>
+
+namespace data_visualization {
+
+/**
+ * @brief kFrameBlockBinding ... kSsaoBlockBinding Binding points of the
+ * uniform blocks, declared in the .glsl files included by the shaders.
+ */
+const GLuint kFrameBlockBinding = 0;
+const GLuint kMaterialBlockBinding = 1;
+const GLuint kSceneBlockBinding = 2;
+const GLuint kSsaoBlockBinding = 3;
+
+/**
+ * @brief FrameBlock std140 layout of the Frame block (shaders/frame.glsl):
+ * transforms and state shared by all the passes of a frame. A vec3 takes the
+ * first three floats of a 16 byte slot, and a mat3 three such slots.
+ */
+struct FrameBlock {
+  float projection[16];
+  float view[16];
+  float inverse_view[16];
+  float model[16];
+  float normal_matrix[12];
+
+  /**
+   * @brief light_position Light position in eye space.
+   */
+  float light_position[3];
+
+  /**
+   * @brief point_scale Converts splat radii to point sizes, for point clouds.
+   */
+  float point_scale;
+  int composite_mode;
+  int diffuse_mode;
+
+  /**
+   * @brief z_near, z_far Clipping planes of the projection.
+   */
+  float z_near;
+  float z_far;
+
+  /**
+   * @brief viewport_size Size of the viewport in pixels.
+   */
+  float viewport_size[2];
+
+  /**
+   * @brief target_scale Fraction of the off-screen targets covered by the
+   * viewport, which scales the texture coordinates of full screen passes.
+   */
+  float target_scale[2];
+};
+
+/**
+ * @brief MaterialBlock std140 layout of the Material block
+ * (shaders/material.glsl): Phong and BRDF material parameters.
+ */
+struct MaterialBlock {
+  float material_ambient[3];
+  float metalness;
+  float material_diffuse[3];
+  float roughness;
+  float material_specular[3];
+  float material_shininess;
+  float fresnel[3];
+  float padding;
+};
+
+/**
+ * @brief SceneBlock std140 layout of the Scene block (shaders/scene.glsl):
+ * data that only changes with the model or the environment.
+ */
+struct SceneBlock {
+  float environment_sh[9][4];
+  float probe_volume_size[4];
+  float probe_volume_min[4];
+  float probe_volume_max[4];
+  float distance_field_size[4];
+  float distance_field_min[4];
+  float distance_field_max[4];
+
+  /**
+   * @brief light_object_position Light position in object space, where the
+   * distance field is traced.
+   */
+  float light_object_position[4];
+  float light_color[4];
+};
+
+/**
+ * @brief SsaoBlock std140 layout of the Ssao block (shaders/ssao.glsl). Array
+ * elements take a 16 byte slot each.
+ */
+struct SsaoBlock {
+  float ssao_samples[64][4];
+  int ssao_n_samples;
+  float ssao_radius;
+  float ssao_sigma;
+  float ssao_k;
+  float ssao_beta;
+  float ssao_epsilon;
+  int ssao_render_mode;
+
+  /**
+   * @brief ssao_resolution Full resolution pixels per side of the pixels the
+   * estimator runs at: 1, 2 or 4.
+   */
+  int ssao_resolution;
+
+  /**
+   * @brief ssao_reprojection Maps the clip space of the current frame to the
+   * one of the previous frame, in the temporal mode.
+   */
+  float ssao_reprojection[16];
+
+  /**
+   * @brief ssao_rotation Rotation of the kernel in turns, which changes every
+   * frame in the temporal mode.
+   */
+  float ssao_rotation;
+
+  /**
+   * @brief ssao_blend Weight of the new estimate in the exponential moving
+   * average of the temporal mode, 1 when there is no history.
+   */
+  float ssao_blend;
+
+  /**
+   * @brief ssao_blur_radius, ssao_blur_weights Taps on each side of the pixel
+   * in both passes of the blur, and their spatial weights for the offsets 0
+   * to ssao_blur_radius (kMaxBlurRadius at most, see MakeBlurWeights).
+   */
+  int ssao_blur_radius;
+  float padding;
+  float ssao_blur_weights[9][4];
+};
+
+static_assert(offsetof(FrameBlock, normal_matrix) == 256, "std140 layout");
+static_assert(offsetof(FrameBlock, light_position) == 304, "std140 layout");
+static_assert(offsetof(FrameBlock, composite_mode) == 320, "std140 layout");
+static_assert(offsetof(FrameBlock, viewport_size) == 336, "std140 layout");
+static_assert(sizeof(FrameBlock) == 352, "std140 layout");
+static_assert(offsetof(MaterialBlock, fresnel) == 48, "std140 layout");
+static_assert(sizeof(MaterialBlock) == 64, "std140 layout");
+static_assert(offsetof(SceneBlock, probe_volume_size) == 144, "std140 layout");
+static_assert(sizeof(SceneBlock) == 272, "std140 layout");
+static_assert(offsetof(SsaoBlock, ssao_n_samples) == 1024, "std140 layout");
+static_assert(offsetof(SsaoBlock, ssao_reprojection) == 1056,
+              "std140 layout");
+static_assert(offsetof(SsaoBlock, ssao_blur_weights) == 1136,
+              "std140 layout");
+static_assert(sizeof(SsaoBlock) == 1280, "std140 layout");
+
+/**
+ * @brief BindUniformBlocks Assigns the binding points above to the blocks
+ * that the program uses.
+ * @param program Name of a linked program.
+ */
+void BindUniformBlocks(GLuint program);
+
+/**
+ * @brief UniformBuffer A uniform buffer object holding one block, bound to its
+ * binding point for the whole lifetime of the context. A CPU copy of the last
+ * upload skips updates that do not change anything.
+ * @tparam Block The std140 structure of the block.
+ */
+template <typename Block>
+class UniformBuffer {
+ public:
+  UniformBuffer() : buffer_(0), uploaded_(false) {}
+
+  /**
+   * @brief Create Allocates the buffer and binds it.
+   * @param binding The binding point of the block.
+   */
+  void Create(GLuint binding) {
+    glGenBuffers(1, &buffer_);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer_);
+    uploaded_ = false;
+  }
+
+  /**
+   * @brief Update Uploads the block if it differs from the last upload.
+   * @return Whether it was uploaded.
+   */
+  bool Update(const Block &block) {
+    if (uploaded_ && std::memcmp(&block, &block_, sizeof(Block)) == 0)
+      return false;
+    block_ = block;
+    uploaded_ = true;
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block_);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    return true;
+  }
+
+  /**
+   * @brief block The last uploaded contents.
+   */
+  const Block &block() const { return block_; }
+
+ private:
+  GLuint buffer_;
+  Block block_;
+  bool uploaded_;
+};
+
+}  // namespace data_visualization
+
+#endif  //  UNIFORM_BLOCKS_H_